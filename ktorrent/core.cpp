@@ -25,6 +25,7 @@
 #include <QDBusInterface>
 #include <QDBusReply>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QNetworkInterface>
 #include <QProgressBar>
 
@@ -44,6 +45,8 @@
 #include <torrent/torrentcreator.h>
 #include <torrent/server.h>
 #include <peer/authenticationmonitor.h>
+#include <peer/peer.h>
+#include <peer/peermanager.h>
 #include <util/log.h>
 #include <util/error.h>
 #include <util/fileops.h>
@@ -62,6 +65,10 @@
 #include "dialogs/fileselectdlg.h"
 #include "dialogs/missingfilesdlg.h"
 #include "gui.h"
+#include "startuploader.h"
+#include "startupsnapshot.h"
+#include "statsexport.h"
+#include "updatescheduler.h"
 
 
 using namespace bt;
@@ -69,21 +76,29 @@ using namespace bt;
 namespace kt
 {
     const Uint32 CORE_UPDATE_INTERVAL = 250;
+    // every so many ticks all torrents are checked, to catch ones started behind our back
+    const Uint32 CORE_RESYNC_TICKS = 40;
 
     Core::Core(kt::GUI* gui)
         : gui(gui),
           keep_seeding(true),
+          stats_version(0),
+          stats_export(0),
           sleep_suppression_cookie(-1),
           exiting(false),
-          reordering_queue(false)
+          reordering_queue(false),
+          batch_loading(false)
     {
         UpdateCurrentTime();
         qman = new QueueManager();
+        scheduler = new UpdateScheduler();
         connect(qman, &kt::QueueManager::lowDiskSpace, this, &Core::onLowDiskSpace);
         connect(qman, &kt::QueueManager::queuingNotPossible, this, &Core::enqueueTorrentOverMaxRatio);
         connect(qman, &kt::QueueManager::lowDiskSpace, this, &Core::onLowDiskSpace);
         connect(qman, &kt::QueueManager::orderingQueue, this, &Core::beforeQueueReorder);
         connect(qman, &kt::QueueManager::queueOrdered, this, &Core::afterQueueReorder);
+        connect(this, &Core::torrentAdded, this, &Core::invalidateStatsSnapshot);
+        connect(this, &Core::torrentRemoved, this, &Core::invalidateStatsSnapshot);
 
         data_dir = Settings::tempDir();
         bool dd_not_exist = !bt::Exists(data_dir);
@@ -120,7 +135,8 @@ namespace kt
         gman = new kt::GroupManager();
         applySettings();
         gman->loadGroups();
-        connect(gman, &kt::GroupManager::customGroupChanged, this, &Core::customGroupChanged);
+        connect(this, &Core::torrentAdded, gman, &kt::GroupManager::torrentAdded);
+        connect(this, &Core::torrentRemoved, gman, &kt::GroupManager::torrentRemoved);
 
         qRegisterMetaType<bt::MagnetLink>("bt::MagnetLink");
         qRegisterMetaType<kt::MagnetLinkLoadOptions>("kt::MagnetLinkLoadOptions");
@@ -133,6 +149,8 @@ namespace kt
 
     Core::~Core()
     {
+        delete stats_export;
+        delete scheduler;
         delete qman;
         delete pman;
         delete gman;
@@ -238,6 +256,18 @@ namespace kt
         mman->setTimerDuration(Settings::requeueMagnetsTime());
         mman->setDownloadingSlots(Settings::numMagnetDownloadingSlots());
 
+        if (Settings::exportStats() && !stats_export)
+        {
+            stats_export = new StatsExport();
+            if (stats_export->open(StatsExport::defaultPath()))
+                stats_export->update(*getStatsSnapshot());
+        }
+        else if (!Settings::exportStats() && stats_export)
+        {
+            delete stats_export;
+            stats_export = 0;
+        }
+
         settingsChanged();
     }
 
@@ -260,7 +290,7 @@ namespace kt
         if (Settings::useCompletedDir() && (silently || Settings::openAllTorrentsSilently()))
             tc->setMoveWhenCompletedDir(Settings::completedDir());
 
-        if (qman->alreadyLoaded(tc->getInfoHash()))
+        if (qman->alreadyLoaded(tc->getInfoHash()) || deferred_hashes.contains(tc->getInfoHash()))
         {
             Out(SYS_GEN | LOG_IMPORTANT) << "Torrent " << tc->getDisplayName() << " already loaded" << endl;
             return false;
@@ -347,7 +377,8 @@ namespace kt
             if (!g->isMember(tc))
             {
                 g->addTorrent(tc, true);
-                gman->saveGroups();
+                if (!batch_loading)
+                    gman->saveGroups();
             }
         }
 
@@ -569,6 +600,33 @@ namespace kt
             return 0;
     }
 
+    QList<bt::TorrentInterface*> Core::loadSilently(const QList<QPair<QByteArray, QUrl> >& torrents, const QString& group)
+    {
+        QList<bt::TorrentInterface*> loaded;
+        QString dir = locationHint(group);
+        if (dir.isNull())
+            return loaded;
+
+        batch_loading = true;
+        for (const QPair<QByteArray, QUrl>& t : torrents)
+        {
+            bt::TorrentInterface* tc = loadFromData(t.first, dir, group, true, t.second);
+            if (tc)
+                loaded.append(tc);
+        }
+        batch_loading = false;
+
+        if (!loaded.isEmpty())
+        {
+            // do what was skipped for every torrent
+            if (gman->find(group))
+                gman->saveGroups();
+            gui->updateActions();
+        }
+
+        return loaded;
+    }
+
     void Core::start(bt::TorrentInterface* tc)
     {
         if (tc->getStats().paused)
@@ -655,8 +713,6 @@ namespace kt
 
     void Core::loadExistingTorrent(const QString& tor_dir)
     {
-        TorrentControl* tc = 0;
-
         QString idir = tor_dir;
         if (!idir.endsWith(bt::DirSeparator()))
             idir += bt::DirSeparator();
@@ -664,10 +720,23 @@ namespace kt
         if (!bt::Exists(idir + QLatin1String("torrent")))
             return;
 
+        try
+        {
+            loadExistingTorrent(idir, bt::LoadFile(idir + QLatin1String("torrent")));
+        }
+        catch (bt::Error& err)
+        {
+            gui->errorMsg(err.toString());
+        }
+    }
+
+    void Core::loadExistingTorrent(const QString& tor_dir, const QByteArray& data)
+    {
+        TorrentControl* tc = 0;
         try
         {
             tc = new TorrentControl();
-            tc->init(qman, bt::LoadFile(idir + QLatin1String("torrent")), idir, QString::null);
+            tc->init(qman, data, tor_dir, QString::null);
 
             qman->append(tc);
             connectSignals(tc);
@@ -688,23 +757,119 @@ namespace kt
 
     void Core::loadTorrents()
     {
+        QElapsedTimer timer;
+        timer.start();
+
         QDir dir(data_dir);
         QStringList filters;
         filters << QStringLiteral("tor*");
         QStringList sl = dir.entryList(filters, QDir::Dirs);
-        for (int i = 0; i < sl.count(); i++)
+        for (QString& d : sl)
+        {
+            d.prepend(data_dir);
+            if (!d.endsWith(bt::DirSeparator()))
+                d.append(bt::DirSeparator());
+        }
+
+        // Torrents which were idle when we last exited, are loaded after the GUI is up.
+        // Not when the queue is suspended, the suspended torrents look idle as well.
+        StartupSnapshot snapshot;
+        if (!KSharedConfig::openConfig()->group("QueueManager").readEntry("suspended", false) &&
+                snapshot.load(kt::DataDir() + QLatin1String("startup_snapshot")))
+        {
+            QStringList eager;
+            for (const QString& d : qAsConst(sl))
+            {
+                const StartupSnapshot::Record* r = snapshot.find(d);
+                if (r && StartupSnapshot::idle(r))
+                {
+                    deferred_dirs.append(d);
+                    deferred_hashes.insert(bt::SHA1Hash(r->info_hash));
+                }
+                else
+                    eager.append(d);
+            }
+            sl = eager;
+        }
+
+        // The torrent files are read on a thread pool, while we initialize the
+        // torrents which have already been read here.
+        StartupLoader loader(sl);
+        loader.start();
+
+        int total = loader.count();
+        int step = qMax(total / 10, 1);
+        for (int i = 0; i < total; i++)
         {
-            QString idir = data_dir + sl.at(i);
-            if (!idir.endsWith(DirSeparator()))
-                idir.append(DirSeparator());
+            StartupLoader::Entry e = loader.take(i);
+            if (!e.error.isEmpty())
+            {
+                gui->errorMsg(e.error);
+            }
+            else if (!e.missing)
+            {
+                Out(SYS_GEN | LOG_DEBUG) << "Loading " << e.dir << endl;
+                loadExistingTorrent(e.dir, e.data);
+            }
 
-            Out(SYS_GEN | LOG_NOTICE) << "Loading " << idir << endl;
-            loadExistingTorrent(idir);
+            if ((i + 1) % step == 0 || i + 1 == total)
+                Out(SYS_GEN | LOG_NOTICE) << "Loaded " << (i + 1) << " of " << total << " torrents" << endl;
         }
 
-        gman->torrentsLoaded(qman);
+        Out(SYS_GEN | LOG_NOTICE) << "Loaded " << qman->count() << " torrents in " << timer.elapsed() << " ms" << endl;
+
+        gman->torrentsLoaded(qman, deferred_dirs.isEmpty());
         qman->loadState(KSharedConfig::openConfig());
         QTimer::singleShot(0, this, SLOT(delayedStart()));
+
+        if (!deferred_dirs.isEmpty())
+        {
+            Out(SYS_GEN | LOG_NOTICE) << "Deferring " << deferred_dirs.count() << " idle torrents" << endl;
+            deferred_timer.start();
+            QTimer::singleShot(0, this, SLOT(loadDeferredTorrents()));
+        }
+    }
+
+    void Core::loadDeferredTorrents()
+    {
+        if (exiting)
+            return;
+
+        // Load in small slices, so the GUI stays responsive
+        QElapsedTimer slice;
+        slice.start();
+        while (!deferred_dirs.isEmpty() && slice.elapsed() < 20)
+        {
+            QString d = deferred_dirs.takeFirst();
+            if (!bt::Exists(d + QLatin1String("torrent")))
+                continue;
+
+            try
+            {
+                QByteArray data = bt::LoadFile(d + QLatin1String("torrent"));
+                loadExistingTorrent(d, data);
+            }
+            catch (bt::Error& err)
+            {
+                gui->errorMsg(err.toString());
+            }
+        }
+
+        if (!deferred_dirs.isEmpty())
+        {
+            QTimer::singleShot(0, this, SLOT(loadDeferredTorrents()));
+            return;
+        }
+
+        deferred_hashes.clear();
+        Out(SYS_GEN | LOG_NOTICE) << "Loaded deferred torrents in " << deferred_timer.elapsed() << " ms" << endl;
+        gman->torrentsLoaded(qman, true);
+        qman->orderQueue();
+    }
+
+    bool Core::isLoadingTorrents() const
+    {
+        return !deferred_dirs.isEmpty();
     }
 
     void Core::delayedStart()
@@ -745,7 +910,7 @@ namespace kt
             }
 
             torrentRemoved(tc);
-            gman->torrentRemoved(tc);
+            scheduler->remove(tc);
             qman->torrentRemoved(tc);
             gui->updateActions();
             bt::Delete(dir, false);
@@ -795,7 +960,7 @@ namespace kt
             }
 
             torrentRemoved(tc);
-            gman->torrentRemoved(tc);
+            scheduler->remove(tc);
             try
             {
                 bt::Delete(dir, false);
@@ -860,6 +1025,10 @@ namespace kt
         WaitJob* job = new WaitJob(5000);
         qman->saveState(KSharedConfig::openConfig());
 
+        // the snapshot needs the state from before the torrents get stopped
+        StartupSnapshot snapshot;
+        snapshot.collect(qman);
+
         // Sync the config to be sure everything is saved
         Settings::self()->save();
 
@@ -876,7 +1045,16 @@ namespace kt
         Globals::instance().shutdownTCPServer();
         Globals::instance().shutdownUTPServer();
 
+        // torrents which are still waiting to be loaded, will not be in the snapshot, and get loaded normally next time
+        if (deferred_dirs.isEmpty())
+            snapshot.save(kt::DataDir() + QLatin1String("startup_snapshot"));
+        else
+            bt::Delete(kt::DataDir() + QLatin1String("startup_snapshot"), true);
+
         pman->unloadAll();
+        scheduler->clear();
+        delete stats_export;
+        stats_export = 0;
         qman->clear();
     }
 
@@ -966,6 +1144,7 @@ namespace kt
 
     void Core::startUpdateTimer()
     {
+        scheduler->resync(qman);
         if (!update_timer.isActive())
         {
             Out(SYS_GEN | LOG_DEBUG) << "Started update timer" << endl;
@@ -998,19 +1177,17 @@ namespace kt
         {
             bt::UpdateCurrentTime();
             AuthenticationMonitor::instance().update();
+            stats_version++;
 
-            QList<bt::TorrentInterface*>::iterator i = qman->begin();
-            bool updated = false;
-            while (i != qman->end())
-            {
-                bt::TorrentInterface* tc = *i;
-                if (tc->getStats().running)
-                {
-                    tc->update();
-                    updated = true;
-                }
-                i++;
-            }
+            if (scheduler->stats().ticks % CORE_RESYNC_TICKS == 0)
+                scheduler->resync(qman);
+
+            bool updated = scheduler->update();
+            gman->update();
+            if (stats_export)
+                stats_export->update(*getStatsSnapshot());
+
+            emit statsUpdated();
 
             if (!updated && mman->count() == 0)
             {
@@ -1073,26 +1250,83 @@ namespace kt
 
     CurrentStats Core::getStats()
     {
-        CurrentStats stats;
-        Uint64 bytes_dl = 0, bytes_ul = 0;
-        Uint32 speed_dl = 0, speed_ul = 0;
+        return getStatsSnapshot(false)->totals;
+    }
+
+    StatsSnapshot::Ptr Core::getStatsSnapshot(bool with_peers)
+    {
+        if (stats_snapshot && stats_snapshot->version == stats_version && (stats_snapshot->has_peer_totals || !with_peers))
+            return stats_snapshot;
 
+        StatsSnapshot* snap = new StatsSnapshot();
+        snap->totals = CurrentStats();
+        snap->peers = PeerTotals();
+        snap->has_peer_totals = with_peers;
+        snap->version = stats_version;
+        snap->num_running = 0;
+        snap->leechers_connected = snap->leechers_total = 0;
+        snap->seeders_connected = snap->seeders_total = 0;
+        snap->torrents.reserve(qman->count());
 
+        Uint64 bytes_dl = 0, bytes_ul = 0;
         for (QList<bt::TorrentInterface*>::iterator i = qman->begin(); i != qman->end(); ++i)
         {
             bt::TorrentInterface* tc = *i;
             const TorrentStats& s = tc->getStats();
-            speed_dl += s.download_rate;
-            speed_ul += s.upload_rate;
+            snap->totals.download_speed += s.download_rate;
+            snap->totals.upload_speed += s.upload_rate;
             bytes_dl += s.session_bytes_downloaded;
             bytes_ul += s.session_bytes_uploaded;
+            snap->leechers_connected += s.leechers_connected_to;
+            snap->leechers_total += s.leechers_total;
+            snap->seeders_connected += s.seeders_connected_to;
+            snap->seeders_total += s.seeders_total;
+
+            TorrentSnapshot ts;
+            ts.tc = tc;
+            ts.stats = s;
+            snap->torrents.append(ts);
+
+            if (!s.running)
+                continue;
+
+            snap->num_running++;
+            if (!with_peers)
+                continue;
+
+            bt::TorrentControl* tctl = dynamic_cast<bt::TorrentControl*>(tc);
+            if (!tctl)
+                continue;
+
+            const QList<bt::Peer::Ptr> peers = tctl->getPeerMgr()->getPeers();
+            for (const bt::Peer::Ptr& peer : peers)
+            {
+                const bt::PeerInterface::Stats& ps = peer->getStats();
+                if (ps.perc_of_file >= 100)
+                {
+                    snap->peers.seeders++;
+                    snap->peers.seeder_download_rate += ps.download_rate;
+                }
+                else
+                {
+                    snap->peers.leechers++;
+                    snap->peers.leecher_download_rate += ps.download_rate;
+                    snap->peers.leecher_upload_rate += ps.upload_rate;
+                }
+            }
         }
-        stats.download_speed = speed_dl;
-        stats.upload_speed = speed_ul;
-        stats.bytes_downloaded = bytes_dl + removed_bytes_down;
-        stats.bytes_uploaded = bytes_ul + removed_bytes_up;
+        snap->totals.bytes_downloaded = bytes_dl + removed_bytes_down;
+        snap->totals.bytes_uploaded = bytes_ul + removed_bytes_up;
+
+        stats_snapshot = StatsSnapshot::Ptr(snap);
+        return stats_snapshot;
+    }
 
-        return stats;
+    void Core::invalidateStatsSnapshot()
+    {
+        stats_version++;
+        // drop it right away, it may point to a torrent which is about to be deleted
+        stats_snapshot.clear();
     }
 
     bool Core::changePort(Uint16 port)
@@ -1330,8 +1564,9 @@ namespace kt
 
     void Core::onStatusChanged(bt::TorrentInterface* tc)
     {
-        Q_UNUSED(tc);
-        if (!reordering_queue)
+        scheduler->add(tc);
+        gman->torrentChanged(tc);
+        if (!reordering_queue && !batch_loading)
             gui->updateActions();
     }
 
@@ -1343,16 +1578,11 @@ namespace kt
     void Core::afterQueueReorder()
     {
         reordering_queue = false;
-        gui->updateActions();
-        gman->updateCount(qman);
+        if (!batch_loading)
+            gui->updateActions();
         startUpdateTimer();
     }
 
-    void Core::customGroupChanged()
-    {
-        gman->updateCount(qman);
-    }
-
 
     void Core::load(const bt::MagnetLink& mlink, const MagnetLinkLoadOptions& options)
     {
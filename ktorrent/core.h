@@ -22,11 +22,15 @@
 #ifndef KTCORE_HH
 #define KTCORE_HH
 
+#include <QElapsedTimer>
 #include <QMap>
+#include <QSet>
+#include <QStringList>
 #include <QTimer>
 
 #include <interfaces/coreinterface.h>
 #include <interfaces/torrentinterface.h>
+#include <util/sha1hash.h>
 
 class QProgressBar;
 
@@ -44,6 +48,8 @@ namespace kt
     class GUI;
     class PluginManager;
     class GroupManager;
+    class UpdateScheduler;
+    class StatsExport;
 
     /**
      * Core of ktorrent, manages every non GUI aspect of the application
@@ -61,6 +67,7 @@ namespace kt
         virtual void startAll();
         virtual void stopAll();
         virtual CurrentStats getStats();
+        virtual StatsSnapshot::Ptr getStatsSnapshot(bool with_peers = false);
         virtual bool changePort(bt::Uint16 port);
         virtual bt::Uint32 getNumTorrentsRunning() const;
         virtual bt::Uint32 getNumTorrentsNotRunning() const;
@@ -68,6 +75,7 @@ namespace kt
         virtual bt::TorrentInterface* load(const QByteArray& data, const QUrl &url, const QString& group, const QString& savedir);
         virtual void loadSilently(const QUrl &url, const QString& group);
         virtual bt::TorrentInterface* loadSilently(const QByteArray& data, const QUrl &url, const QString& group, const QString& savedir);
+        virtual QList<bt::TorrentInterface*> loadSilently(const QList<QPair<QByteArray, QUrl> >& torrents, const QString& group);
         virtual void load(const bt::MagnetLink& mlink, const MagnetLinkLoadOptions& options);
         virtual QString findNewTorrentDir() const;
         virtual void loadExistingTorrent(const QString& tor_dir);
@@ -85,6 +93,9 @@ namespace kt
         /// Get the magnet manager
         kt::MagnetManager* getMagnetManager() {return mman;}
 
+        /// Get the update scheduler (for its timing counters)
+        const kt::UpdateScheduler* getUpdateScheduler() const {return scheduler;}
+
         virtual  bt::TorrentInterface* createTorrent(bt::TorrentCreator* mktor, bool seed);
 
         /**
@@ -166,11 +177,6 @@ namespace kt
         void onMetadataDownloaded(const bt::MagnetLink& mlink, const QByteArray& data, const kt::MagnetLinkLoadOptions& options);
 
     signals:
-        /**
-        * TorrentCore torrents have beed updated. Stats are changed.
-        **/
-        void statsUpdated();
-
         /**
          * Emitted when a torrent has reached it's max share ratio.
          * @param tc The torrent
@@ -237,10 +243,14 @@ namespace kt
         void startUTPServer(bt::Uint16 port);
         bt::TorrentInterface* loadFromFile(const QString& file, const QString& dir, const QString& group, bool silently);
         bt::TorrentInterface* loadFromData(const QByteArray& data, const QString& dir, const QString& group, bool silently, const QUrl& url);
+        void loadExistingTorrent(const QString& tor_dir, const QByteArray& data);
 
     public:
         void loadTorrents();
 
+        /// Whether torrents are still being loaded in the background
+        bool isLoadingTorrents() const;
+
     private slots:
         void torrentFinished(bt::TorrentInterface* tc);
         void slotStoppedByError(bt::TorrentInterface* tc, QString msg);
@@ -251,9 +261,10 @@ namespace kt
         void autoCheckData(bt::TorrentInterface* tc);
         void delayedRemove(bt::TorrentInterface* tc);
         void delayedStart();
+        void loadDeferredTorrents();
         void beforeQueueReorder();
         void afterQueueReorder();
-        void customGroupChanged();
+        void invalidateStatsSnapshot();
         /**
          * KT is exiting, shutdown the core
          */
@@ -265,16 +276,24 @@ namespace kt
         QString data_dir;
         QTimer update_timer;
         bt::Uint64 removed_bytes_up, removed_bytes_down;
+        bt::Uint64 stats_version;
+        StatsSnapshot::Ptr stats_snapshot;
         kt::PluginManager* pman;
         kt::QueueManager* qman;
         kt::GroupManager* gman;
         kt::MagnetManager* mman;
+        kt::UpdateScheduler* scheduler;
+        kt::StatsExport* stats_export;
         QMap<KJob*, QUrl> custom_save_locations; // map to store save locations
         QMap<QUrl, QString> add_to_groups; // Map to keep track of which group to add a torrent to
         int sleep_suppression_cookie;
         QMap<bt::TorrentInterface*, bool> delayed_removal;
         bool exiting;
         bool reordering_queue;
+        bool batch_loading;
+        QStringList deferred_dirs;
+        QSet<bt::SHA1Hash> deferred_hashes;
+        QElapsedTimer deferred_timer;
     };
 }
 
@@ -61,7 +61,7 @@ namespace kt
         if (!group)
             return true;
         else
-            return group->isMember(view_model->torrentFromRow(source_row));
+            return group->contains(view_model->torrentFromRow(source_row));
     }
 
 }
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include "startuploader.h"
+
+#include <QFile>
+#include <QRunnable>
+#include <QThread>
+
+#include <util/error.h>
+#include <util/fileops.h>
+#include <util/functions.h>
+
+namespace kt
+{
+    namespace
+    {
+        class ReadTask : public QRunnable
+        {
+        public:
+            ReadTask(StartupLoader* loader, int idx) : loader(loader), idx(idx)
+            {}
+
+            virtual void run()
+            {
+                loader->read(idx);
+            }
+
+        private:
+            StartupLoader* loader;
+            int idx;
+        };
+    }
+
+    StartupLoader::StartupLoader(const QStringList& dirs)
+    {
+        entries.resize(dirs.count());
+        for (int i = 0; i < dirs.count(); i++)
+        {
+            Entry& e = entries[i];
+            e.dir = dirs.at(i);
+            if (!e.dir.endsWith(bt::DirSeparator()))
+                e.dir.append(bt::DirSeparator());
+            e.missing = false;
+            e.done = false;
+        }
+
+        // reading is mostly waiting on the disk, so a few more threads than cores do no harm
+        pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() * 2, 16));
+    }
+
+    StartupLoader::~StartupLoader()
+    {
+        pool.waitForDone();
+    }
+
+    void StartupLoader::start()
+    {
+        for (int i = 0; i < entries.count(); i++)
+            pool.start(new ReadTask(this, i));
+    }
+
+    void StartupLoader::read(int idx)
+    {
+        QString dir;
+        {
+            QMutexLocker lock(&mutex);
+            dir = entries[idx].dir;
+        }
+
+        QByteArray data;
+        QString error;
+        bool missing = false;
+        try
+        {
+            QString torrent = dir + QLatin1String("torrent");
+            if (!bt::Exists(torrent))
+            {
+                missing = true;
+            }
+            else
+            {
+                data = bt::LoadFile(torrent);
+
+                // Pull the stats file in the page cache as well, TorrentControl::init will need it shortly
+                QFile stats(dir + QLatin1String("stats"));
+                if (stats.open(QIODevice::ReadOnly))
+                    stats.readAll();
+            }
+        }
+        catch (bt::Error& err)
+        {
+            error = err.toString();
+        }
+
+        QMutexLocker lock(&mutex);
+        Entry& e = entries[idx];
+        e.data = data;
+        e.error = error;
+        e.missing = missing;
+        e.done = true;
+        ready.wakeAll();
+    }
+
+    StartupLoader::Entry StartupLoader::take(int idx)
+    {
+        QMutexLocker lock(&mutex);
+        while (!entries[idx].done)
+            ready.wait(&mutex);
+
+        Entry ret = entries[idx];
+        entries[idx].data = QByteArray();
+        return ret;
+    }
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_STARTUPLOADER_HH
+#define KT_STARTUPLOADER_HH
+
+#include <QByteArray>
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+namespace kt
+{
+    /**
+     * Reads the torrent files of all torrent directories on a thread pool at startup,
+     * so that the disk reads overlap with initializing the torrents in the GUI thread.
+     * Only the reading is done in parallel: TorrentControl::init takes the raw data
+     * and decodes it itself, so the bencode parsing still happens in the GUI thread.
+     */
+    class StartupLoader
+    {
+    public:
+        struct Entry
+        {
+            QString dir;
+            QByteArray data;
+            QString error;
+            bool missing;
+            bool done;
+        };
+
+        StartupLoader(const QStringList& dirs);
+        ~StartupLoader();
+
+        /// Queue reading all the torrent files
+        void start();
+
+        /// Get the number of torrent directories
+        int count() const {return entries.count();}
+
+        /**
+         * Wait until the files of a torrent directory have been read.
+         * Entries must be taken in order, the data is moved out of the loader.
+         * @param idx Index of the torrent directory
+         */
+        Entry take(int idx);
+
+        /// Read the files of a torrent directory (called from the thread pool)
+        void read(int idx);
+
+    private:
+        QVector<Entry> entries;
+        QMutex mutex;
+        QWaitCondition ready;
+        QThreadPool pool;
+    };
+}
+
+#endif
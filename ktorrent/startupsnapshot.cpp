@@ -0,0 +1,193 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include "startupsnapshot.h"
+
+#include <string.h>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <interfaces/torrentinterface.h>
+#include <torrent/queuemanager.h>
+#include <util/fileops.h>
+#include <util/functions.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+using namespace bt;
+
+namespace kt
+{
+    const Uint32 SNAPSHOT_MAGIC = 0x5353544B; // KTSS
+    const Uint32 SNAPSHOT_VERSION = 2;
+
+    static void FileValidators(const QString& path, Int64& mtime, Uint64& size)
+    {
+        QFileInfo fi(path);
+        if (fi.exists())
+        {
+            mtime = fi.lastModified().toMSecsSinceEpoch();
+            size = fi.size();
+        }
+        else
+        {
+            mtime = -1;
+            size = 0;
+        }
+    }
+
+    StartupSnapshot::StartupSnapshot() : records(0), strings(0), num_records(0), strings_size(0)
+    {}
+
+    StartupSnapshot::~StartupSnapshot()
+    {}
+
+    void StartupSnapshot::collect(QueueManager* qman)
+    {
+        out_records.clear();
+        out_strings.clear();
+        out_dirs.clear();
+        out_records.reserve(qman->count() * sizeof(Record));
+
+        for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++)
+        {
+            bt::TorrentInterface* tc = *i;
+            const TorrentStats& s = tc->getStats();
+
+            QString dir = tc->getTorDir();
+            if (!dir.endsWith(bt::DirSeparator()))
+                dir += bt::DirSeparator();
+
+            QByteArray dir_utf8 = dir.toUtf8();
+
+            Record r;
+            memset(&r, 0, sizeof(Record));
+            memcpy(r.info_hash, tc->getInfoHash().getData(), 20);
+            r.flags = (s.running ? RUNNING : 0) |
+                      (tc->isAllowedToStart() ? ALLOWED_TO_START : 0) |
+                      (s.autostart ? AUTOSTART : 0);
+            r.dir_offset = out_strings.size();
+            r.dir_length = dir_utf8.size();
+            out_strings.append(dir_utf8);
+
+            out_records.append((const char*)&r, sizeof(Record));
+            out_dirs.append(dir);
+        }
+    }
+
+    bool StartupSnapshot::save(const QString& path)
+    {
+        // the stats files are written when the torrents are stopped, so the validators are taken now
+        Record* r = (Record*)out_records.data();
+        for (const QString& dir : qAsConst(out_dirs))
+        {
+            FileValidators(dir + QLatin1String("torrent"), r->torrent_mtime, r->torrent_size);
+            FileValidators(dir + QLatin1String("stats"), r->stats_mtime, r->stats_size);
+            r++;
+        }
+
+        Header hdr;
+        hdr.magic = SNAPSHOT_MAGIC;
+        hdr.version = SNAPSHOT_VERSION;
+        hdr.num_records = out_dirs.count();
+        hdr.record_size = sizeof(Record);
+
+        QSaveFile fptr(path);
+        if (!fptr.open(QIODevice::WriteOnly))
+        {
+            Out(SYS_GEN | LOG_IMPORTANT) << "Failed to write startup snapshot " << path << " : " << fptr.errorString() << endl;
+            return false;
+        }
+
+        fptr.write((const char*)&hdr, sizeof(Header));
+        fptr.write(out_records);
+        fptr.write(out_strings);
+        return fptr.commit();
+    }
+
+    bool StartupSnapshot::load(const QString& path)
+    {
+        if (!file.open(path, QIODevice::ReadOnly))
+            return false;
+
+        Uint64 size = file.getSize();
+        const Uint8* data = file.getData(0);
+        if (!data || size < sizeof(Header))
+        {
+            file.close();
+            return false;
+        }
+
+        const Header* hdr = (const Header*)data;
+        if (hdr->magic != SNAPSHOT_MAGIC || hdr->version != SNAPSHOT_VERSION || hdr->record_size != sizeof(Record) ||
+                sizeof(Header) + (Uint64)hdr->num_records * sizeof(Record) > size)
+        {
+            Out(SYS_GEN | LOG_NOTICE) << "Ignoring startup snapshot " << path << " : unsupported format" << endl;
+            file.close();
+            return false;
+        }
+
+        num_records = hdr->num_records;
+        records = (const Record*)(data + sizeof(Header));
+        strings = (const char*)(records + num_records);
+        strings_size = size - sizeof(Header) - num_records * sizeof(Record);
+
+        dir_index.reserve(num_records);
+        for (Uint32 i = 0; i < num_records; i++)
+        {
+            const Record& r = records[i];
+            if ((Uint64)r.dir_offset + r.dir_length > strings_size)
+                continue;
+
+            dir_index.insert(QString::fromUtf8(strings + r.dir_offset, r.dir_length), i);
+        }
+
+        return true;
+    }
+
+    const StartupSnapshot::Record* StartupSnapshot::find(const QString& tor_dir) const
+    {
+        QHash<QString, Uint32>::const_iterator i = dir_index.find(tor_dir);
+        if (i == dir_index.end())
+            return 0;
+
+        const Record* r = records + i.value();
+        return validate(r, tor_dir) ? r : 0;
+    }
+
+    bool StartupSnapshot::validate(const Record* r, const QString& tor_dir) const
+    {
+        Int64 mtime = 0;
+        Uint64 size = 0;
+        FileValidators(tor_dir + QLatin1String("torrent"), mtime, size);
+        if (mtime != r->torrent_mtime || size != r->torrent_size)
+            return false;
+
+        FileValidators(tor_dir + QLatin1String("stats"), mtime, size);
+        return mtime == r->stats_mtime && size == r->stats_size;
+    }
+
+    bool StartupSnapshot::idle(const Record* r)
+    {
+        return (r->flags & (RUNNING | ALLOWED_TO_START | AUTOSTART)) == 0;
+    }
+}
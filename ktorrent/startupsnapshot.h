@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_STARTUPSNAPSHOT_HH
+#define KT_STARTUPSNAPSHOT_HH
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+
+#include <util/constants.h>
+#include <util/mmapfile.h>
+
+namespace kt
+{
+    class QueueManager;
+
+    /**
+     * Compact summary of all loaded torrents, written on a clean exit and mmapped at the next startup.
+     * It tells which torrents were idle (not running and not going to be started), so that loading them
+     * can be postponed until after the GUI is up. Every record carries the size and modification time of the
+     * torrent and stats file, records whose files have changed since are ignored.
+     * The snapshot only decides the order in which torrents are loaded, everything shown
+     * about a torrent still comes from fully loading it.
+     */
+    class StartupSnapshot
+    {
+    public:
+        enum Flags
+        {
+            RUNNING = 1,
+            ALLOWED_TO_START = 2,
+            AUTOSTART = 4
+        };
+
+        struct Header
+        {
+            bt::Uint32 magic;
+            bt::Uint32 version;
+            bt::Uint32 num_records;
+            bt::Uint32 record_size;
+        };
+
+        struct Record
+        {
+            bt::Uint8 info_hash[20];
+            bt::Uint32 flags;
+            bt::Int64 torrent_mtime;
+            bt::Uint64 torrent_size;
+            bt::Int64 stats_mtime;
+            bt::Uint64 stats_size;
+            bt::Uint32 dir_offset; // offset and length into the string table (UTF-8)
+            bt::Uint32 dir_length;
+        };
+
+        StartupSnapshot();
+        ~StartupSnapshot();
+
+        /**
+         * Remember the state of all torrents, must be done before they are stopped on exit.
+         * @param qman The QueueManager
+         */
+        void collect(QueueManager* qman);
+
+        /**
+         * Write the collected state to a file, the file validators are taken at this point.
+         * @param file The file
+         * @return true upon success
+         */
+        bool save(const QString& file);
+
+        /**
+         * Open and map a snapshot.
+         * @param file The file
+         * @return true if the file is a valid snapshot
+         */
+        bool load(const QString& file);
+
+        /// Get the number of records
+        bt::Uint32 count() const {return num_records;}
+
+        /**
+         * Find the record of a torrent directory.
+         * @param tor_dir The torrent directory (ending with a separator)
+         * @return The record, or 0 if there is none or the files have changed since it was written
+         */
+        const Record* find(const QString& tor_dir) const;
+
+        /**
+         * Check whether a torrent was idle at exit, it was not running and will not be started automatically.
+         */
+        static bool idle(const Record* r);
+
+    private:
+        bool validate(const Record* r, const QString& tor_dir) const;
+
+    private:
+        bt::MMapFile file;
+        const Record* records;
+        const char* strings;
+        bt::Uint32 num_records;
+        bt::Uint32 strings_size;
+        QHash<QString, bt::Uint32> dir_index;
+
+        QByteArray out_records;
+        QByteArray out_strings;
+        QList<QString> out_dirs;
+    };
+}
+
+#endif
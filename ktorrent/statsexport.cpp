@@ -0,0 +1,193 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include "statsexport.h"
+
+#include <string.h>
+#include <atomic>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QStandardPaths>
+
+#include <interfaces/functions.h>
+#include <interfaces/torrentinterface.h>
+#include <util/log.h>
+#include <util/sha1hash.h>
+
+using namespace bt;
+
+namespace kt
+{
+    const Uint32 EXPORT_MAGIC = 0x4553544B; // KTSE
+    const Uint32 EXPORT_VERSION = 1;
+    const Uint32 EXPORT_MIN_CAPACITY = 64;
+
+    Q_STATIC_ASSERT(sizeof(StatsExport::Header) == 128);
+    Q_STATIC_ASSERT(sizeof(StatsExport::Record) == 128);
+
+    StatsExport::StatsExport() : hdr(0), records(0), capacity(0)
+    {}
+
+    StatsExport::~StatsExport()
+    {
+        close();
+    }
+
+    QString StatsExport::defaultPath()
+    {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+        if (dir.isEmpty())
+            return kt::DataDir() + QStringLiteral("stats.shm");
+        else
+            return dir + QStringLiteral("/ktorrent-stats.shm");
+    }
+
+    bool StatsExport::open(const QString& path)
+    {
+        close();
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        {
+            Out(SYS_GEN | LOG_NOTICE) << "Failed to open " << path << " : " << file.errorString() << endl;
+            return false;
+        }
+
+        if (!resize(EXPORT_MIN_CAPACITY))
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void StatsExport::close()
+    {
+        if (!file.isOpen())
+            return;
+
+        if (hdr)
+            file.unmap((uchar*)hdr);
+
+        hdr = 0;
+        records = 0;
+        capacity = 0;
+        file.close();
+        file.remove();
+    }
+
+    bool StatsExport::resize(Uint32 cap)
+    {
+        Uint64 sequence = hdr ? hdr->sequence.load() : 0;
+        if (hdr)
+        {
+            file.unmap((uchar*)hdr);
+            hdr = 0;
+            records = 0;
+        }
+
+        // Existing readers keep their (smaller) mapping, everything in it stays valid
+        qint64 size = sizeof(Header) + (qint64)cap * sizeof(Record);
+        uchar* data = 0;
+        if (!file.resize(size) || !(data = file.map(0, size)))
+        {
+            Out(SYS_GEN | LOG_NOTICE) << "Failed to map " << file.fileName() << " : " << file.errorString() << endl;
+            capacity = 0;
+            return false;
+        }
+
+        hdr = (Header*)data;
+        records = (Record*)(data + sizeof(Header));
+        capacity = cap;
+        hdr->magic = EXPORT_MAGIC;
+        hdr->version = EXPORT_VERSION;
+        hdr->header_size = sizeof(Header);
+        hdr->record_size = sizeof(Record);
+        hdr->capacity = capacity;
+        hdr->file_size = size;
+        hdr->pid = QCoreApplication::applicationPid();
+        hdr->sequence.store(sequence);
+        return true;
+    }
+
+    void StatsExport::update(const StatsSnapshot& snap)
+    {
+        if (!hdr)
+            return;
+
+        Uint32 n = snap.torrents.size();
+        Uint64 sequence = hdr->sequence.load();
+        // Odd sequence number: readers must retry, the fence keeps the data writes behind it
+        hdr->sequence.store(sequence + 1);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (n > capacity)
+        {
+            Uint32 cap = capacity;
+            while (cap < n)
+                cap *= 2;
+
+            if (!resize(cap))
+            {
+                close();
+                return;
+            }
+        }
+
+        hdr->tick = snap.version;
+        hdr->timestamp = QDateTime::currentMSecsSinceEpoch();
+        hdr->download_speed = snap.totals.download_speed;
+        hdr->upload_speed = snap.totals.upload_speed;
+        hdr->bytes_downloaded = snap.totals.bytes_downloaded;
+        hdr->bytes_uploaded = snap.totals.bytes_uploaded;
+        hdr->num_running = snap.num_running;
+        hdr->num_torrents = n;
+
+        Record* r = records;
+        for (QVector<TorrentSnapshot>::const_iterator i = snap.torrents.begin(); i != snap.torrents.end(); i++, r++)
+        {
+            const TorrentStats& s = i->stats;
+            memcpy(r->info_hash, i->tc->getInfoHash().getData(), 20);
+            r->status = s.status;
+            r->flags = (s.running ? RUNNING : 0) | (s.completed ? COMPLETED : 0) |
+                       (s.stopped_by_error ? STOPPED_BY_ERROR : 0) | (s.paused ? PAUSED : 0);
+            r->download_rate = s.download_rate;
+            r->upload_rate = s.upload_rate;
+            r->num_peers = s.num_peers;
+            r->seeders_connected_to = s.seeders_connected_to;
+            r->seeders_total = s.seeders_total;
+            r->leechers_connected_to = s.leechers_connected_to;
+            r->leechers_total = s.leechers_total;
+            r->total_chunks = s.total_chunks;
+            r->num_chunks_downloaded = s.num_chunks_downloaded;
+            r->bytes_downloaded = s.bytes_downloaded;
+            r->bytes_uploaded = s.bytes_uploaded;
+            r->total_bytes = s.total_bytes;
+            r->total_bytes_to_download = s.total_bytes_to_download;
+            r->bytes_left_to_download = s.bytes_left_to_download;
+            r->session_bytes_downloaded = s.session_bytes_downloaded;
+            r->session_bytes_uploaded = s.session_bytes_uploaded;
+            r->reserved = 0;
+        }
+
+        hdr->sequence.storeRelease(sequence + 2);
+    }
+}
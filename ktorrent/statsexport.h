@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_STATSEXPORT_HH
+#define KT_STATSEXPORT_HH
+
+#include <QAtomicInteger>
+#include <QFile>
+#include <QString>
+
+#include <util/constants.h>
+#include <interfaces/statssnapshot.h>
+
+namespace kt
+{
+    /**
+     * Publishes the global and per torrent statistics in a memory mapped file, so that local monitoring
+     * agents can read them without DBus round trips.
+     *
+     * The file starts with a Header followed by capacity Records, all fields are in host byte order.
+     * The contents are protected by a sequence lock: the sequence number is odd while the file is being written.
+     * A reader copies what it needs between two reads of the sequence number and retries if they differ or are odd.
+     * The file can grow, a reader must remap when file_size is larger than its mapping.
+     * Readers must check magic and version, a new version means a different layout.
+     */
+    class StatsExport
+    {
+    public:
+        enum Flags
+        {
+            RUNNING = 1,
+            COMPLETED = 2,
+            STOPPED_BY_ERROR = 4,
+            PAUSED = 8
+        };
+
+        struct Header
+        {
+            bt::Uint32 magic;
+            bt::Uint32 version;
+            bt::Uint32 header_size;
+            bt::Uint32 record_size;
+            bt::Uint32 capacity;
+            bt::Uint32 num_torrents;
+            bt::Uint64 file_size;
+            QBasicAtomicInteger<bt::Uint64> sequence;
+            bt::Uint64 tick; // version of the stats snapshot
+            bt::Int64 timestamp; // ms since the epoch of the last update
+            bt::Uint32 download_speed;
+            bt::Uint32 upload_speed;
+            bt::Uint64 bytes_downloaded;
+            bt::Uint64 bytes_uploaded;
+            bt::Uint32 num_running;
+            bt::Uint32 pid;
+            bt::Uint8 reserved[40];
+        };
+
+        struct Record
+        {
+            bt::Uint8 info_hash[20];
+            bt::Uint32 status; // bt::TorrentStatus
+            bt::Uint32 flags;
+            bt::Uint32 download_rate;
+            bt::Uint32 upload_rate;
+            bt::Uint32 num_peers;
+            bt::Uint32 seeders_connected_to;
+            bt::Uint32 seeders_total;
+            bt::Uint32 leechers_connected_to;
+            bt::Uint32 leechers_total;
+            bt::Uint32 total_chunks;
+            bt::Uint32 num_chunks_downloaded;
+            bt::Uint64 bytes_downloaded;
+            bt::Uint64 bytes_uploaded;
+            bt::Uint64 total_bytes;
+            bt::Uint64 total_bytes_to_download;
+            bt::Uint64 bytes_left_to_download;
+            bt::Uint64 session_bytes_downloaded;
+            bt::Uint64 session_bytes_uploaded;
+            bt::Uint64 reserved;
+        };
+
+        StatsExport();
+        ~StatsExport();
+
+        /**
+         * Create the file and map it.
+         * @param path Path of the file
+         * @return true upon success
+         */
+        bool open(const QString& path);
+
+        /// Unmap and remove the file
+        void close();
+
+        /// Write a snapshot into the file
+        void update(const StatsSnapshot& snap);
+
+        /// Get the path of the file
+        QString path() const {return file.fileName();}
+
+        /// Default location, the runtime dir (usually a tmpfs) if there is one, the data dir otherwise
+        static QString defaultPath();
+
+    private:
+        bool resize(bt::Uint32 capacity);
+
+    private:
+        QFile file;
+        Header* hdr;
+        Record* records;
+        bt::Uint32 capacity;
+    };
+}
+
+#endif
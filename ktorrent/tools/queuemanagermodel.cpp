@@ -369,7 +369,7 @@ namespace kt
         }
 
 
-        updatePriorities();
+        updatePriorities(from, count);
         // reorder the queue
         qman->orderQueue();
         endResetModel();
@@ -402,7 +402,7 @@ namespace kt
             swapItems(row + i, row + i - 1);
         }
 
-        updatePriorities();
+        updatePriorities(row - 1, count);
         //dumpQueue();
         // reorder the queue
         qman->orderQueue();
@@ -419,7 +419,7 @@ namespace kt
             swapItems(row + i, row + i + 1);
         }
 
-        updatePriorities();
+        updatePriorities(row + 1, count);
         //dumpQueue();
         // reorder the queue
         qman->orderQueue();
@@ -440,7 +440,7 @@ namespace kt
             row--;
         }
 
-        updatePriorities();
+        updatePriorities(row, count);
         //dumpQueue();
         // reorder the queue
         qman->orderQueue();
@@ -461,7 +461,7 @@ namespace kt
             row++;
         }
 
-        updatePriorities();
+        updatePriorities(row, count);
         //dumpQueue();
         // reorder the queue
         qman->orderQueue();
@@ -478,11 +478,16 @@ namespace kt
         }
     }
 
-    void QueueManagerModel::updatePriorities()
+    void QueueManagerModel::updatePriorities(int row, int count)
     {
-        int idx = queue.size();
-        for (QList<Item>::iterator i = queue.begin(); i != queue.end(); i++)
-            i->tc->setPriority(idx--);
+        // Only the moved torrents get a new priority, they are placed right
+        // after the torrent which is now above them, the rest keeps its priority.
+        bt::TorrentInterface* after = row > 0 && row <= queue.count() ? queue.at(row - 1).tc : 0;
+        for (int i = qMax(row, 0); i < row + count && i < queue.count(); i++)
+        {
+            qman->moveTorrent(queue.at(i).tc, after);
+            after = queue.at(i).tc;
+        }
     }
 
     void QueueManagerModel::update()
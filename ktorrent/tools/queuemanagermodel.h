@@ -126,7 +126,7 @@ namespace kt
         void updateQueue();
         void swapItems(int a, int b);
         void dumpQueue();
-        void updatePriorities();
+        void updatePriorities(int row, int count);
         void softReset();
 
     private:
@@ -0,0 +1,135 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include "updatescheduler.h"
+
+#include <QElapsedTimer>
+
+#include <interfaces/torrentinterface.h>
+#include <torrent/queuemanager.h>
+
+using namespace bt;
+
+namespace kt
+{
+    const Uint32 UpdateScheduler::IDLE_SHARDS;
+
+    UpdateScheduler::UpdateScheduler() : next_shard(0)
+    {
+        counters.ticks = 0;
+        counters.running = 0;
+        counters.idle = 0;
+        counters.updated = 0;
+        counters.last_tick_us = 0;
+        counters.max_tick_us = 0;
+        counters.avg_tick_us = 0;
+    }
+
+    UpdateScheduler::~UpdateScheduler()
+    {}
+
+    void UpdateScheduler::add(bt::TorrentInterface* tc)
+    {
+        if (!tc->getStats().running || positions.contains(tc))
+            return;
+
+        Entry e;
+        e.tc = tc;
+        e.shard = next_shard;
+        next_shard = (next_shard + 1) % IDLE_SHARDS;
+        positions.insert(tc, running.count());
+        running.append(e);
+    }
+
+    void UpdateScheduler::remove(bt::TorrentInterface* tc)
+    {
+        QHash<bt::TorrentInterface*, int>::iterator i = positions.find(tc);
+        if (i != positions.end())
+            removeAt(i.value());
+    }
+
+    void UpdateScheduler::removeAt(int idx)
+    {
+        // move the last one in the hole, the order does not matter
+        positions.remove(running[idx].tc);
+        int last = running.count() - 1;
+        if (idx != last)
+        {
+            running[idx] = running[last];
+            positions[running[idx].tc] = idx;
+        }
+        running.resize(last);
+    }
+
+    void UpdateScheduler::resync(QueueManager* qman)
+    {
+        for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++)
+            add(*i);
+    }
+
+    void UpdateScheduler::clear()
+    {
+        running.clear();
+        positions.clear();
+    }
+
+    bool UpdateScheduler::update()
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        Uint32 shard = counters.ticks % IDLE_SHARDS;
+        Uint32 idle = 0;
+        Uint32 updated = 0;
+
+        // walk backwards, so torrents which have stopped can be removed while iterating
+        for (int i = running.count() - 1; i >= 0; i--)
+        {
+            const Entry& e = running[i];
+            const TorrentStats& s = e.tc->getStats();
+            if (!s.running)
+            {
+                removeAt(i);
+                continue;
+            }
+
+            bool idle_seeder = s.completed && s.seeders_connected_to + s.leechers_connected_to == 0;
+            if (idle_seeder)
+                idle++;
+
+            if (!idle_seeder || e.shard == shard)
+            {
+                e.tc->update();
+                updated++;
+            }
+        }
+
+        Int64 elapsed = timer.nsecsElapsed() / 1000;
+        counters.ticks++;
+        counters.running = running.count();
+        counters.idle = idle;
+        counters.updated = updated;
+        counters.last_tick_us = elapsed;
+        if (elapsed > counters.max_tick_us)
+            counters.max_tick_us = elapsed;
+        counters.avg_tick_us = counters.ticks == 1 ? elapsed : (counters.avg_tick_us * 7 + elapsed) / 8;
+        return !running.isEmpty();
+    }
+}
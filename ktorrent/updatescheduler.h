@@ -0,0 +1,107 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_UPDATESCHEDULER_HH
+#define KT_UPDATESCHEDULER_HH
+
+#include <QHash>
+#include <QVector>
+
+#include <util/constants.h>
+
+namespace bt
+{
+    class TorrentInterface;
+}
+
+namespace kt
+{
+    class QueueManager;
+
+    /**
+     * Decides which torrents get updated on a tick of the core update timer.
+     * It keeps an explicit set of running torrents, so stopped torrents cost nothing.
+     * Torrents which are busy are updated every tick, seeders without any peers are
+     * spread over IDLE_SHARDS ticks so each of them is updated at a slower cadence and the
+     * amount of work per tick stays bounded, even with thousands of running seeds.
+     */
+    class UpdateScheduler
+    {
+    public:
+        /// Timing counters of the scheduler
+        struct Stats
+        {
+            bt::Uint64 ticks;
+            bt::Uint32 running; // number of running torrents after the last tick
+            bt::Uint32 idle; // number of those which were idle seeders
+            bt::Uint32 updated; // number of torrents updated in the last tick
+            bt::Int64 last_tick_us;
+            bt::Int64 max_tick_us;
+            bt::Int64 avg_tick_us; // moving average
+        };
+
+        /// Number of ticks idle seeders are spread over
+        static const bt::Uint32 IDLE_SHARDS = 4;
+
+        UpdateScheduler();
+        ~UpdateScheduler();
+
+        /// Add a torrent to the running set, if it is running
+        void add(bt::TorrentInterface* tc);
+
+        /// Remove a torrent from the running set
+        void remove(bt::TorrentInterface* tc);
+
+        /// Add all running torrents of the QueueManager
+        void resync(QueueManager* qman);
+
+        /// Clear the running set
+        void clear();
+
+        /**
+         * Update the torrents due on this tick, torrents which are no longer running are dropped.
+         * @return true if there are still running torrents
+         */
+        bool update();
+
+        /// Get the number of running torrents
+        int count() const {return running.count();}
+
+        /// Get the timing counters
+        const Stats& stats() const {return counters;}
+
+    private:
+        void removeAt(int idx);
+
+    private:
+        struct Entry
+        {
+            bt::TorrentInterface* tc;
+            bt::Uint32 shard;
+        };
+
+        QVector<Entry> running;
+        QHash<bt::TorrentInterface*, int> positions;
+        bt::Uint32 next_shard;
+        Stats counters;
+    };
+}
+
+#endif
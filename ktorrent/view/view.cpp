@@ -25,6 +25,7 @@
 #include <QFileInfo>
 #include <QDropEvent>
 #include <QDragEnterEvent>
+#include <QElapsedTimer>
 #include <QHeaderView>
 #include <QMenu>
 #include <QSortFilterProxyModel>
@@ -63,6 +64,8 @@ using namespace bt;
 
 namespace kt
 {
+    /// Number of paints after which the paint time counters are logged
+    const Uint64 PAINT_STATS_LOG_INTERVAL = 100;
 
     View::View(Core* core, GUI* gui, QWidget* parent)
         : QTreeView(parent),
@@ -71,7 +74,8 @@ namespace kt
           group(core->getGroupManager()->allGroup()),
           num_torrents(0),
           num_running(0),
-          model(0)
+          model(0),
+          paint_stats()
     {
         new ViewJobTracker(this);
 
@@ -399,6 +403,10 @@ namespace kt
 
     void View::update()
     {
+        // Nobody can see it, showEvent brings it up to date again
+        if (!isVisible() || window()->isMinimized())
+            return;
+
         if (!uniformRowHeights() && !delegate->hasExtenders())
             setUniformRowHeights(true);
 
@@ -430,10 +438,10 @@ namespace kt
         if (qm->enabled())
         {
             // Give everybody in the selection a high priority
-            int prio = qm->count();
+            int prio = qm->highestPriority();
             int idx = 0;
             foreach (bt::TorrentInterface* tc, sel)
-                tc->setPriority(prio + sel.count() - idx++);
+                qm->setPriority(tc, prio + sel.count() - idx++);
 
             core->start(sel);
         }
@@ -774,7 +782,7 @@ namespace kt
     {
         setUniformRowHeights(false);
         delegate->extend(tc, widget, close_similar);
-        if (group && !group->isMember(tc))
+        if (group && !group->contains(tc))
             delegate->hideExtender(tc);
     }
 
@@ -907,6 +915,33 @@ namespace kt
         model->update(delegate);
     }
 
+    void View::showEvent(QShowEvent* event)
+    {
+        QTreeView::showEvent(event);
+        update();
+    }
+
+    void View::paintEvent(QPaintEvent* event)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QTreeView::paintEvent(event);
+
+        Uint64 us = timer.nsecsElapsed() / 1000;
+        paint_stats.frames++;
+        paint_stats.last_us = us;
+        paint_stats.total_us += us;
+        if (us > paint_stats.max_us)
+            paint_stats.max_us = us;
+
+        if (paint_stats.frames % PAINT_STATS_LOG_INTERVAL == 0)
+        {
+            Out(SYS_GEN | LOG_DEBUG) << "View painted " << paint_stats.frames << " times, average "
+                                     << paint_stats.total_us / paint_stats.frames << " us, max "
+                                     << paint_stats.max_us << " us, last " << paint_stats.last_us << " us" << endl;
+        }
+    }
+
     void View::keyPressEvent(QKeyEvent* event)
     {
         if (event->key() == Qt::Key_Delete)
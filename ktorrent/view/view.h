@@ -106,6 +106,22 @@ namespace kt
 
         virtual void keyPressEvent(QKeyEvent* event);
 
+        /// Time spent painting the view, logged at debug level every 100 paints
+        struct PaintStats
+        {
+            bt::Uint64 frames;
+            bt::Uint64 last_us;
+            bt::Uint64 max_us;
+            bt::Uint64 total_us;
+        };
+
+        /// Get the paint time counters
+        const PaintStats& paintStats() const {return paint_stats;}
+
+    protected:
+        virtual void paintEvent(QPaintEvent* event);
+        virtual void showEvent(QShowEvent* event);
+
     public slots:
         /// Set the filter string
         void setFilterString(const QString& filter);
@@ -178,6 +194,7 @@ namespace kt
         ViewDelegate* delegate;
         QMap<bt::TorrentInterface*, Extender*> data_scan_extenders;
         QByteArray default_state;
+        PaintStats paint_stats;
 
         // actions for the view menu
         QAction * start_torrent;
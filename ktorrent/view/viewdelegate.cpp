@@ -25,6 +25,8 @@
 
 #include <QApplication>
 #include <QLocale>
+#include <QPainter>
+#include <QPixmapCache>
 #include <QRect>
 #include <QVBoxLayout>
 
@@ -228,15 +230,6 @@ namespace kt
 
     void ViewDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
     {
-        QStyleOptionViewItem indicatorOption(option);
-        initStyleOption(&indicatorOption, index);
-        if (index.column() == 0)
-            indicatorOption.viewItemPosition = QStyleOptionViewItem::Beginning;
-        else if (index.column() == index.model()->columnCount() - 1)
-            indicatorOption.viewItemPosition = QStyleOptionViewItem::End;
-        else
-            indicatorOption.viewItemPosition = QStyleOptionViewItem::Middle;
-
         QStyleOptionViewItem itemOption(option);
         initStyleOption(&itemOption, index);
         if (index.column() == 0)
@@ -267,7 +260,6 @@ namespace kt
         //the downside is, of course, that an api user effectively can't hide it.
         extender->show();
 
-        indicatorOption.rect.setHeight(option.rect.height() - extenderHeight);
         itemOption.rect.setHeight(option.rect.height() - extenderHeight);
         //tricky:make sure that the modified options' rect really has the
         //same height as the unchanged option.rect if no extender is present
@@ -362,19 +354,42 @@ namespace kt
     void ViewDelegate::paintProgressBar(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
     {
         int progress = index.data().toInt();
+        qreal dpr = painter->device()->devicePixelRatioF();
+
+        // Many rows show the same progress, so the bars are drawn once and cached as pixmaps
+        QString key = QStringLiteral("kt_progressbar_%1_%2x%3_%4_%5_%6_%7")
+                      .arg(progress)
+                      .arg(option.rect.width())
+                      .arg(option.rect.height())
+                      .arg((int)option.state)
+                      .arg((int)option.direction)
+                      .arg(option.palette.cacheKey())
+                      .arg(dpr);
+
+        QPixmap pixmap;
+        if (!QPixmapCache::find(key, &pixmap))
+        {
+            QStyleOptionProgressBar progressBarOption;
+            progressBarOption.palette = option.palette;
+            progressBarOption.state = option.state;
+            progressBarOption.rect = QRect(QPoint(0, 0), option.rect.size());
+            progressBarOption.minimum = 0;
+            progressBarOption.maximum = 100;
+            progressBarOption.progress = progress;
+            progressBarOption.text = QLocale().toString(progress) + QLatin1Char('%');
+            progressBarOption.textVisible = true;
+            progressBarOption.direction = option.direction;
+
+            pixmap = QPixmap(option.rect.size() * dpr);
+            pixmap.setDevicePixelRatio(dpr);
+            pixmap.fill(Qt::transparent);
+            QPainter p(&pixmap);
+            QApplication::style()->drawControl(QStyle::CE_ProgressBar, &progressBarOption, &p);
+            p.end();
+            QPixmapCache::insert(key, pixmap);
+        }
 
-        QStyleOptionProgressBar progressBarOption;
-        progressBarOption.palette = option.palette;
-        progressBarOption.state = option.state;
-        progressBarOption.rect = option.rect;
-        progressBarOption.minimum = 0;
-        progressBarOption.maximum = 100;
-        progressBarOption.progress = progress;
-        progressBarOption.text = QLocale().toString(progress) + QLatin1Char('%');
-        progressBarOption.textVisible = true;
-        progressBarOption.direction = option.direction;
-
-        QApplication::style()->drawControl(QStyle::CE_ProgressBar, &progressBarOption, painter);
+        painter->drawPixmap(option.rect.topLeft(), pixmap);
     }
 
 
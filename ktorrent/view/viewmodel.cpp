@@ -24,10 +24,12 @@
 
 #include <QBrush>
 #include <QColor>
+#include <QHash>
 #include <QIcon>
 #include <QLocale>
 #include <QMimeData>
 #include <QPalette>
+#include <QTimer>
 
 #include <KLocalizedString>
 
@@ -39,6 +41,7 @@
 #include <torrent/timeestimator.h>
 #include <torrent/queuemanager.h>
 #include <groups/group.h>
+#include <groups/groupmanager.h>
 #include "core.h"
 #include "viewdelegate.h"
 #include "view.h"
@@ -69,20 +72,31 @@ namespace kt
         share_ratio = s.shareRatio();
         runtime_dl = tc->getRunningTimeDL();
         runtime_ul = tc->getRunningTimeUL() - tc->getRunningTimeDL();
-        hidden = false;
+        running = s.running;
+        completed = s.completed;
+        hidden = true;
         time_added = s.time_added;
         highlight = false;
+        filter_match = true;
+        member = true;
+        visibility_dirty = true;
+        stats_changed = false;
+        pending = false;
+        display_valid = 0;
     }
 
 
     bool ViewModel::Item::update(int row, int sort_column, QModelIndexList& to_update, kt::ViewModel* model)
     {
         bool ret = false;
+        int num_updates = to_update.size();
         const TorrentStats& s = tc->getStats();
         if (status != s.status)
         {
             to_update.append(model->index(row, NAME));
             status = s.status;
+            // status changes can come with a new name (magnet links), so check the filter again
+            visibility_dirty = true;
             if (sort_column == NAME)
                 ret = true;
         }
@@ -198,10 +212,38 @@ namespace kt
             if (sort_column == SEED_TIME)
                 ret = true;
         }
+
+        // formatted values of changed columns must be made again, the download rate is not shown when finished
+        for (int i = num_updates; i < to_update.size(); i++)
+        {
+            int col = to_update[i].column();
+            display_valid &= ~(1u << col);
+            if (col == BYTES_LEFT)
+                display_valid &= ~(1u << DOWNLOAD_RATE);
+        }
+
+        stats_changed = to_update.size() != num_updates || running != s.running || completed != s.completed;
+        running = s.running;
+        completed = s.completed;
         return ret;
     }
 
     QVariant ViewModel::Item::data(int col) const
+    {
+        // the name and location can change behind our back, and are cheap to get
+        if (col == NAME || col == DOWNLOAD_LOCATION || col < 0 || col >= _NUMBER_OF_COLUMNS)
+            return formatData(col);
+
+        Uint32 bit = 1u << col;
+        if (!(display_valid & bit))
+        {
+            display[col] = formatData(col);
+            display_valid |= bit;
+        }
+        return display[col];
+    }
+
+    QVariant ViewModel::Item::formatData(int col) const
     {
         static QLocale locale;
         const TorrentStats& s = tc->getStats();
@@ -343,12 +385,13 @@ namespace kt
             return QVariant();
     }
 
-    bool ViewModel::Item::visible(Group* group, const QString& filter_string) const
+    void ViewModel::Item::updateVisibility(Group* group, const QString& filter_string, bool filter_changed, bool group_changed)
     {
-        if (group && !group->isMember(tc))
-            return false;
+        if (group_changed)
+            member = !group || group->contains(tc);
 
-        return filter_string.isEmpty() || tc->getDisplayName().contains(filter_string, Qt::CaseInsensitive);
+        if (filter_changed)
+            filter_match = filter_string.isEmpty() || tc->getDisplayName().contains(filter_string, Qt::CaseInsensitive);
     }
 
     QVariant ViewModel::Item::statusIcon() const
@@ -394,15 +437,20 @@ namespace kt
         connect(core, &Core::aboutToQuit, this, &ViewModel::onExit); // model must be in core's thread to be notified in time
         connect(core, &Core::torrentAdded, this, &ViewModel::addTorrent);
         connect(core, &Core::torrentRemoved, this, &ViewModel::removeTorrent);
+        connect(core->getGroupManager(), &GroupManager::customGroupChanged, this, &ViewModel::customGroupChanged);
         sort_column = 0;
         sort_order = Qt::AscendingOrder;
         group = 0;
         num_visible = 0;
+        filter_dirty = true;
+        group_dirty = true;
 
         kt::QueueManager* qman = core->getQueueManager();
         for (QList<bt::TorrentInterface*>::iterator i = qman->begin(); i != qman->end(); i++)
         {
-            torrents.append(new Item(*i));
+            Item* item = new Item(*i);
+            item->hidden = false;
+            torrents.append(item);
             num_visible++;
         }
     }
@@ -416,34 +464,54 @@ namespace kt
     void ViewModel::setGroup(Group* g)
     {
         group = g;
+        group_dirty = true;
+    }
+
+    void ViewModel::customGroupChanged()
+    {
+        // torrents were added to or removed from a custom group
+        group_dirty = true;
     }
 
     void ViewModel::addTorrent(bt::TorrentInterface* ti)
     {
+        // Torrents added in one go (loaded in the background at startup, or a batch
+        // from a scan folder) are put in place by a single update, which resorts once
+        // instead of once per torrent when there are many of them.
+        if (added.isEmpty())
+            QTimer::singleShot(0, this, SLOT(insertAddedTorrents()));
+
         Item* i = new Item(ti);
-        if (Settings::highlightNewTorrents())
-        {
-            i->highlight = true;
+        torrents.append(i);
+        added.append(i);
+    }
+
+    void ViewModel::insertAddedTorrents()
+    {
+        if (added.isEmpty())
+            return;
 
+        // Existing torrents which are loaded late at startup are not new
+        Item* last = added.last();
+        bool highlight = Settings::highlightNewTorrents() && !core->isLoadingTorrents();
+        added.clear();
+
+        if (highlight)
+        {
             // Turn off highlight for previously highlighted torrents
             foreach (Item* item, torrents)
-                if (item->highlight)
-                    item->highlight = false;
+                item->highlight = false;
+            last->highlight = true;
         }
 
-        torrents.append(i);
-        update(view->viewDelegate(), true);
+        update(view->viewDelegate());
 
         // Scroll to new torrent
-        int idx = 0;
-        foreach (Item* item, torrents)
+        if (highlight && !last->hidden)
         {
-            if (item->tc == ti)
-            {
+            int idx = torrents.indexOf(last);
+            if (idx >= 0)
                 view->scrollTo(index(idx, 0));
-                break;
-            }
-            idx++;
         }
     }
 
@@ -454,8 +522,15 @@ namespace kt
         {
             if (item->tc == ti)
             {
-                removeRow(idx);
-                update(view->viewDelegate(), true);
+                added.removeOne(item);
+                // removing keeps the order, so no resort is needed
+                if (item->hidden)
+                {
+                    torrents.remove(idx);
+                    delete item;
+                }
+                else
+                    removeRow(idx);
                 break;
             }
             idx++;
@@ -472,44 +547,179 @@ namespace kt
     bool ViewModel::update(ViewDelegate* delegate, bool force_resort)
     {
         update_list.clear();
-        bool resort = force_resort;
-        num_visible = 0;
+        // a new filter or group changes many rows at once, a full sort is cheaper then
+        bool resort = force_resort || filter_dirty || group_dirty;
+        // membership of custom groups only changes through customGroupChanged, other groups depend on the stats
+        bool custom_group = group && (group->groupFlags() & Group::CUSTOM_GROUP);
+        QModelIndexList hidden_updates;
+        QVector<Item*> hide;
+        QVector<Item*> show;
+        QVector<Item*> moved;
 
         int row = 0;
         foreach (Item* i, torrents)
         {
-            bool hidden = !i->visible(group, filter_string);
-            if (!hidden && i->update(row, sort_column, update_list, this))
-                resort = true;
+            bool key_changed = i->update(row, sort_column, i->hidden ? hidden_updates : update_list, this);
+            hidden_updates.clear();
 
+            bool filter_changed = filter_dirty || i->visibility_dirty;
+            bool group_changed = group_dirty || i->visibility_dirty || (i->stats_changed && !custom_group);
+            if (filter_changed || group_changed)
+                i->updateVisibility(group, filter_string, filter_changed, group_changed);
+            i->visibility_dirty = false;
+
+            bool hidden = !i->visible();
             if (hidden != i->hidden)
             {
-                i->hidden = hidden;
-                resort = true;
+                if (hidden)
+                    hide.append(i);
+                else
+                    show.append(i);
             }
+            else if (!hidden && key_changed)
+                moved.append(i);
 
             // hide the extender if there is one shown
             if (hidden && delegate->extended(i->tc))
                 delegate->hideExtender(i->tc);
 
-            if (!i->hidden)
-                num_visible++;
             row++;
         }
 
-        if (resort)
+        filter_dirty = false;
+        group_dirty = false;
+
+        // Moving rows one by one only pays off when a few of them change
+        int changes = hide.size() + show.size() + moved.size();
+        if (resort || changes > 64 + num_visible / 16)
         {
+            foreach (Item* i, hide)
+                i->hidden = true;
+            foreach (Item* i, show)
+                i->hidden = false;
+
             update_list.clear();
             sort(sort_column, sort_order);
             return true;
         }
 
+        if (changes > 0 && repositionIncrementally(hide, show, moved))
+        {
+            // rows have moved, so fix the rows of the indexes which need to be updated
+            QHash<const Item*, int> rows;
+            rows.reserve(num_visible);
+            for (int r = 0; r < num_visible; r++)
+                rows.insert(torrents[r], r);
+
+            QModelIndexList list;
+            foreach (const QModelIndex& idx, update_list)
+            {
+                QHash<const Item*, int>::const_iterator r = rows.constFind((const Item*)idx.internalPointer());
+                if (r != rows.constEnd())
+                    list.append(index(r.value(), idx.column()));
+            }
+            update_list = list;
+        }
+
         return false;
     }
 
+    bool ViewModel::lessThan(const Item* a, const Item* b) const
+    {
+        if (sort_order == Qt::AscendingOrder)
+            return a->lessThan(sort_column, b);
+        else
+            return b->lessThan(sort_column, a);
+    }
+
+    int ViewModel::insertPosition(const Item* item) const
+    {
+        // Upper bound in the visible rows, skipping the item itself and the items which still need to be repositioned.
+        // Without those, the visible rows are sorted.
+        int lo = 0;
+        int hi = num_visible;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            int m = mid;
+            while (m < hi && (torrents[m] == item || torrents[m]->pending))
+                m++;
+
+            if (m == hi)
+                hi = mid;
+            else if (lessThan(item, torrents[m]))
+                hi = mid;
+            else
+                lo = m + 1;
+        }
+        return lo;
+    }
+
+    bool ViewModel::repositionIncrementally(const QVector<Item*>& hide, const QVector<Item*>& show, const QVector<Item*>& moved)
+    {
+        bool rows_changed = false;
+        foreach (Item* i, hide)
+        {
+            // hidden items go to the end, behind the visible rows
+            int r = torrents.indexOf(i);
+            beginRemoveRows(QModelIndex(), r, r);
+            torrents.remove(r);
+            torrents.append(i);
+            i->hidden = true;
+            num_visible--;
+            endRemoveRows();
+            rows_changed = true;
+        }
+
+        foreach (Item* i, moved)
+            i->pending = true;
+
+        foreach (Item* i, moved)
+        {
+            int r = torrents.indexOf(i);
+            int p = insertPosition(i);
+            i->pending = false;
+            if (p == r || p == r + 1)
+                continue; // still in the right place
+
+            beginMoveRows(QModelIndex(), r, r, QModelIndex(), p);
+            if (p > r)
+            {
+                torrents.insert(p, i);
+                torrents.remove(r);
+            }
+            else
+            {
+                torrents.remove(r);
+                torrents.insert(p, i);
+            }
+            endMoveRows();
+            rows_changed = true;
+        }
+
+        foreach (Item* i, show)
+        {
+            int r = torrents.indexOf(i);
+            int p = insertPosition(i);
+            beginInsertRows(QModelIndex(), p, p);
+            torrents.remove(r);
+            torrents.insert(p, i);
+            i->hidden = false;
+            num_visible++;
+            endInsertRows();
+            rows_changed = true;
+        }
+
+        return rows_changed;
+    }
+
     void ViewModel::setFilterString(const QString& filter)
     {
-        filter_string = filter;
+        if (filter_string != filter)
+        {
+            filter_string = filter;
+            filter_dirty = true;
+        }
     }
 
     int ViewModel::rowCount(const QModelIndex& parent) const
@@ -704,6 +914,7 @@ namespace kt
 
         bt::TorrentInterface* tc = item->tc;
         tc->setDisplayName(name);
+        item->visibility_dirty = true;
         emit dataChanged(index, index);
         if (sort_column == NAME)
             sort(sort_column, sort_order);
@@ -823,7 +1034,7 @@ namespace kt
     {
         foreach (Item* item, torrents)
         {
-            if (item->visible(group, filter_string))
+            if (!item->hidden)
                 tlist.append(item->tc);
         }
     }
@@ -843,6 +1054,8 @@ namespace kt
         for (int i = 0; i < count; i++)
         {
             Item* item = torrents[row + i];
+            if (!item->hidden)
+                num_visible--;
             delete item;
         }
         torrents.remove(row, count);
@@ -887,6 +1100,10 @@ namespace kt
         sort_order = order;
         emit layoutAboutToBeChanged();
         qStableSort(torrents.begin(), torrents.end(), ViewModelItemCmp(col, order));
+        num_visible = 0;
+        foreach (Item* i, torrents)
+            if (!i->hidden)
+                num_visible++;
         emit layoutChanged();
         emit sorted();
     }
@@ -128,7 +128,7 @@ namespace kt
         {
             foreach (Item* item, torrents)
             {
-                if (item->visible(group, filter_string))
+                if (!item->hidden)
                     if (!a(item->tc))
                         break;
             }
@@ -143,6 +143,10 @@ namespace kt
         void sort(int col, Qt::SortOrder order);
         void onExit();
 
+    private slots:
+        void customGroupChanged();
+        void insertAddedTorrents();
+
     signals:
         void sorted();
 
@@ -188,30 +192,51 @@ namespace kt
             bt::Uint32 runtime_dl;
             bt::Uint32 runtime_ul;
             int eta;
+            bool running;
+            bool completed;
             bool hidden;
             QDateTime time_added;
             bool highlight;
+            // cached visibility, see updateVisibility
+            bool filter_match;
+            bool member;
+            bool visibility_dirty;
+            bool stats_changed; // set by update when anything changed
+            bool pending; // sort key changed, waiting to be repositioned
+            // formatted display values, a bit in display_valid per column
+            mutable QVariant display[_NUMBER_OF_COLUMNS];
+            mutable bt::Uint32 display_valid;
 
             Item(bt::TorrentInterface* tc);
 
             bool update(int row, int sort_column, QModelIndexList& to_update, ViewModel* model);
             QVariant data(int col) const;
+            QVariant formatData(int col) const;
             QVariant color(int col) const;
             QVariant statusIcon() const;
             bool lessThan(int col, const Item* other) const;
-            bool visible(Group* group, const QString& filter_string) const;
+            void updateVisibility(Group* group, const QString& filter_string, bool filter_changed, bool group_changed);
+            bool visible() const {return filter_match && member;}
         };
 
+    private:
+        bool lessThan(const Item* a, const Item* b) const;
+        int insertPosition(const Item* item) const;
+        bool repositionIncrementally(const QVector<Item*>& hide, const QVector<Item*>& show, const QVector<Item*>& moved);
+
     private:
         Core* core;
         View* view;
         QVector<Item*> torrents;
+        QVector<Item*> added; // hidden until insertAddedTorrents puts them in place
         int sort_column;
         Qt::SortOrder sort_order;
         Group* group;
         int num_visible;
         QModelIndexList update_list;
         QString filter_string;
+        bool filter_dirty;
+        bool group_dirty;
     };
 
 }
@@ -20,6 +20,7 @@
  ***************************************************************************/
 
 #include <QDBusConnection>
+#include <QDBusServiceWatcher>
 #include <QFile>
 #include <QTimer>
 
@@ -29,6 +30,7 @@
 #include <torrent/queuemanager.h>
 #include <util/log.h>
 #include <util/sha1hash.h>
+#include <bcodec/bencoder.h>
 #include <groups/groupmanager.h>
 #include "dbus.h"
 #include <interfaces/coreinterface.h>
@@ -42,7 +44,29 @@ using namespace bt;
 
 namespace kt
 {
-    DBus::DBus(GUIInterface* gui, CoreInterface* core, QObject* parent) : QObject(parent), gui(gui), core(core)
+    /// Interval in ms at which statsChanged is emitted
+    const int STATS_SIGNAL_INTERVAL = 1000;
+
+    static void AppendStats(QByteArray& out, const QString& info_hash, const QByteArray& stats)
+    {
+        // bencoded key followed by the already encoded dictionary
+        QByteArray key = info_hash.toLatin1();
+        out.append(QByteArray::number(key.size()));
+        out.append(':');
+        out.append(key);
+        out.append(stats);
+    }
+
+    static QByteArray EncodeStats(bt::TorrentInterface* tc, const bt::TorrentStats& s, bt::Uint32 fields)
+    {
+        QByteArray ret;
+        BEncoder enc(new BEncoderBufferOutput(ret));
+        DBusTorrent::encodeStats(enc, tc, s, fields);
+        return ret;
+    }
+
+    DBus::DBus(GUIInterface* gui, CoreInterface* core, QObject* parent)
+        : QObject(parent), gui(gui), core(core), last_stats_version(0)
     {
         torrent_map.setAutoDelete(true);
         group_map.setAutoDelete(true);
@@ -77,6 +101,15 @@ namespace kt
         }
 
         dbus_settings = new DBusSettings(core, this);
+
+        stats_timer = new QTimer(this);
+        stats_timer->setInterval(STATS_SIGNAL_INTERVAL);
+        connect(stats_timer, SIGNAL(timeout()), this, SLOT(emitStatsChanged()));
+
+        stats_watcher = new QDBusServiceWatcher(this);
+        stats_watcher->setConnection(QDBusConnection::sessionBus());
+        stats_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+        connect(stats_watcher, SIGNAL(serviceUnregistered(QString)), this, SLOT(serviceUnregistered(QString)));
     }
 
     DBus::~DBus()
@@ -98,20 +131,20 @@ namespace kt
 
     void DBus::start(const QString& info_hash)
     {
-        DBusTorrent* tc = torrent_map.find(info_hash);
+        bt::TorrentInterface* tc = core->getQueueManager()->find(info_hash);
         if (!tc)
             return;
 
-        core->getQueueManager()->start(tc->torrent());
+        core->getQueueManager()->start(tc);
     }
 
     void DBus::stop(const QString& info_hash)
     {
-        DBusTorrent* tc = torrent_map.find(info_hash);
+        bt::TorrentInterface* tc = core->getQueueManager()->find(info_hash);
         if (!tc)
             return;
 
-        core->getQueueManager()->stop(tc->torrent());
+        core->getQueueManager()->stop(tc);
     }
 
     void DBus::startAll()
@@ -139,6 +172,7 @@ namespace kt
             QString ih = db->infoHash();
             torrentRemoved(ih);
             torrent_map.erase(ih);
+            last_stats.remove(ih);
         }
     }
 
@@ -239,11 +273,11 @@ namespace kt
 
     void DBus::remove(const QString& info_hash, bool data_to)
     {
-        DBusTorrent* tc = torrent_map.find(info_hash);
+        bt::TorrentInterface* tc = core->getQueueManager()->find(info_hash);
         if (!tc)
             return;
 
-        core->remove(tc->torrent(), data_to);
+        core->remove(tc, data_to);
     }
 
     void DBus::removeDelayed(const QString& info_hash, bool data_to)
@@ -300,5 +334,116 @@ namespace kt
         return dbus_settings;
     }
 
-}
+    QByteArray DBus::torrentStats(const QStringList& info_hashes, uint fields)
+    {
+        QByteArray ret = "d";
+        if (info_hashes.isEmpty())
+        {
+            // The snapshot is shared with everybody else who needs the stats during this tick,
+            // the torrent map is used for the order because dictionary keys must be sorted
+            kt::StatsSnapshot::Ptr snap = core->getStatsSnapshot();
+            QHash<bt::TorrentInterface*, const bt::TorrentStats*> stats;
+            stats.reserve(snap->torrents.size());
+            for (QVector<kt::TorrentSnapshot>::const_iterator i = snap->torrents.begin(); i != snap->torrents.end(); i++)
+                stats.insert(i->tc, &i->stats);
+
+            for (DBusTorrentItr i = torrent_map.begin(); i != torrent_map.end(); i++)
+            {
+                bt::TorrentInterface* tc = i->second->torrent();
+                const bt::TorrentStats* s = stats.value(tc);
+                AppendStats(ret, i->first, EncodeStats(tc, s ? *s : tc->getStats(), fields));
+            }
+        }
+        else
+        {
+            // Dictionary keys must be sorted and unique
+            QStringList sorted = info_hashes;
+            sorted.sort();
+            sorted.removeDuplicates();
+            foreach (const QString& ih, sorted)
+            {
+                DBusTorrent* db = torrent_map.find(ih);
+                if (db)
+                    AppendStats(ret, ih, EncodeStats(db->torrent(), db->torrent()->getStats(), fields));
+            }
+        }
+        ret.append('e');
+        return ret;
+    }
+
+    void DBus::subscribeStats(uint fields)
+    {
+        if (!calledFromDBus())
+            return;
+
+        QString service = message().service();
+        if (!stats_subscribers.contains(service))
+            stats_watcher->addWatchedService(service);
+
+        stats_subscribers[service] = fields == 0 ? (uint)DBusTorrent::STATS_DEFAULT : fields;
+        // Start with a full set, so the new subscriber gets everything once
+        last_stats.clear();
+        last_stats_version = 0;
+        if (!stats_timer->isActive())
+            stats_timer->start();
+    }
+
+    void DBus::unsubscribeStats()
+    {
+        if (calledFromDBus())
+            serviceUnregistered(message().service());
+    }
+
+    void DBus::serviceUnregistered(const QString& service)
+    {
+        if (!stats_subscribers.remove(service))
+            return;
+
+        stats_watcher->removeWatchedService(service);
+        if (stats_subscribers.isEmpty())
+        {
+            stats_timer->stop();
+            last_stats.clear();
+            last_stats_version = 0;
+        }
+    }
 
+    void DBus::emitStatsChanged()
+    {
+        kt::StatsSnapshot::Ptr snap = core->getStatsSnapshot();
+        if (snap->version == last_stats_version)
+            return;
+
+        last_stats_version = snap->version;
+
+        uint fields = 0;
+        for (QMap<QString, uint>::const_iterator i = stats_subscribers.constBegin(); i != stats_subscribers.constEnd(); i++)
+            fields |= i.value();
+
+        // Collect the changed ones sorted on info hash, dictionary keys must be sorted
+        QMap<QString, QByteArray> changed;
+        for (QVector<kt::TorrentSnapshot>::const_iterator i = snap->torrents.begin(); i != snap->torrents.end(); i++)
+        {
+            QString ih = i->tc->getInfoHash().toString();
+            QByteArray stats = EncodeStats(i->tc, i->stats, fields);
+            QHash<QString, QByteArray>::iterator last = last_stats.find(ih);
+            if (last == last_stats.end())
+                last_stats.insert(ih, stats);
+            else if (last.value() != stats)
+                last.value() = stats;
+            else
+                continue;
+
+            changed.insert(ih, stats);
+        }
+
+        if (changed.isEmpty())
+            return;
+
+        QByteArray ret = "d";
+        for (QMap<QString, QByteArray>::const_iterator i = changed.constBegin(); i != changed.constEnd(); i++)
+            AppendStats(ret, i.key(), i.value());
+        ret.append('e');
+        emit statsChanged(ret);
+    }
+}
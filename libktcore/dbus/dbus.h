@@ -22,6 +22,8 @@
 #ifndef KT_DBUS_HH
 #define KT_DBUS_HH
 
+#include <QDBusContext>
+#include <QHash>
 #include <QMap>
 #include <QObject>
 #include <QStringList>
@@ -37,6 +39,9 @@ namespace bt
     class TorrentInterface;
 }
 
+class QDBusServiceWatcher;
+class QTimer;
+
 namespace kt
 {
     class GUIInterface;
@@ -47,7 +52,7 @@ namespace kt
     /**
      * Class which handles DBus calls
      * */
-    class KTCORE_EXPORT DBus : public QObject
+    class KTCORE_EXPORT DBus : public QObject, protected QDBusContext
     {
         Q_OBJECT
         Q_CLASSINFO("D-Bus Interface", "org.ktorrent.core")
@@ -126,6 +131,25 @@ namespace kt
         ///  Get the number of torrents not running.
         Q_SCRIPTABLE QString dataDir() const;
 
+        /**
+         * Get the stats of many torrents in one call.
+         * The result is a bencoded dictionary which maps the info hash of each torrent
+         * on a dictionary with the same fields as DBusTorrent::stats.
+         * @param info_hashes The torrents, all torrents if empty
+         * @param fields OR of DBusTorrent::StatsFields, 0 gives everything except the chunk bitsets
+         */
+        Q_SCRIPTABLE QByteArray torrentStats(const QStringList& info_hashes, uint fields);
+
+        /**
+         * Subscribe the caller to the statsChanged signal.
+         * Calling it again changes the fields, the subscription ends when the caller leaves the bus.
+         * @param fields OR of DBusTorrent::StatsFields, 0 gives everything except the chunk bitsets
+         */
+        Q_SCRIPTABLE void subscribeStats(uint fields);
+
+        /// Unsubscribe the caller from the statsChanged signal
+        Q_SCRIPTABLE void unsubscribeStats();
+
     private Q_SLOTS:
         void torrentAdded(bt::TorrentInterface* tc);
         void torrentRemoved(bt::TorrentInterface* tc);
@@ -134,6 +158,8 @@ namespace kt
         void groupAdded(Group* g);
         void groupRemoved(Group* g);
         void delayedTorrentRemoval();
+        void emitStatsChanged();
+        void serviceUnregistered(const QString& service);
 
     Q_SIGNALS:
         /// DBus signal emitted when a torrent has been added
@@ -154,6 +180,13 @@ namespace kt
         /// Emitted when suspended state changes
         Q_SCRIPTABLE void suspendStateChanged(bool suspended);
 
+        /**
+         * Emitted at most once per second while somebody is subscribed, with the stats of only those torrents
+         * which changed since the previous emission. Nothing is emitted when nothing changed.
+         * The format is the same as torrentStats.
+         */
+        Q_SCRIPTABLE void statsChanged(const QByteArray& stats);
+
 
     private:
         GUIInterface* gui;
@@ -162,6 +195,11 @@ namespace kt
         bt::PtrMap<Group*, DBusGroup> group_map;
         QMap<QString, bool> delayed_removal_map;
         DBusSettings* dbus_settings;
+        QMap<QString, uint> stats_subscribers;
+        QHash<QString, QByteArray> last_stats;
+        bt::Uint64 last_stats_version;
+        QTimer* stats_timer;
+        QDBusServiceWatcher* stats_watcher;
 
         typedef bt::PtrMap<QString, DBusTorrent>::iterator DBusTorrentItr;
         typedef bt::PtrMap<Group*, DBusGroup>::iterator DBusGroupItr;
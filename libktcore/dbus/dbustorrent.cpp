@@ -259,47 +259,84 @@ namespace kt
     {
         QByteArray ret;
         BEncoder enc(new BEncoderBufferOutput(ret));
-        const TorrentStats& s = ti->getStats();
+        encodeStats(enc, ti, ti->getStats(), STATS_ALL);
+        return ret;
+    }
+
+    void DBusTorrent::encodeStats(BEncoder& enc, bt::TorrentInterface* ti, const bt::TorrentStats& s, bt::Uint32 fields)
+    {
+        if (fields == 0)
+            fields = STATS_DEFAULT;
+
+        // the keys are written in the order stats() has always used, each one only when its group is selected
+        bool transfer = fields & STATS_TRANSFER;
+        bool peers = fields & STATS_PEERS;
+        bool status = fields & STATS_STATUS;
         enc.beginDict();
-        enc.write(QByteArrayLiteral("imported_bytes"), s.imported_bytes);
-        enc.write(QByteArrayLiteral("bytes_downloaded"), s.bytes_downloaded);
-        enc.write(QByteArrayLiteral("bytes_uploaded"), s.bytes_uploaded);
-        enc.write(QByteArrayLiteral("bytes_left"), s.bytes_left);
-        enc.write(QByteArrayLiteral("bytes_left_to_download"), s.bytes_left_to_download);
-        enc.write(QByteArrayLiteral("total_bytes"), s.total_bytes);
-        enc.write(QByteArrayLiteral("total_bytes_to_download"), s.total_bytes_to_download);
-        enc.write(QByteArrayLiteral("download_rate"), s.download_rate);
-        enc.write(QByteArrayLiteral("upload_rate"), s.upload_rate);
-        enc.write(QByteArrayLiteral("num_peers"), s.num_peers);
-        enc.write(QByteArrayLiteral("num_chunks_downloading"), s.num_chunks_downloading);
-        enc.write(QByteArrayLiteral("total_chunks"), s.total_chunks);
-        enc.write(QByteArrayLiteral("num_chunks_downloaded"), s.num_chunks_downloaded);
-        enc.write(QByteArrayLiteral("num_chunks_excluded"), s.num_chunks_excluded);
-        enc.write(QByteArrayLiteral("num_chunks_left"), s.num_chunks_left);
-        enc.write(QByteArrayLiteral("chunk_size"), s.chunk_size);
-        enc.write(QByteArrayLiteral("seeders_total"), s.seeders_total);
-        enc.write(QByteArrayLiteral("seeders_connected_to"), s.seeders_connected_to);
-        enc.write(QByteArrayLiteral("leechers_total"), s.leechers_total);
-        enc.write(QByteArrayLiteral("leechers_connected_to"), s.leechers_connected_to);
-        enc.write(QByteArrayLiteral("status"), s.statusToString().toUtf8());
-        enc.write(QByteArrayLiteral("session_bytes_downloaded"), s.session_bytes_downloaded);
-        enc.write(QByteArrayLiteral("session_bytes_uploaded"), s.session_bytes_uploaded);
-        enc.write(QByteArrayLiteral("output_path"), s.output_path.toUtf8());
-        enc.write(QByteArrayLiteral("running"), s.running);
-        enc.write(QByteArrayLiteral("started"), s.started);
-        enc.write(QByteArrayLiteral("multi_file_torrent"), s.multi_file_torrent);
-        enc.write(QByteArrayLiteral("stopped_by_error"), s.stopped_by_error);
-        enc.write(QByteArrayLiteral("max_share_ratio"), s.max_share_ratio);
-        enc.write(QByteArrayLiteral("max_seed_time"), s.max_seed_time);
-        enc.write(QByteArrayLiteral("num_corrupted_chunks"), s.num_corrupted_chunks);
-        const bt::BitSet& bs = ti->downloadedChunksBitSet();
-        enc.write(QByteArrayLiteral("downloaded_chunks"));
-        enc.write(bs.getData(), bs.getNumBytes());
-        const bt::BitSet& ebs = ti->excludedChunksBitSet();
-        enc.write(QByteArrayLiteral("excluded_chunks"));
-        enc.write(ebs.getData(), ebs.getNumBytes());
+        if (transfer)
+        {
+            enc.write(QByteArrayLiteral("imported_bytes"), s.imported_bytes);
+            enc.write(QByteArrayLiteral("bytes_downloaded"), s.bytes_downloaded);
+            enc.write(QByteArrayLiteral("bytes_uploaded"), s.bytes_uploaded);
+            enc.write(QByteArrayLiteral("bytes_left"), s.bytes_left);
+            enc.write(QByteArrayLiteral("bytes_left_to_download"), s.bytes_left_to_download);
+            enc.write(QByteArrayLiteral("total_bytes"), s.total_bytes);
+            enc.write(QByteArrayLiteral("total_bytes_to_download"), s.total_bytes_to_download);
+            enc.write(QByteArrayLiteral("download_rate"), s.download_rate);
+            enc.write(QByteArrayLiteral("upload_rate"), s.upload_rate);
+        }
+        if (peers)
+            enc.write(QByteArrayLiteral("num_peers"), s.num_peers);
+        if (transfer)
+        {
+            enc.write(QByteArrayLiteral("num_chunks_downloading"), s.num_chunks_downloading);
+            enc.write(QByteArrayLiteral("total_chunks"), s.total_chunks);
+            enc.write(QByteArrayLiteral("num_chunks_downloaded"), s.num_chunks_downloaded);
+            enc.write(QByteArrayLiteral("num_chunks_excluded"), s.num_chunks_excluded);
+            enc.write(QByteArrayLiteral("num_chunks_left"), s.num_chunks_left);
+            enc.write(QByteArrayLiteral("chunk_size"), s.chunk_size);
+        }
+        if (peers)
+        {
+            enc.write(QByteArrayLiteral("seeders_total"), s.seeders_total);
+            enc.write(QByteArrayLiteral("seeders_connected_to"), s.seeders_connected_to);
+            enc.write(QByteArrayLiteral("leechers_total"), s.leechers_total);
+            enc.write(QByteArrayLiteral("leechers_connected_to"), s.leechers_connected_to);
+        }
+        if (status)
+            enc.write(QByteArrayLiteral("status"), s.statusToString().toUtf8());
+        if (transfer)
+        {
+            enc.write(QByteArrayLiteral("session_bytes_downloaded"), s.session_bytes_downloaded);
+            enc.write(QByteArrayLiteral("session_bytes_uploaded"), s.session_bytes_uploaded);
+        }
+        if (status)
+        {
+            enc.write(QByteArrayLiteral("output_path"), s.output_path.toUtf8());
+            enc.write(QByteArrayLiteral("running"), s.running);
+            enc.write(QByteArrayLiteral("started"), s.started);
+            enc.write(QByteArrayLiteral("multi_file_torrent"), s.multi_file_torrent);
+            enc.write(QByteArrayLiteral("stopped_by_error"), s.stopped_by_error);
+            enc.write(QByteArrayLiteral("max_share_ratio"), s.max_share_ratio);
+            enc.write(QByteArrayLiteral("max_seed_time"), s.max_seed_time);
+        }
+        if (transfer)
+            enc.write(QByteArrayLiteral("num_corrupted_chunks"), s.num_corrupted_chunks);
+
+        if (fields & STATS_DOWNLOADED_CHUNKS)
+        {
+            const bt::BitSet& bs = ti->downloadedChunksBitSet();
+            enc.write(QByteArrayLiteral("downloaded_chunks"));
+            enc.write(bs.getData(), bs.getNumBytes());
+        }
+
+        if (fields & STATS_EXCLUDED_CHUNKS)
+        {
+            const bt::BitSet& ebs = ti->excludedChunksBitSet();
+            enc.write(QByteArrayLiteral("excluded_chunks"));
+            enc.write(ebs.getData(), ebs.getNumBytes());
+        }
         enc.end();
-        return ret;
     }
 
     void DBusTorrent::onFinished(bt::TorrentInterface* tor)
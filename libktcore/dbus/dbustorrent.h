@@ -29,6 +29,11 @@
 #include <interfaces/torrentinterface.h>
 
 
+namespace bt
+{
+    class BEncoder;
+}
+
 namespace kt
 {
 
@@ -47,6 +52,27 @@ namespace kt
         DBusTorrent(bt::TorrentInterface* ti, QObject* parent);
         virtual ~DBusTorrent();
 
+        /// Groups of fields which can be selected when encoding the stats
+        enum StatsFields
+        {
+            STATS_TRANSFER = 0x01, ///< Byte counts, rates and chunk counts
+            STATS_PEERS = 0x02, ///< Seeders and leechers
+            STATS_STATUS = 0x04, ///< Status, output path, flags and limits
+            STATS_DOWNLOADED_CHUNKS = 0x08, ///< Bitset of downloaded chunks
+            STATS_EXCLUDED_CHUNKS = 0x10, ///< Bitset of excluded chunks
+            STATS_DEFAULT = STATS_TRANSFER | STATS_PEERS | STATS_STATUS,
+            STATS_ALL = STATS_DEFAULT | STATS_DOWNLOADED_CHUNKS | STATS_EXCLUDED_CHUNKS
+        };
+
+        /**
+         * Encode the stats of a torrent as a bencoded dictionary.
+         * @param enc The encoder
+         * @param ti The torrent
+         * @param s The stats of the torrent
+         * @param fields OR of StatsFields, 0 means STATS_DEFAULT
+         */
+        static void encodeStats(bt::BEncoder& enc, bt::TorrentInterface* ti, const bt::TorrentStats& s, bt::Uint32 fields);
+
         /// Get a pointer to the actual torrent
         bt::TorrentInterface* torrent() {return ti;}
 
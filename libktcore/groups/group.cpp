@@ -82,15 +82,36 @@ namespace kt
 
     void Group::updateCount(QueueManager* qman)
     {
-        total = running = 0;
-        for (QueueManager::iterator j = qman->begin(); j != qman->end(); j++)
+        Q_UNUSED(qman);
+        total = members.count();
+        running = 0;
+        for (QSet<TorrentInterface*>::const_iterator i = members.constBegin(); i != members.constEnd(); i++)
         {
-            if (isMember(*j))
-            {
-                total++;
-                if ((*j)->getStats().running)
-                    running++;
-            }
+            if ((*i)->getStats().running)
+                running++;
         }
     }
+
+    void Group::setMember(TorrentInterface* tor, bool member, bool was_running, bool now_running)
+    {
+        bool was_member = members.contains(tor);
+        if (was_member)
+        {
+            total--;
+            if (was_running)
+                running--;
+        }
+
+        if (member)
+        {
+            if (!was_member)
+                members.insert(tor);
+
+            total++;
+            if (now_running)
+                running++;
+        }
+        else if (was_member)
+            members.remove(tor);
+    }
 }
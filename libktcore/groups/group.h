@@ -23,6 +23,7 @@
 
 #include <QString>
 #include <QIcon>
+#include <QSet>
 
 #include <ktcore_export.h>
 #include <util/constants.h>
@@ -120,6 +121,13 @@ namespace kt
         /// Total torrents
         int totalTorrents() const {return total;}
 
+        /**
+         * Check if a torrent is a member, as last determined by the GroupManager.
+         * Unlike isMember, this is a simple lookup.
+         * @param tor The torrent
+         */
+        bool contains(TorrentInterface* tor) const {return members.contains(tor);}
+
         /// Set the group policy
         void setGroupPolicy(const Policy& p);
 
@@ -170,11 +178,18 @@ namespace kt
         virtual void policyChanged();
 
         /**
-         * Update the running and total count
+         * Recount the running and total count from the members.
+         * The GroupManager keeps them up to date, so this is normally not needed.
          * @param qman The QueueManager
          **/
         void updateCount(QueueManager* qman);
 
+    private:
+        /// Called by the GroupManager when the membership or running state of a torrent may have changed
+        void setMember(TorrentInterface* tor, bool member, bool was_running, bool now_running);
+
+        friend class GroupManager;
+
     protected:
         QString name;
         QIcon icon;
@@ -184,6 +199,7 @@ namespace kt
         QString path;
         int running;
         int total;
+        QSet<TorrentInterface*> members;
     };
 
 }
@@ -36,6 +36,7 @@
 #include "torrentgroup.h"
 #include "ungroupedgroup.h"
 #include "functiongroup.h"
+#include <torrent/queuemanager.h>
 
 using namespace bt;
 
@@ -94,6 +95,22 @@ namespace kt
         return A(tor) && B(tor);
     }
 
+    enum StateKeyBits
+    {
+        KEY_RUNNING = 1,
+        KEY_COMPLETED = 2,
+        KEY_ACTIVE = 4,
+        KEY_STATUS_SHIFT = 3
+    };
+
+    /// Everything the standard groups look at, packed together, membership only needs to be checked when it changes
+    static Uint32 StateKey(TorrentInterface* tor)
+    {
+        const bt::TorrentStats& s = tor->getStats();
+        Uint32 key = (s.running ? KEY_RUNNING : 0) | (s.completed ? KEY_COMPLETED : 0) | (active(tor) ? KEY_ACTIVE : 0);
+        return key | ((Uint32)s.status << KEY_STATUS_SHIFT);
+    }
+
     GroupManager::GroupManager()
     {
         groups.setAutoDelete(true);
@@ -148,8 +165,7 @@ namespace kt
             return 0;
 
         TorrentGroup* g = new TorrentGroup(name);
-        connect(g, SIGNAL(torrentAdded(Group*)), this, SIGNAL(customGroupChanged()));
-        connect(g, SIGNAL(torrentRemoved(Group*)), this, SIGNAL(customGroupChanged()));
+        watch(g);
         groups.insert(name, g);
         emit groupAdded(g);
         return g;
@@ -164,9 +180,24 @@ namespace kt
             groups.erase(g->groupName());
             groups.setAutoDelete(true);
             g->deleteLater();
+
+            // the members of the group might be ungrouped now
+            const QSet<TorrentInterface*> members = g->members;
+            for (TorrentInterface* tc : members)
+            {
+                Uint32 key = states.value(tc);
+                evaluate(tc, key, key);
+            }
         }
     }
 
+    void GroupManager::watch(TorrentGroup* g)
+    {
+        connect(g, SIGNAL(torrentAdded(Group*)), this, SIGNAL(customGroupChanged()));
+        connect(g, SIGNAL(torrentRemoved(Group*)), this, SIGNAL(customGroupChanged()));
+        connect(g, &TorrentGroup::membershipChanged, this, &GroupManager::customGroupMemberChanged);
+    }
+
     bool GroupManager::canRemove(const Group* g) const
     {
         return g->groupFlags() & Group::CUSTOM_GROUP;
@@ -253,8 +284,7 @@ namespace kt
                     continue;
 
                 TorrentGroup* g = new TorrentGroup(QStringLiteral("dummy"));
-                connect(g, SIGNAL(torrentAdded(Group*)), this, SIGNAL(customGroupChanged()));
-                connect(g, SIGNAL(torrentRemoved(Group*)), this, SIGNAL(customGroupChanged()));
+                watch(g);
 
                 try
                 {
@@ -284,12 +314,107 @@ namespace kt
 
     void GroupManager::torrentRemoved(TorrentInterface* ti)
     {
+        QHash<TorrentInterface*, Uint32>::iterator s = states.find(ti);
+        if (s != states.end())
+        {
+            bool was_running = s.value() & KEY_RUNNING;
+            for (Itr i = groups.begin(); i != groups.end(); i++)
+                i->second->setMember(ti, false, was_running, false);
+
+            states.erase(s);
+            running_torrents.remove(ti);
+        }
+
         for (Itr i = groups.begin(); i != groups.end(); i++)
         {
             i->second->torrentRemoved(ti);
         }
     }
 
+    void GroupManager::torrentAdded(TorrentInterface* tc)
+    {
+        // Torrents loaded after the groups (in the background at startup) join their custom groups right away
+        for (Itr i = groups.begin(); i != groups.end(); i++)
+        {
+            if (i->second->groupFlags() & Group::CUSTOM_GROUP)
+            {
+                TorrentGroup* tg = dynamic_cast<TorrentGroup*>(i->second);
+                if (tg)
+                    tg->torrentLoaded(tc);
+            }
+        }
+
+        if (states.contains(tc))
+            torrentChanged(tc);
+        else
+            evaluate(tc, 0, StateKey(tc));
+    }
+
+    void GroupManager::torrentChanged(TorrentInterface* tc)
+    {
+        QHash<TorrentInterface*, Uint32>::iterator s = states.find(tc);
+        if (s == states.end())
+            return;
+
+        Uint32 key = StateKey(tc);
+        if (key != s.value())
+            evaluate(tc, s.value(), key);
+    }
+
+    void GroupManager::update()
+    {
+        // Only running torrents change without a status change (they become active or passive)
+        QList<TorrentInterface*> changed;
+        for (QSet<TorrentInterface*>::const_iterator i = running_torrents.constBegin(); i != running_torrents.constEnd(); i++)
+        {
+            if (StateKey(*i) != states.value(*i))
+                changed.append(*i);
+        }
+
+        for (TorrentInterface* tc : qAsConst(changed))
+            torrentChanged(tc);
+    }
+
+    void GroupManager::customGroupMemberChanged(TorrentInterface* tc)
+    {
+        // Only the custom group itself and the ungrouped group are affected, but checking them all is cheap enough
+        QHash<TorrentInterface*, Uint32>::const_iterator s = states.constFind(tc);
+        if (s != states.constEnd())
+            evaluate(tc, s.value(), s.value());
+    }
+
+    void GroupManager::evaluate(TorrentInterface* tc, Uint32 old_key, Uint32 new_key)
+    {
+        bool was_running = old_key & KEY_RUNNING;
+        bool now_running = new_key & KEY_RUNNING;
+        for (Itr i = groups.begin(); i != groups.end(); i++)
+            i->second->setMember(tc, i->second->isMember(tc), was_running, now_running);
+
+        states[tc] = new_key;
+        if (now_running)
+            running_torrents.insert(tc);
+        else
+            running_torrents.remove(tc);
+    }
+
+    void GroupManager::evaluateAll()
+    {
+        for (QHash<TorrentInterface*, Uint32>::iterator s = states.begin(); s != states.end(); s++)
+        {
+            Uint32 key = StateKey(s.key());
+            bool was_running = s.value() & KEY_RUNNING;
+            bool now_running = key & KEY_RUNNING;
+            for (Itr i = groups.begin(); i != groups.end(); i++)
+                i->second->setMember(s.key(), i->second->isMember(s.key()), was_running, now_running);
+
+            s.value() = key;
+            if (now_running)
+                running_torrents.insert(s.key());
+            else
+                running_torrents.remove(s.key());
+        }
+    }
+
     void GroupManager::renameGroup(const QString& old_name, const QString& new_name)
     {
         QString oldName = old_name;
@@ -313,6 +438,11 @@ namespace kt
             return;
 
         groups.insert(g->groupName(), g);
+        for (QHash<TorrentInterface*, Uint32>::const_iterator s = states.constBegin(); s != states.constEnd(); s++)
+        {
+            bool now_running = s.value() & KEY_RUNNING;
+            g->setMember(s.key(), g->isMember(s.key()), now_running, now_running);
+        }
         emit groupAdded(g);
     }
 
@@ -326,7 +456,7 @@ namespace kt
         }
     }
 
-    void GroupManager::torrentsLoaded(QueueManager* qman)
+    void GroupManager::torrentsLoaded(QueueManager* qman, bool all_loaded)
     {
         for (Itr i = groups.begin(); i != groups.end(); i++)
         {
@@ -334,9 +464,12 @@ namespace kt
             {
                 TorrentGroup* tg = dynamic_cast<TorrentGroup*>(i->second);
                 if (tg)
-                    tg->loadTorrents(qman);
+                    tg->loadTorrents(qman, all_loaded);
             }
         }
+
+        // loadTorrents does not announce the torrents it finds
+        evaluateAll();
     }
 
     Group* GroupManager::findByPath(const QString& path)
@@ -352,8 +485,19 @@ namespace kt
 
     void GroupManager::updateCount(QueueManager* qman)
     {
-        for (Itr i = groups.begin(); i != groups.end(); i++)
-            i->second->updateCount(qman);
+        QSet<TorrentInterface*> present;
+        for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++)
+        {
+            present.insert(*i);
+            torrentAdded(*i);
+        }
+
+        const QList<TorrentInterface*> known = states.keys();
+        for (TorrentInterface* tc : known)
+        {
+            if (!present.contains(tc))
+                torrentRemoved(tc);
+        }
     }
 
 
@@ -21,6 +21,8 @@
 #ifndef KTGROUPMANAGER_H
 #define KTGROUPMANAGER_H
 
+#include <QHash>
+#include <QSet>
 #include <QString>
 
 #include <util/ptrmap.h>
@@ -36,6 +38,7 @@ namespace kt
 {
 
     class QueueManager;
+    class TorrentGroup;
 
 
     /**
@@ -51,11 +54,30 @@ namespace kt
         virtual ~GroupManager();
 
         /**
-         * Update the count of all groups
+         * Bring the membership and counts of all groups in sync with the QueueManager.
+         * Normally they are kept up to date incrementally, this only checks for missed changes.
          * @param qman The QueueManager
          **/
         void updateCount(QueueManager* qman);
 
+        /**
+         * A torrent has been added, find out which groups it belongs to.
+         * @param tc The torrent
+         */
+        void torrentAdded(bt::TorrentInterface* tc);
+
+        /**
+         * The status of a torrent has changed, update the groups if needed.
+         * @param tc The torrent
+         */
+        void torrentChanged(bt::TorrentInterface* tc);
+
+        /**
+         * Check the running torrents for changes which affect the standard groups (e.g. becoming active).
+         * Should be called every update tick, stopped torrents only change through torrentChanged.
+         */
+        void update();
+
         /**
          * Find a group given it's path
          * @param path Path of the group
@@ -136,8 +158,9 @@ namespace kt
         /**
             Torrents have been loaded update all custom groups.
             @param qman The QueueManager
+            @param all_loaded Whether all torrents are loaded, or more will follow
         */
-        void torrentsLoaded(QueueManager* qman);
+        void torrentsLoaded(QueueManager* qman, bool all_loaded = true);
 
     signals:
         void groupRenamed(Group* g);
@@ -145,9 +168,20 @@ namespace kt
         void groupRemoved(Group* g);
         void customGroupChanged();
 
+    private slots:
+        void customGroupMemberChanged(bt::TorrentInterface* tc);
+
+    private:
+        void watch(TorrentGroup* g);
+        void evaluate(bt::TorrentInterface* tc, bt::Uint32 old_key, bt::Uint32 new_key);
+        void evaluateAll();
+
     private:
         bt::PtrMap<QString, Group> groups;
         Group* all;
+        // state of every torrent which matters for the standard groups, see StateKey
+        QHash<bt::TorrentInterface*, bt::Uint32> states;
+        QSet<bt::TorrentInterface*> running_torrents;
     };
 
 }
@@ -51,11 +51,13 @@ namespace kt
     void TorrentGroup::add(TorrentInterface* tor)
     {
         torrents.insert(tor);
+        membershipChanged(tor);
     }
 
     void TorrentGroup::remove(TorrentInterface* tor)
     {
         torrents.erase(tor);
+        membershipChanged(tor);
     }
 
     void TorrentGroup::save(bt::BEncoder* enc)
@@ -155,12 +157,14 @@ namespace kt
     void TorrentGroup::removeTorrent(TorrentInterface* tor)
     {
         torrents.erase(tor);
+        membershipChanged(tor);
         torrentRemoved(this);
     }
 
     void TorrentGroup::addTorrent(TorrentInterface* tor, bool new_torrent)
     {
         torrents.insert(tor);
+        membershipChanged(tor);
         // apply group policy if needed
         if (policy.only_apply_on_new_torrents && !new_torrent)
             return;
@@ -190,17 +194,35 @@ namespace kt
         }
     }
 
-    void TorrentGroup::loadTorrents(QueueManager* qman)
+    void TorrentGroup::loadTorrents(QueueManager* qman, bool all_loaded)
     {
         QueueManager::iterator i = qman->begin();
-        while (i != qman->end())
+        while (i != qman->end() && !hashes.empty())
         {
-            if (hashes.count((*i)->getInfoHash()) > 0)
+            std::set<bt::SHA1Hash>::iterator j = hashes.find((*i)->getInfoHash());
+            if (j != hashes.end())
+            {
                 torrents.insert(*i);
+                hashes.erase(j);
+            }
             i++;
         }
 
-        hashes.clear();
+        // Keep the hashes which are not matched yet, until all torrents have been loaded
+        if (all_loaded)
+            hashes.clear();
+    }
+
+    bool TorrentGroup::torrentLoaded(TorrentInterface* tor)
+    {
+        std::set<bt::SHA1Hash>::iterator i = hashes.find(tor->getInfoHash());
+        if (i == hashes.end())
+            return false;
+
+        hashes.erase(i);
+        torrents.insert(tor);
+        torrentAdded(this);
+        return true;
     }
 
 }
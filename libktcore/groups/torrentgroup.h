@@ -51,7 +51,15 @@ namespace kt
 
         void add(TorrentInterface* tor);
         void remove(TorrentInterface* tor);
-        void loadTorrents(QueueManager* qman);
+        void loadTorrents(QueueManager* qman, bool all_loaded = true);
+
+        /**
+         * A torrent has been loaded after the group, add it if it is one of the
+         * members which were not loaded yet.
+         * @param tor The torrent
+         * @return true if it was added
+         */
+        bool torrentLoaded(TorrentInterface* tor);
 
     signals:
         /// Emitted when a torrent has been added
@@ -60,6 +68,9 @@ namespace kt
         /// Emittend when a torrent has been removed
         void torrentRemoved(Group* g);
 
+        /// Emitted when a torrent has been added or removed
+        void membershipChanged(bt::TorrentInterface* tor);
+
     private:
         std::set<TorrentInterface*> torrents;
         std::set<bt::SHA1Hash> hashes;
@@ -21,10 +21,13 @@
 #ifndef KTCOREINTERFACE_H
 #define KTCOREINTERFACE_H
 
+#include <QList>
 #include <QObject>
+#include <QPair>
 #include <QUrl>
 
 #include <util/constants.h>
+#include <interfaces/statssnapshot.h>
 #include <ktcore_export.h>
 
 namespace bt
@@ -36,15 +39,6 @@ namespace bt
 
 namespace kt
 {
-    ///Stats struct
-    struct CurrentStats
-    {
-        bt::Uint32 download_speed;
-        bt::Uint32 upload_speed;
-        bt::Uint64 bytes_downloaded;
-        bt::Uint64 bytes_uploaded;
-    };
-
     struct MagnetLinkLoadOptions
     {
         bool silently;
@@ -141,6 +135,13 @@ namespace kt
         /// Get CurrentStats structure
         virtual CurrentStats getStats() = 0;
 
+        /**
+         * Get the stats snapshot of the current update tick.
+         * @param with_peers Whether the peer totals are needed, they require walking all peers
+         * @return The snapshot
+         */
+        virtual StatsSnapshot::Ptr getStatsSnapshot(bool with_peers = false) = 0;
+
         /**
          * Switch the port
          * @param port The new port
@@ -193,6 +194,15 @@ namespace kt
          */
         virtual bt::TorrentInterface* loadSilently(const QByteArray& data, const QUrl &url, const QString& group, const QString& savedir) = 0;
 
+        /**
+         * Load several torrents silently in one go. Work which only needs
+         * to be done once, like saving the groups, is done after all torrents are loaded.
+         * @param torrents Data and URL of each torrent
+         * @param group Group to use
+         * @return The loaded torrents
+         */
+        virtual QList<bt::TorrentInterface*> loadSilently(const QList<QPair<QByteArray, QUrl> >& torrents, const QString& group) = 0;
+
         /**
          * Remove a download.This will delete all temp
          * data from this TorrentControl And delete the
@@ -283,6 +293,12 @@ namespace kt
          * Plugins interested in this should update their internal states.
          * */
         void settingsChanged();
+
+        /**
+         * Emitted after each update tick, once the stats of the torrents have been updated.
+         * There are no ticks while no torrent is running.
+         */
+        void statsUpdated();
     };
 
 }
@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KTSTATSSNAPSHOT_H
+#define KTSTATSSNAPSHOT_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <interfaces/torrentinterface.h>
+#include <util/constants.h>
+
+namespace kt
+{
+    ///Stats struct
+    struct CurrentStats
+    {
+        bt::Uint32 download_speed;
+        bt::Uint32 upload_speed;
+        bt::Uint64 bytes_downloaded;
+        bt::Uint64 bytes_uploaded;
+    };
+
+    /// Aggregated statistics of the peers of all running torrents
+    struct PeerTotals
+    {
+        bt::Uint32 leechers; // peers which do not have the whole torrent
+        bt::Uint32 seeders;
+        bt::Uint64 leecher_download_rate;
+        bt::Uint64 leecher_upload_rate;
+        bt::Uint64 seeder_download_rate;
+    };
+
+    /// Copy of the stats of one torrent
+    struct TorrentSnapshot
+    {
+        bt::TorrentInterface* tc; // only valid as long as the torrent is loaded
+        bt::TorrentStats stats;
+    };
+
+    /**
+     * Statistics of all torrents, made by the core at most once per update tick and shared
+     * between everybody who needs them, instead of each of them walking all torrents and peers.
+     * A snapshot is never modified after it has been made, the version goes up with every tick
+     * and every time a torrent is added or removed.
+     */
+    struct StatsSnapshot
+    {
+        typedef QSharedPointer<const StatsSnapshot> Ptr;
+
+        bt::Uint64 version;
+        CurrentStats totals;
+        bt::Uint32 num_running;
+        bt::Uint32 leechers_connected;
+        bt::Uint32 leechers_total;
+        bt::Uint32 seeders_connected;
+        bt::Uint32 seeders_total;
+        bool has_peer_totals;
+        PeerTotals peers; // only filled in when has_peer_totals is set
+        QVector<TorrentSnapshot> torrents; // in queue order
+    };
+}
+
+#endif
@@ -0,0 +1,345 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QVector>
+#include <random>
+#include <util/bitset.h>
+#include <util/bitsetkernels.h>
+
+using namespace bt;
+
+namespace
+{
+    const Uint32 NUM_CHUNKS = 1000000;
+    const Uint32 NUM_PIXELS = 800;
+
+    /// Random number in [0, max)
+    int bounded(std::mt19937& rnd, int max)
+    {
+        return std::uniform_int_distribution<int>(0, max - 1)(rnd);
+    }
+}
+
+class BitSetKernelsTest : public QObject
+{
+    Q_OBJECT
+private:
+    // Downloaded chunks the way they look halfway through a download: runs of chunks with random holes
+    static BitSet randomBitSet(std::mt19937& rnd, Uint32 num_bits, int density)
+    {
+        BitSet bs(num_bits);
+        Uint32 i = 0;
+        while (i < num_bits)
+        {
+            Uint32 run = bounded(rnd, 200) + 1;
+            bool on = bounded(rnd, 100) < density;
+            for (Uint32 j = i; j < i + run && j < num_bits; j++)
+                bs.set(j, on && bounded(rnd, 10) != 0);
+            i += run;
+        }
+        return bs;
+    }
+
+    static Uint32 referenceCount(const BitSet& a, const BitSet* b, bool and_not, Uint32 first, Uint32 last)
+    {
+        Uint32 count = 0;
+        for (Uint32 i = first; i < last && i < a.getNumBits(); i++)
+        {
+            if (!a.get(i))
+                continue;
+
+            if (!b)
+                count++;
+            else if (and_not ? !b->get(i) : b->get(i))
+                count++;
+        }
+        return count;
+    }
+
+    // The runs found by testing every bit, the way the chunk bars used to do it
+    static void referenceRuns(const BitSet& bs, QVector<kt::BitRun>& runs)
+    {
+        runs.clear();
+        Uint32 i = 0;
+        while (i < bs.getNumBits())
+        {
+            if (!bs.get(i))
+            {
+                i++;
+                continue;
+            }
+
+            kt::BitRun r = {i, i};
+            while (r.last + 1 < bs.getNumBits() && bs.get(r.last + 1))
+                r.last++;
+            runs.append(r);
+            i = r.last + 1;
+        }
+    }
+
+    static void referenceBuckets(const BitSet& bs, Uint32 num_buckets, QVector<Uint32>& counts)
+    {
+        counts.resize(num_buckets);
+        for (Uint32 i = 0; i < num_buckets; i++)
+        {
+            Uint32 first = kt::BucketStart(i, bs.getNumBits(), num_buckets);
+            Uint32 last = kt::BucketStart(i + 1, bs.getNumBits(), num_buckets);
+            counts[i] = referenceCount(bs, 0, false, first, last);
+        }
+    }
+
+    static bool sameRuns(const QVector<kt::BitRun>& a, const QVector<kt::BitRun>& b)
+    {
+        if (a.count() != b.count())
+            return false;
+
+        for (int i = 0; i < a.count(); i++)
+        {
+            if (a[i].first != b[i].first || a[i].last != b[i].last)
+                return false;
+        }
+        return true;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        // torrent sized bit sets for testLargeSet and the benchmarks
+        std::mt19937 rnd(42);
+        large_a = randomBitSet(rnd, NUM_CHUNKS, 50);
+        large_b = randomBitSet(rnd, NUM_CHUNKS, 10);
+    }
+
+    void testCount()
+    {
+        std::mt19937 rnd(7);
+        for (Uint32 num_bits = 0; num_bits < 300; num_bits += 13)
+        {
+            BitSet a = randomBitSet(rnd, num_bits, 50);
+            BitSet b = randomBitSet(rnd, num_bits, 50);
+            for (Uint32 first = 0; first <= num_bits; first += 3)
+            {
+                for (Uint32 last = first; last <= num_bits + 10; last += 7)
+                {
+                    QCOMPARE(kt::CountOnBits(a, first, last), referenceCount(a, 0, false, first, last));
+                    QCOMPARE(kt::CountOnBitsAnd(a, b, first, last), referenceCount(a, &b, false, first, last));
+                    QCOMPARE(kt::CountOnBitsAndNot(a, b, first, last), referenceCount(a, &b, true, first, last));
+                }
+            }
+        }
+    }
+
+    void testRuns()
+    {
+        std::mt19937 rnd(7);
+        for (int density = 0; density <= 100; density += 25)
+        {
+            BitSet bs = randomBitSet(rnd, 10000, density);
+            QVector<kt::BitRun> runs;
+            kt::OnBitRuns(bs, runs);
+
+            Uint32 pos = 0;
+            for (const kt::BitRun& r : qAsConst(runs))
+            {
+                QVERIFY(r.first <= r.last);
+                QVERIFY(r.first == 0 || !bs.get(r.first - 1));
+                QVERIFY(r.last + 1 == bs.getNumBits() || !bs.get(r.last + 1));
+                for (; pos < r.first; pos++)
+                    QVERIFY(!bs.get(pos));
+                for (; pos <= r.last; pos++)
+                    QVERIFY(bs.get(pos));
+            }
+            for (; pos < bs.getNumBits(); pos++)
+                QVERIFY(!bs.get(pos));
+        }
+
+        BitSet all(1000);
+        all.setAll(true);
+        QVector<kt::BitRun> runs;
+        kt::OnBitRuns(all, runs);
+        QCOMPARE(runs.count(), 1);
+        QCOMPARE(runs[0].first, (Uint32)0);
+        QCOMPARE(runs[0].last, (Uint32)999);
+    }
+
+    void testDifferentRuns()
+    {
+        std::mt19937 rnd(7);
+        BitSet a = randomBitSet(rnd, 5000, 50);
+        BitSet b(a);
+        b.set(0, !b.get(0));
+        for (Uint32 i = 1000; i < 1100; i++)
+            b.set(i, !b.get(i));
+        b.set(4999, !b.get(4999));
+
+        QVector<kt::BitRun> runs;
+        kt::DifferentBitRuns(a, b, runs);
+        QCOMPARE(runs.count(), 3);
+        QCOMPARE(runs[0].first, (Uint32)0);
+        QCOMPARE(runs[0].last, (Uint32)0);
+        QCOMPARE(runs[1].first, (Uint32)1000);
+        QCOMPARE(runs[1].last, (Uint32)1099);
+        QCOMPARE(runs[2].first, (Uint32)4999);
+        QCOMPARE(runs[2].last, (Uint32)4999);
+
+        kt::DifferentBitRuns(a, a, runs);
+        QVERIFY(runs.isEmpty());
+    }
+
+    void testBuckets()
+    {
+        std::mt19937 rnd(7);
+        BitSet bs = randomBitSet(rnd, 100003, 50);
+        QVector<Uint32> counts;
+        kt::BucketCounts(bs, NUM_PIXELS, counts);
+        QCOMPARE((Uint32)counts.count(), NUM_PIXELS);
+        for (Uint32 i = 0; i < NUM_PIXELS; i++)
+        {
+            Uint32 first = kt::BucketStart(i, bs.getNumBits(), NUM_PIXELS);
+            Uint32 last = kt::BucketStart(i + 1, bs.getNumBits(), NUM_PIXELS);
+            QCOMPARE(counts[i], referenceCount(bs, 0, false, first, last));
+        }
+        QCOMPARE(kt::BucketStart(NUM_PIXELS, bs.getNumBits(), NUM_PIXELS), bs.getNumBits());
+    }
+
+    void testLargeSet()
+    {
+        // the results have to agree with the BitSet operations they replace
+        const BitSet& a = large_a;
+        const BitSet& b = large_b;
+        QCOMPARE(kt::CountOnBits(a, 0, NUM_CHUNKS), a.numOnBits());
+
+        BitSet tmp(a);
+        tmp -= b;
+        Uint32 and_not = kt::CountOnBitsAndNot(a, b, 0, NUM_CHUNKS);
+        QCOMPARE(and_not, tmp.numOnBits());
+        QCOMPARE(kt::CountOnBitsAnd(a, b, 0, NUM_CHUNKS), a.numOnBits() - and_not);
+
+        QVector<kt::BitRun> runs;
+        kt::OnBitRuns(a, runs);
+        Uint32 in_runs = 0;
+        for (const kt::BitRun& r : qAsConst(runs))
+            in_runs += r.last - r.first + 1;
+        QCOMPARE(in_runs, a.numOnBits());
+
+        QVector<Uint32> counts;
+        kt::BucketCounts(a, NUM_PIXELS, counts);
+        QCOMPARE((Uint32)counts.count(), NUM_PIXELS);
+        Uint32 in_buckets = 0;
+        for (Uint32 c : qAsConst(counts))
+            in_buckets += c;
+        QCOMPARE(in_buckets, a.numOnBits());
+    }
+
+    void benchmarkCount()
+    {
+        Uint32 count = 0;
+        QBENCHMARK
+        {
+            count = kt::CountOnBits(large_a, 0, NUM_CHUNKS);
+        }
+        QCOMPARE(count, referenceCount(large_a, 0, false, 0, NUM_CHUNKS));
+    }
+
+    void benchmarkReferenceCount()
+    {
+        Uint32 count = 0;
+        QBENCHMARK
+        {
+            count = referenceCount(large_a, 0, false, 0, NUM_CHUNKS);
+        }
+        QCOMPARE(count, large_a.numOnBits());
+    }
+
+    void benchmarkAndNot()
+    {
+        Uint32 count = 0;
+        QBENCHMARK
+        {
+            count = kt::CountOnBitsAndNot(large_a, large_b, 0, NUM_CHUNKS);
+        }
+        QCOMPARE(count, referenceCount(large_a, &large_b, true, 0, NUM_CHUNKS));
+    }
+
+    void benchmarkReferenceAndNot()
+    {
+        Uint32 count = 0;
+        QBENCHMARK
+        {
+            count = referenceCount(large_a, &large_b, true, 0, NUM_CHUNKS);
+        }
+        BitSet tmp(large_a);
+        tmp -= large_b;
+        QCOMPARE(count, tmp.numOnBits());
+    }
+
+    void benchmarkRuns()
+    {
+        QVector<kt::BitRun> runs;
+        QBENCHMARK
+        {
+            kt::OnBitRuns(large_a, runs);
+        }
+        QVector<kt::BitRun> expected;
+        referenceRuns(large_a, expected);
+        QVERIFY(sameRuns(runs, expected));
+    }
+
+    void benchmarkReferenceRuns()
+    {
+        QVector<kt::BitRun> runs;
+        QBENCHMARK
+        {
+            referenceRuns(large_a, runs);
+        }
+        QVERIFY(!runs.isEmpty());
+    }
+
+    void benchmarkBuckets()
+    {
+        QVector<Uint32> counts;
+        QBENCHMARK
+        {
+            kt::BucketCounts(large_a, NUM_PIXELS, counts);
+        }
+        QVector<Uint32> expected;
+        referenceBuckets(large_a, NUM_PIXELS, expected);
+        QCOMPARE(counts, expected);
+    }
+
+    void benchmarkReferenceBuckets()
+    {
+        QVector<Uint32> counts;
+        QBENCHMARK
+        {
+            referenceBuckets(large_a, NUM_PIXELS, counts);
+        }
+        QCOMPARE((Uint32)counts.count(), NUM_PIXELS);
+    }
+
+private:
+    BitSet large_a;
+    BitSet large_b;
+};
+
+QTEST_MAIN(BitSetKernelsTest)
+
+#include "bitsetkernelstest.moc"
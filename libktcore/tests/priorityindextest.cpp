@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QVector>
+#include <algorithm>
+#include <random>
+#include <util/priorityindex.h>
+
+namespace
+{
+    struct FakeTorrent
+    {
+        int priority;
+    };
+
+    const int NUM_TORRENTS = 1000;
+    const int NUM_BENCHMARK_TORRENTS = 10000;
+    const int NUM_BENCHMARK_CHANGES = 100;
+    const int STEP = 1024;
+
+    /// Random number in [0, max)
+    int bounded(std::mt19937& rng, int max)
+    {
+        return std::uniform_int_distribution<int>(0, max - 1)(rng);
+    }
+}
+
+class PriorityIndexTest : public QObject
+{
+    Q_OBJECT
+private:
+    typedef kt::PriorityIndex<FakeTorrent> Index;
+
+    // Index order must be the same as sorting on priority, with ties in insertion order
+    static void checkOrder(const Index& index, QList<FakeTorrent*> reference)
+    {
+        std::stable_sort(reference.begin(), reference.end(), [](FakeTorrent * a, FakeTorrent * b) {
+            return a->priority > b->priority;
+        });
+
+        QCOMPARE(index.count(), reference.count());
+        int idx = 0;
+        for (Index::const_iterator i = index.begin(); i != index.end(); ++i, ++idx)
+        {
+            QCOMPARE(i->second, reference.at(idx));
+            QCOMPARE(i->first, i->second->priority);
+        }
+    }
+
+    static QList<FakeTorrent*> order(const Index& index)
+    {
+        QList<FakeTorrent*> ret;
+        for (Index::const_iterator i = index.begin(); i != index.end(); ++i)
+            ret.append(i->second);
+        return ret;
+    }
+
+    // Move like QueueManager::moveTorrent does: reindex when there is no room left
+    static void move(Index& index, FakeTorrent* t, FakeTorrent* after)
+    {
+        int p = 0;
+        if (!index.move(t, after, STEP, p))
+        {
+            QList<FakeTorrent*> current = order(index);
+            int prio = current.count() * STEP;
+            for (FakeTorrent* c : qAsConst(current))
+            {
+                c->priority = prio;
+                index.update(c, prio);
+                prio -= STEP;
+            }
+            QVERIFY(index.move(t, after, STEP, p));
+        }
+        t->priority = p;
+    }
+
+    // The queue order must be sorted on priority and contain every torrent
+    static void checkSorted(const QList<FakeTorrent*>& list, int count)
+    {
+        QCOMPARE(list.count(), count);
+        for (int i = 1; i < list.count(); i++)
+            QVERIFY(list.at(i - 1)->priority >= list.at(i)->priority);
+    }
+
+    // A queue of torrents where a few change priority between two orderings, like a start or stop does
+    static void changePriorities(std::mt19937& rng, QVector<FakeTorrent>& torrents, Index* index)
+    {
+        for (int i = 0; i < NUM_BENCHMARK_CHANGES; i++)
+        {
+            FakeTorrent& t = torrents[bounded(rng, torrents.count())];
+            t.priority = bounded(rng, torrents.count() * STEP);
+            if (index)
+                index->update(&t, t.priority);
+        }
+    }
+
+private slots:
+    void testOrder()
+    {
+        std::mt19937 rng(42);
+        QVector<FakeTorrent> torrents(NUM_TORRENTS);
+        QList<FakeTorrent*> reference;
+        Index index;
+        for (FakeTorrent& t : torrents)
+        {
+            t.priority = bounded(rng, NUM_TORRENTS / 4); // plenty of ties
+            index.insert(&t, t.priority);
+            reference.append(&t);
+        }
+        checkOrder(index, reference);
+
+        // change the priority of every other torrent, changed torrents go after the ones with the same priority
+        for (int i = 0; i < NUM_TORRENTS; i += 2)
+        {
+            torrents[i].priority = bounded(rng, NUM_TORRENTS / 4);
+            if (index.update(&torrents[i], torrents[i].priority))
+            {
+                reference.removeOne(&torrents[i]);
+                reference.append(&torrents[i]);
+            }
+        }
+        checkOrder(index, reference);
+
+        // remove a third of them
+        for (int i = 0; i < NUM_TORRENTS; i += 3)
+        {
+            QVERIFY(index.remove(&torrents[i]));
+            reference.removeOne(&torrents[i]);
+        }
+        QVERIFY(!index.remove(&torrents[0]));
+        QVERIFY(!index.contains(&torrents[3]));
+        QVERIFY(index.contains(&torrents[1]));
+        checkOrder(index, reference);
+    }
+
+    void testTies()
+    {
+        FakeTorrent a = {5}, b = {5}, c = {7};
+        Index index;
+        index.insert(&a, a.priority);
+        index.insert(&b, b.priority);
+        index.insert(&c, c.priority);
+
+        // equal priorities keep insertion order
+        QCOMPARE(order(index), QList<FakeTorrent*>() << &c << &a << &b);
+
+        QCOMPARE(index.highest(), 7);
+        QCOMPARE(index.lowest(), 5);
+        QCOMPARE(index.lowest(&b), 5);
+        QCOMPARE(index.lowest(&c, -1), 5);
+
+        QVERIFY(!index.update(&a, 5));
+        QVERIFY(index.update(&a, 1));
+        QCOMPARE(index.lowest(), 1);
+        QCOMPARE(index.lowest(&a), 5);
+        QCOMPARE(index.priority(&a), 1);
+    }
+
+    void testMove()
+    {
+        FakeTorrent t[4] = {{4 * STEP}, {3 * STEP}, {2 * STEP}, {STEP}};
+        Index index;
+        for (FakeTorrent& f : t)
+            index.insert(&f, f.priority);
+
+        // to the top
+        int p = 0;
+        QVERIFY(index.move(&t[2], 0, STEP, p));
+        QCOMPARE(p, 5 * STEP);
+        t[2].priority = p;
+        QCOMPARE(order(index), QList<FakeTorrent*>() << &t[2] << &t[0] << &t[1] << &t[3]);
+
+        // in between two others, nobody else changes
+        QVERIFY(index.move(&t[3], &t[0], STEP, p));
+        QCOMPARE(p, 3 * STEP + STEP / 2);
+        t[3].priority = p;
+        QCOMPARE(order(index), QList<FakeTorrent*>() << &t[2] << &t[0] << &t[3] << &t[1]);
+        QCOMPARE(t[0].priority, 4 * STEP);
+        QCOMPARE(t[1].priority, 3 * STEP);
+
+        // to the bottom
+        QVERIFY(index.move(&t[2], &t[1], STEP, p));
+        QCOMPARE(p, 2 * STEP);
+        t[2].priority = p;
+        QCOMPARE(order(index), QList<FakeTorrent*>() << &t[0] << &t[3] << &t[1] << &t[2]);
+
+        // already in place
+        QVERIFY(index.move(&t[2], &t[1], STEP, p));
+        QCOMPARE(p, 2 * STEP);
+
+        // unknown items
+        FakeTorrent other = {0};
+        QVERIFY(!index.move(&other, &t[0], STEP, p));
+        QVERIFY(!index.move(&t[0], &other, STEP, p));
+        QVERIFY(!index.move(&t[0], &t[0], STEP, p));
+    }
+
+    void testMoveWithoutRoom()
+    {
+        FakeTorrent a = {3}, b = {2}, c = {1};
+        Index index;
+        index.insert(&a, a.priority);
+        index.insert(&b, b.priority);
+        index.insert(&c, c.priority);
+
+        // no priority between a and b, nothing may change
+        int p = 0;
+        QVERIFY(!index.move(&c, &a, STEP, p));
+        QCOMPARE(order(index), QList<FakeTorrent*>() << &a << &b << &c);
+        QCOMPARE(index.priority(&c), 1);
+    }
+
+    void testSparseQueue()
+    {
+        // Simulate dragging torrents around in the queue manager: each move
+        // should only change the priority of the moved torrent, until the gaps
+        // run out and the queue is reindexed.
+        std::mt19937 rng(7);
+        QVector<FakeTorrent> torrents(100);
+        Index index;
+        int prio = torrents.count() * STEP;
+        for (FakeTorrent& t : torrents)
+        {
+            t.priority = prio;
+            index.insert(&t, prio);
+            prio -= STEP;
+        }
+
+        QList<FakeTorrent*> expected = order(index);
+        for (int i = 0; i < 5000; i++)
+        {
+            FakeTorrent* t = expected.at(bounded(rng, expected.count()));
+            expected.removeOne(t);
+            int pos = bounded(rng, expected.count() + 1);
+            expected.insert(pos, t);
+
+            QVector<int> before;
+            for (FakeTorrent& f : torrents)
+                before.append(index.priority(&f));
+
+            int p = 0;
+            bool room = index.move(t, pos > 0 ? expected.at(pos - 1) : 0, STEP, p);
+            if (room)
+            {
+                t->priority = p;
+                int changed = 0;
+                for (int j = 0; j < torrents.count(); j++)
+                {
+                    if (index.priority(&torrents[j]) != before[j])
+                        changed++;
+                }
+                QVERIFY(changed <= 1);
+            }
+            else
+            {
+                move(index, t, pos > 0 ? expected.at(pos - 1) : 0);
+            }
+
+            QCOMPARE(order(index), expected);
+            QVERIFY(index.lowest() > 0);
+        }
+    }
+
+    void benchmarkOrder()
+    {
+        // keep 10000 torrents ordered through the index, the way QueueManager::orderQueue gets its list
+        std::mt19937 rng(42);
+        QVector<FakeTorrent> torrents(NUM_BENCHMARK_TORRENTS);
+        Index index;
+        for (FakeTorrent& t : torrents)
+        {
+            t.priority = bounded(rng, torrents.count() * STEP);
+            index.insert(&t, t.priority);
+        }
+
+        QList<FakeTorrent*> list;
+        QBENCHMARK
+        {
+            changePriorities(rng, torrents, &index);
+            list = order(index);
+        }
+        checkSorted(list, NUM_BENCHMARK_TORRENTS);
+    }
+
+    void benchmarkSortOrder()
+    {
+        // the same with the whole list sorted each time, the way QueuePtrList::sort used to do it
+        std::mt19937 rng(42);
+        QVector<FakeTorrent> torrents(NUM_BENCHMARK_TORRENTS);
+        QList<FakeTorrent*> list;
+        for (FakeTorrent& t : torrents)
+        {
+            t.priority = bounded(rng, torrents.count() * STEP);
+            list.append(&t);
+        }
+
+        QBENCHMARK
+        {
+            changePriorities(rng, torrents, 0);
+            std::sort(list.begin(), list.end(), [](FakeTorrent * a, FakeTorrent * b) {
+                return a->priority > b->priority;
+            });
+        }
+        checkSorted(list, NUM_BENCHMARK_TORRENTS);
+    }
+};
+
+QTEST_MAIN(PriorityIndexTest)
+
+#include "priorityindextest.moc"
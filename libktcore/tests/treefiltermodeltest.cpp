@@ -0,0 +1,294 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QAbstractItemModel>
+#include <QStringList>
+#include <util/treefiltermodel.h>
+
+namespace
+{
+    /**
+     * File tree which creates the children of a directory on demand,
+     * the same way TorrentFileTreeModel does it.
+     */
+    class LazyTreeModel : public QAbstractItemModel
+    {
+    public:
+        struct Node
+        {
+            Node* parent;
+            QString name;
+            QString prefix; // path of a directory, including the trailing slash
+            QStringList paths; // files below a directory
+            bool populated;
+            QList<Node*> children;
+
+            Node(Node* parent, const QString& name) : parent(parent), name(name), populated(true) {}
+            ~Node() {qDeleteAll(children);}
+
+            int row() const {return parent ? parent->children.indexOf(const_cast<Node*>(this)) : 0;}
+        };
+
+        LazyTreeModel(const QStringList& paths, bool leaves_role) : leaves_role(leaves_role)
+        {
+            root = new Node(0, QString());
+            root->paths = paths;
+            root->populated = false;
+            populate(root);
+        }
+
+        virtual ~LazyTreeModel()
+        {
+            delete root;
+        }
+
+        virtual int rowCount(const QModelIndex& parent) const
+        {
+            return node(parent)->children.count();
+        }
+
+        virtual int columnCount(const QModelIndex& parent) const
+        {
+            Q_UNUSED(parent);
+            return 1;
+        }
+
+        virtual bool hasChildren(const QModelIndex& parent) const
+        {
+            Node* n = node(parent);
+            return n->populated ? !n->children.isEmpty() : !n->paths.isEmpty();
+        }
+
+        virtual bool canFetchMore(const QModelIndex& parent) const
+        {
+            return parent.isValid() && !node(parent)->populated;
+        }
+
+        virtual void fetchMore(const QModelIndex& parent)
+        {
+            if (!canFetchMore(parent))
+                return;
+
+            Node* n = node(parent);
+            beginInsertRows(parent, 0, childCount(n) - 1);
+            populate(n);
+            endInsertRows();
+        }
+
+        virtual QModelIndex index(int row, int column, const QModelIndex& parent) const
+        {
+            Node* p = node(parent);
+            if (row < 0 || row >= p->children.count() || column != 0)
+                return QModelIndex();
+
+            return createIndex(row, column, p->children.at(row));
+        }
+
+        virtual QModelIndex parent(const QModelIndex& index) const
+        {
+            Node* n = node(index);
+            if (!index.isValid() || n->parent == root)
+                return QModelIndex();
+
+            return createIndex(n->parent->row(), 0, n->parent);
+        }
+
+        virtual QVariant data(const QModelIndex& index, int role) const
+        {
+            Node* n = node(index);
+            if (role == Qt::DisplayRole)
+                return n->name;
+
+            if (role == kt::TreeFilterModel::UnfetchedLeavesRole && leaves_role && !n->populated)
+            {
+                QStringList names;
+                for (const QString& path : qAsConst(n->paths))
+                    names.append(path.section(QLatin1Char('/'), -1));
+                return names;
+            }
+
+            return QVariant();
+        }
+
+        /// Get the index of a node by its path
+        QModelIndex find(const QString& path) const
+        {
+            QModelIndex idx;
+            const QStringList parts = path.split(QLatin1Char('/'));
+            for (const QString& part : parts)
+            {
+                Node* n = node(idx);
+                int row = 0;
+                while (row < n->children.count() && n->children.at(row)->name != part)
+                    row++;
+
+                idx = index(row, 0, idx);
+                if (!idx.isValid())
+                    break;
+            }
+            return idx;
+        }
+
+    private:
+        Node* node(const QModelIndex& idx) const
+        {
+            return idx.isValid() ? static_cast<Node*>(idx.internalPointer()) : root;
+        }
+
+        QStringList childNames(Node* n) const
+        {
+            QStringList names;
+            for (const QString& path : qAsConst(n->paths))
+            {
+                QString name = path.mid(n->prefix.length()).section(QLatin1Char('/'), 0, 0);
+                if (!names.contains(name))
+                    names.append(name);
+            }
+            return names;
+        }
+
+        int childCount(Node* n) const
+        {
+            return childNames(n).count();
+        }
+
+        void populate(Node* n)
+        {
+            const QStringList names = childNames(n);
+            for (const QString& name : names)
+            {
+                Node* c = new Node(n, name);
+                const QString prefix = n->prefix + name + QLatin1Char('/');
+                for (const QString& path : qAsConst(n->paths))
+                {
+                    if (path.startsWith(prefix))
+                        c->paths.append(path);
+                }
+
+                if (!c->paths.isEmpty())
+                {
+                    c->prefix = prefix;
+                    c->populated = false;
+                }
+                n->children.append(c);
+            }
+            n->populated = true;
+        }
+
+    private:
+        Node* root;
+        bool leaves_role;
+    };
+}
+
+class TreeFilterModelTest : public QObject
+{
+    Q_OBJECT
+private:
+    QStringList paths() const
+    {
+        return QStringList()
+               << QStringLiteral("docs/readme.txt")
+               << QStringLiteral("music/album/track01.flac")
+               << QStringLiteral("music/album/track02.flac")
+               << QStringLiteral("music/cover.jpg")
+               << QStringLiteral("video/extras/deep/nested/making-of.mkv")
+               << QStringLiteral("notes.txt");
+    }
+
+    QStringList visibleTopLevel(const QSortFilterProxyModel& proxy) const
+    {
+        QStringList names;
+        for (int i = 0; i < proxy.rowCount(); i++)
+            names.append(proxy.index(i, 0).data().toString());
+        return names;
+    }
+
+private slots:
+    void testFilterInUnfetchedDirectory()
+    {
+        LazyTreeModel model(paths(), true);
+        kt::TreeFilterModel proxy;
+        proxy.setSourceModel(&model);
+
+        // none of the directories have been expanded
+        QVERIFY(model.canFetchMore(model.find(QStringLiteral("video"))));
+
+        proxy.setFilterFixedString(QStringLiteral("making-of"));
+        QCOMPARE(visibleTopLevel(proxy), QStringList() << QStringLiteral("video"));
+
+        proxy.setFilterFixedString(QStringLiteral("TRACK02"));
+        QCOMPARE(visibleTopLevel(proxy), QStringList() << QStringLiteral("music"));
+
+        proxy.setFilterFixedString(QStringLiteral(".txt"));
+        QCOMPARE(visibleTopLevel(proxy), QStringList() << QStringLiteral("docs") << QStringLiteral("notes.txt"));
+
+        proxy.setFilterFixedString(QStringLiteral("does-not-exist"));
+        QCOMPARE(proxy.rowCount(), 0);
+
+        // filtering must not create the children
+        QVERIFY(model.canFetchMore(model.find(QStringLiteral("video"))));
+        QVERIFY(model.canFetchMore(model.find(QStringLiteral("music"))));
+
+        proxy.setFilterFixedString(QString());
+        QCOMPARE(proxy.rowCount(), 4);
+    }
+
+    void testFilterAfterFetch()
+    {
+        LazyTreeModel model(paths(), true);
+        kt::TreeFilterModel proxy;
+        proxy.setSourceModel(&model);
+        proxy.setFilterFixedString(QStringLiteral("track01"));
+
+        // expanding a directory shows only the part of it which leads to a match
+        QModelIndex music = model.find(QStringLiteral("music"));
+        model.fetchMore(music);
+        QModelIndex pmusic = proxy.mapFromSource(music);
+        QVERIFY(pmusic.isValid());
+        QCOMPARE(proxy.rowCount(pmusic), 1);
+        QCOMPARE(proxy.index(0, 0, pmusic).data().toString(), QStringLiteral("album"));
+
+        QModelIndex album = model.find(QStringLiteral("music/album"));
+        model.fetchMore(album);
+        QModelIndex palbum = proxy.mapFromSource(album);
+        QCOMPARE(proxy.rowCount(palbum), 1);
+        QCOMPARE(proxy.index(0, 0, palbum).data().toString(), QStringLiteral("track01.flac"));
+    }
+
+    void testWithoutLeavesRole()
+    {
+        // a model which does not know the role: unfetched directories only match on their own name
+        LazyTreeModel model(paths(), false);
+        kt::TreeFilterModel proxy;
+        proxy.setSourceModel(&model);
+
+        proxy.setFilterFixedString(QStringLiteral("making-of"));
+        QCOMPARE(proxy.rowCount(), 0);
+
+        proxy.setFilterFixedString(QStringLiteral("video"));
+        QCOMPARE(visibleTopLevel(proxy), QStringList() << QStringLiteral("video"));
+    }
+};
+
+QTEST_MAIN(TreeFilterModelTest)
+
+#include "treefiltermodeltest.moc"
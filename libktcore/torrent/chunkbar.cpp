@@ -106,16 +106,39 @@ namespace kt
         const BitSet& bs = getBitSet();
         QSize s = contentsRect().size();
 
-        bool changed = !(curr == bs);
-
-        if (changed || pixmap.isNull() || pixmap.width() != s.width() || force)
+        if (force || pixmap.isNull() || pixmap.size() != s || curr.getNumBits() != bs.getNumBits())
         {
-            pixmap = QPixmap(s);
-            pixmap.fill(palette().color(QPalette::Active, QPalette::Base));
-            QPainter painter(&pixmap);
-            drawBarContents(&painter);
-            update();
+            drawPixmap();
         }
+        else
+        {
+            // Only repaint the columns of the chunks which changed since the last time
+            QVector<BitRun> changed;
+            DifferentBitRuns(curr, bs, changed);
+            if (!changed.isEmpty())
+                drawChangedChunks(changed);
+        }
+    }
+
+    void ChunkBar::drawPixmap()
+    {
+        pixmap = QPixmap(contentsRect().size());
+        pixmap.fill(palette().color(QPalette::Active, QPalette::Base));
+        QPainter painter(&pixmap);
+        drawBarContents(&painter);
+        update();
+    }
+
+    void ChunkBar::drawChangedChunks(const QVector<BitRun>& changed)
+    {
+        QRegion region = chunkRegion(changed, getBitSet().getNumBits(), pixmap.size());
+        QPainter painter(&pixmap);
+        painter.setClipRegion(region);
+        painter.fillRect(pixmap.rect(), palette().color(QPalette::Active, QPalette::Base));
+        drawBarContents(&painter);
+        painter.end();
+        // the pixmap is drawn in the contents rect
+        update(region.boundingRect().translated(contentsRect().topLeft()));
     }
 
     void ChunkBar::paintEvent(QPaintEvent* ev)
@@ -64,6 +64,12 @@ namespace kt
         virtual void drawBarContents(QPainter* p);
         virtual void paintEvent(QPaintEvent* ev);
 
+        /// Redraw the whole pixmap
+        void drawPixmap();
+
+        /// Redraw the part of the pixmap which shows a list of changed chunks
+        void drawChangedChunks(const QVector<BitRun>& changed);
+
     protected:
         bt::BitSet curr;
         QPixmap pixmap;
@@ -22,6 +22,7 @@
 #include <QPainter>
 
 #include <util/bitset.h>
+#include <util/bitsetkernels.h>
 #include "chunkbarrenderer.h"
 
 using namespace bt;
@@ -58,38 +59,14 @@ namespace kt
         p->setPen(QPen(c, 1, Qt::SolidLine));
         p->setBrush(c);
 
-        QVector<Range> rs;
-
-        for (Uint32 i = 0; i < bs.getNumBits(); i++)
-        {
-            if (!bs.get(i))
-                continue;
-
-            if (rs.empty())
-            {
-                Range r = {i, i, 0};
-                rs.append(r);
-            }
-            else
-            {
-                Range& l = rs.last();
-                if (l.last == i - 1)
-                {
-                    l.last = i;
-                }
-                else
-                {
-                    Range r = {i, i, 0};
-                    rs.append(r);
-                }
-            }
-        }
+        QVector<BitRun> rs;
+        OnBitRuns(bs, rs);
 
         QRect r = contents_rect;
 
         for (auto i = rs.constBegin(); i != rs.constEnd(); ++i)
         {
-            const Range& ra = *i;
+            const BitRun& ra = *i;
             int rw = ra.last - ra.first + 1;
             p->drawRect((int)(scale * ra.first), 0, (int)(rw * scale), r.height());
         }
@@ -97,23 +74,32 @@ namespace kt
 
     void ChunkBarRenderer::drawMoreChunksThenPixels(QPainter* p, const BitSet& bs, const QColor& color, const QRect& contents_rect)
     {
-        int w = contents_rect.width();
-        double chunks_per_pixel = (double)bs.getNumBits() / w;
-        QVector<Range> rs;
+        Uint32 w = contents_rect.width();
+        Uint32 num_chunks = bs.getNumBits();
 
-        for (Uint32 i = 0; i < w; i++)
+        // Only look at the chunks of the columns which will be painted, a column
+        // is drawn one pixel wider because of the pen, so include the neighbours
+        Uint32 first_col = 0;
+        Uint32 last_col = w;
+        if (p->hasClipping())
         {
-            Uint32 num_dl = 0;
-            Uint32 jStart = (Uint32)(i * chunks_per_pixel);
-            Uint32 jEnd = (Uint32)((i + 1) * chunks_per_pixel + 0.5);
-            for (Uint32 j = jStart; j < jEnd; j++)
-                if (bs.get(j))
-                    num_dl++;
+            QRect clip = p->clipBoundingRect().toAlignedRect();
+            first_col = (Uint32)qBound(0, clip.left() - 1, (int)w);
+            last_col = (Uint32)qBound(0, clip.right() + 1, (int)w);
+        }
+
+        QVector<Uint32> counts;
+        BucketCounts(bs, w, first_col, last_col, counts);
+        QVector<Range> rs;
 
+        for (Uint32 i = first_col; i < last_col; i++)
+        {
+            Uint32 num_dl = counts[i - first_col];
             if (num_dl == 0)
                 continue;
 
-            int fac = int(100 * ((double)num_dl / (jEnd - jStart)) + 0.5);
+            Uint32 num = BucketStart(i + 1, num_chunks, w) - BucketStart(i, num_chunks, w);
+            int fac = int(100 * ((double)num_dl / num) + 0.5);
             if (rs.empty())
             {
                 Range r = {i, i, fac};
@@ -160,6 +146,38 @@ namespace kt
 
     }
 
+    QRegion ChunkBarRenderer::chunkRegion(const QVector<BitRun>& chunks, Uint32 num_chunks, const QSize& size) const
+    {
+        Uint32 w = size.width();
+        if (chunks.isEmpty() || w == 0)
+            return QRegion();
+
+        // With less chunks then pixels, drawEqual rounds off whole runs of chunks,
+        // so a changed chunk can move the end of a run elsewhere on the bar
+        if (num_chunks <= w)
+            return QRegion(0, 0, size.width(), size.height());
+
+        QVector<QRect> rects;
+        for (const BitRun& r : chunks)
+        {
+            // the columns whose chunk range contains the first and last chunk, see BucketStart
+            int x1 = (int)((((Uint64)r.first + 1) * w - 1) / num_chunks);
+            int x2 = (int)((((Uint64)r.last + 1) * w - 1) / num_chunks);
+
+            // columns are drawn with a pen, which paints one pixel beyond them
+            x1 = qMax(x1 - 1, 0);
+            x2 = qMin(x2 + 1, (int)w - 1);
+            if (!rects.isEmpty() && x1 <= rects.last().right() + 1)
+                rects.last().setRight(qMax(rects.last().right(), x2));
+            else
+                rects.append(QRect(x1, 0, x2 - x1 + 1, size.height()));
+        }
+
+        QRegion region;
+        region.setRects(rects.constData(), rects.count());
+        return region;
+    }
+
     void ChunkBarRenderer::drawAllOn(QPainter* p, const QColor& color, const QRect& contents_rect)
     {
         p->setPen(QPen(color, 1, Qt::SolidLine));
@@ -22,7 +22,10 @@
 #ifndef KTCHUNKBARRENDERER_H
 #define KTCHUNKBARRENDERER_H
 
+#include <QRegion>
+#include <QVector>
 #include <ktcore_export.h>
+#include <util/bitsetkernels.h>
 
 namespace bt
 {
@@ -44,6 +47,15 @@ namespace kt
         void drawEqual(QPainter* p, const bt::BitSet& bs, const QColor& color, const QRect& contents_rect);
         void drawMoreChunksThenPixels(QPainter* p, const bt::BitSet& bs, const QColor& color, const QRect& contents_rect);
         void drawAllOn(QPainter* p, const QColor& color, const QRect& contents_rect);
+
+        /**
+         * Get the pixel columns of a bar which show a list of chunk ranges, the bar only
+         * needs to be redrawn within this region when those chunks change.
+         * @param chunks The chunk ranges, sorted on their first chunk
+         * @param num_chunks The total number of chunks
+         * @param size The size of the bar
+         */
+        QRegion chunkRegion(const QVector<BitRun>& chunks, bt::Uint32 num_chunks, const QSize& size) const;
     };
 
 }
@@ -56,20 +56,26 @@ namespace kt
         suspended_state = false;
         exiting = false;
         ordering = false;
+        list_dirty = false;
+        positions_dirty = false;
 
         QNetworkConfigurationManager* networkConfigurationManager = new QNetworkConfigurationManager(this);
         connect(networkConfigurationManager, &QNetworkConfigurationManager::onlineStateChanged, this, &QueueManager::onOnlineStateChanged);
     }
 
 
+    const int QueueManager::PRIORITY_STEP;
+
     QueueManager::~QueueManager()
     {
-        qDeleteAll(downloads);
+        qDeleteAll(sortedList());
     }
 
     void QueueManager::append(bt::TorrentInterface* tc)
     {
-        downloads.append(tc);
+        queue.insert(tc, tc->getPriority());
+        list_dirty = true;
+        torrent_index.insert(tc->getInfoHash(), tc);
         connect(tc, SIGNAL(diskSpaceLow(bt::TorrentInterface*, bool)), this, SLOT(onLowDiskSpace(bt::TorrentInterface*, bool)));
         connect(tc, SIGNAL(torrentStopped(bt::TorrentInterface*)), this, SLOT(torrentStopped(bt::TorrentInterface*)));
         connect(tc, SIGNAL(updateQueue()), this, SLOT(orderQueue()));
@@ -78,17 +84,89 @@ namespace kt
     void QueueManager::remove(bt::TorrentInterface* tc)
     {
         suspended_torrents.erase(tc);
-        int index = downloads.indexOf(tc);
-        if (index != -1)
-            downloads.takeAt(index)->deleteLater();
+        if (queue.remove(tc))
+        {
+            torrent_index.remove(tc->getInfoHash());
+            list_dirty = true;
+            tc->deleteLater();
+        }
     }
 
     void QueueManager::clear()
     {
         exiting = true;
         suspended_torrents.clear();
-        qDeleteAll(downloads);
+        qDeleteAll(sortedList());
+        queue.clear();
         downloads.clear();
+        list_dirty = false;
+        torrent_index.clear();
+        positions.clear();
+        positions_dirty = false;
+    }
+
+    const QueuePtrList& QueueManager::sortedList() const
+    {
+        if (!list_dirty)
+            return downloads;
+
+        // When the number of torrents didn't change, overwrite the list in place,
+        // so iterators of somebody walking the list remain valid.
+        if (downloads.count() != queue.count())
+        {
+            downloads.clear();
+            downloads.reserve(queue.count());
+            for (PriorityIndex<bt::TorrentInterface>::const_iterator i = queue.begin(); i != queue.end(); ++i)
+                downloads.append(i->second);
+        }
+        else
+        {
+            int idx = 0;
+            for (PriorityIndex<bt::TorrentInterface>::const_iterator i = queue.begin(); i != queue.end(); ++i)
+            {
+                if (downloads.at(idx) != i->second)
+                    downloads[idx] = i->second;
+                idx++;
+            }
+        }
+
+        list_dirty = false;
+        positions_dirty = true;
+        return downloads;
+    }
+
+    void QueueManager::updatePositions() const
+    {
+        const QueuePtrList& list = sortedList();
+        positions.clear();
+        positions.reserve(list.count());
+        int idx = 0;
+        for (bt::TorrentInterface* tc : list)
+            positions.insert(tc, idx++);
+
+        positions_dirty = false;
+    }
+
+    int QueueManager::indexOf(bt::TorrentInterface* tc) const
+    {
+        if (list_dirty || positions_dirty)
+            updatePositions();
+
+        return positions.value(tc, -1);
+    }
+
+    bt::TorrentInterface* QueueManager::find(const bt::SHA1Hash& ih) const
+    {
+        return torrent_index.value(ih, 0);
+    }
+
+    bt::TorrentInterface* QueueManager::find(const QString& ih) const
+    {
+        QByteArray ba = QByteArray::fromHex(ih.toLatin1());
+        if (ba.size() != 20)
+            return 0;
+
+        return find(bt::SHA1Hash((const bt::Uint8*)ba.constData()));
     }
 
     TorrentStartResponse QueueManager::startInternal(bt::TorrentInterface* tc)
@@ -364,7 +442,7 @@ namespace kt
     {
         if (enabled())
         {
-            for (bt::TorrentInterface* tc : qAsConst(downloads))
+            for (bt::TorrentInterface* tc : sortedList())
                 tc->setAllowedToStart(true);
 
             orderQueue();
@@ -373,7 +451,7 @@ namespace kt
         {
             // first get the list of torrents which need to be started
             QList<bt::TorrentInterface*> todo;
-            for (bt::TorrentInterface* tc : qAsConst(downloads))
+            for (bt::TorrentInterface* tc : sortedList())
             {
                 const TorrentStats& s = tc->getStats();
                 if (s.running)
@@ -391,7 +469,8 @@ namespace kt
 
     void QueueManager::stopAll()
     {
-        stop(downloads);
+        QList<bt::TorrentInterface*> todo = sortedList();
+        stop(todo);
     }
 
 
@@ -402,7 +481,7 @@ namespace kt
 
         // first get the list of torrents which need to be started
         QList<bt::TorrentInterface*> todo;
-        for (bt::TorrentInterface* tc : qAsConst(downloads))
+        for (bt::TorrentInterface* tc : sortedList())
         {
             const TorrentStats& s = tc->getStats();
             if (s.running || tc->getJobQueue()->runningJobs() || !s.autostart)
@@ -418,15 +497,13 @@ namespace kt
     void QueueManager::onExit(WaitJob* wjob)
     {
         exiting = true;
-        QList<bt::TorrentInterface*>::iterator i = downloads.begin();
-        while (i != downloads.end())
+        const QList<bt::TorrentInterface*> todo = sortedList();
+        for (bt::TorrentInterface* tc : todo)
         {
-            bt::TorrentInterface* tc = *i;
             if (tc->getStats().running)
             {
                 stopSafely(tc, wjob);
             }
-            i++;
         }
     }
 
@@ -448,10 +525,10 @@ namespace kt
     int QueueManager::getNumRunning(Flags flags)
     {
         int nr = 0;
-        QList<TorrentInterface*>::const_iterator i = downloads.constBegin();
-        while (i != downloads.constEnd())
+        PriorityIndex<bt::TorrentInterface>::const_iterator i = queue.begin();
+        while (i != queue.end())
         {
-            const TorrentInterface* tc = *i;
+            const TorrentInterface* tc = i->second;
             const TorrentStats& s = tc->getStats();
 
             if (s.running)
@@ -466,22 +543,25 @@ namespace kt
 
     const bt::TorrentInterface* QueueManager::getTorrent(Uint32 idx) const
     {
-        if (idx >= (Uint32)downloads.count())
+        const QueuePtrList& list = sortedList();
+        if (idx >= (Uint32)list.count())
             return 0;
         else
-            return downloads[idx];
+            return list.at(idx);
     }
 
     bt::TorrentInterface* QueueManager::getTorrent(bt::Uint32 idx)
     {
-        if (idx >= (Uint32)downloads.count())
+        const QueuePtrList& list = sortedList();
+        if (idx >= (Uint32)list.count())
             return 0;
         else
-            return downloads[idx];
+            return list.at(idx);
     }
 
     QList<bt::TorrentInterface*>::iterator QueueManager::begin()
     {
+        sortedList();
         return downloads.begin();
     }
 
@@ -523,35 +603,70 @@ namespace kt
 
     bool QueueManager::alreadyLoaded(const bt::SHA1Hash& ih) const
     {
-        for (const bt::TorrentInterface* tor : qAsConst(downloads))
+        return torrent_index.contains(ih);
+    }
+
+    void QueueManager::mergeAnnounceList(const bt::SHA1Hash& ih, const TrackerTier* trk)
+    {
+        bt::TorrentInterface* tor = find(ih);
+        if (tor)
         {
-            if (tor->getInfoHash() == ih)
-                return true;
+            TrackersList* ta = tor->getTrackersList();
+            ta->merge(trk);
         }
-        return false;
     }
 
-    void QueueManager::mergeAnnounceList(const bt::SHA1Hash& ih, const TrackerTier* trk)
+    void QueueManager::syncPriorities()
     {
-        for (bt::TorrentInterface* tor : qAsConst(downloads))
+        // pick up priorities which were changed without going through setPriority
+        QList<bt::TorrentInterface*> changed;
+        for (PriorityIndex<bt::TorrentInterface>::const_iterator i = queue.begin(); i != queue.end(); ++i)
         {
-            if (tor->getInfoHash() == ih)
-            {
-                TrackersList* ta = tor->getTrackersList();
-                ta->merge(trk);
+            if (i->second->getPriority() != i->first)
+                changed.append(i->second);
+        }
+
+        for (bt::TorrentInterface* tc : qAsConst(changed))
+            queue.update(tc, tc->getPriority());
+
+        if (!changed.isEmpty())
+            list_dirty = true;
+    }
+
+    void QueueManager::setPriority(bt::TorrentInterface* tc, int p)
+    {
+        tc->setPriority(p);
+        if (queue.update(tc, p))
+            list_dirty = true;
+    }
+
+    void QueueManager::moveTorrent(bt::TorrentInterface* tc, bt::TorrentInterface* after)
+    {
+        syncPriorities();
+        int p = 0;
+        if (!queue.move(tc, after, PRIORITY_STEP, p))
+        {
+            if (!queue.contains(tc) || (after && !queue.contains(after)))
+                return;
+
+            // no room between after and the next torrent, spread everybody out again
+            reindexQueue();
+            if (!queue.move(tc, after, PRIORITY_STEP, p))
                 return;
-            }
         }
+
+        tc->setPriority(p);
+        list_dirty = true;
     }
 
     void QueueManager::orderQueue()
     {
-        if (ordering || !downloads.count() || exiting)
+        if (ordering || queue.isEmpty() || exiting)
             return;
 
         emit orderingQueue();
 
-        downloads.sort(); // sort downloads, even when suspended so that the QM widget is updated
+        syncPriorities(); // even when suspended so that the QM widget is updated
         if (Settings::manuallyControlTorrents() || suspended_state)
         {
             emit queueOrdered();
@@ -560,65 +675,43 @@ namespace kt
 
         RecursiveEntryGuard guard(&ordering); // make sure that recursive entering of this function is not possible
 
-        QueuePtrList download_queue;
-        QueuePtrList seed_queue;
-
-        for (TorrentInterface* tc : qAsConst(downloads))
-        {
-            const TorrentStats& s = tc->getStats();
-            if (s.running || (tc->isAllowedToStart() && !s.stopped_by_error && !tc->getJobQueue()->runningJobs()))
-            {
-                if (s.completed)
-                {
-                    if (s.running || (!tc->overMaxRatio() && !tc->overMaxSeedTime()))
-                        seed_queue.append(tc);
-                }
-                else
-                    download_queue.append(tc);
-            }
-        }
-
-        int num_running = 0;
-        for (bt::TorrentInterface* tc : qAsConst(download_queue))
+        // The list is only rebuilt when the order has changed, otherwise this is a cheap shared copy.
+        // Downloads and seeds are limited independently, so both can be handled in one pass.
+        const QList<bt::TorrentInterface*> todo = sortedList();
+        int num_downloads = 0;
+        int num_seeds = 0;
+        for (bt::TorrentInterface* tc : todo)
         {
             const TorrentStats& s = tc->getStats();
+            if (!s.running && (!tc->isAllowedToStart() || s.stopped_by_error || tc->getJobQueue()->runningJobs()))
+                continue;
 
-            if (num_running < max_downloads || max_downloads == 0)
+            int* num_running = 0;
+            int max_running = 0;
+            if (s.completed)
             {
-                if (!s.running)
-                {
-                    Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
-                    if (startInternal(tc) == bt::START_OK)
-                        num_running++;
-                }
-                else
-                    num_running++;
+                if (!s.running && (tc->overMaxRatio() || tc->overMaxSeedTime()))
+                    continue;
+
+                num_running = &num_seeds;
+                max_running = max_seeds;
             }
             else
             {
-                if (s.running)
-                {
-                    Out(SYS_GEN | LOG_DEBUG) << "QM Stopping: " << s.torrent_name << endl;
-                    stopSafely(tc);
-                }
-                tc->setQueued(true);
+                num_running = &num_downloads;
+                max_running = max_downloads;
             }
-        }
 
-        num_running = 0;
-        for (bt::TorrentInterface* tc : qAsConst(seed_queue))
-        {
-            const TorrentStats& s = tc->getStats();
-            if (num_running < max_seeds || max_seeds == 0)
+            if (*num_running < max_running || max_running == 0)
             {
                 if (!s.running)
                 {
                     Out(SYS_GEN | LOG_DEBUG) << "QM Starting: " << s.torrent_name << endl;
                     if (startInternal(tc) == bt::START_OK)
-                        num_running++;
+                        (*num_running)++;
                 }
                 else
-                    num_running++;
+                    (*num_running)++;
             }
             else
             {
@@ -651,16 +744,20 @@ namespace kt
     {
         if (enabled())
         {
-            // new torrents have the lowest priority
-            // so everybody else gets a higher priority
-            for (TorrentInterface* otc : qAsConst(downloads))
+            // new torrents have the lowest priority, priorities are sparse
+            // so normally there is room below the current lowest one
+            tc->setAllowedToStart(start_torrent);
+            int lowest = queue.lowest(tc, -1);
+            if (lowest == -1)
+                setPriority(tc, PRIORITY_STEP);
+            else if (lowest > 1)
+                setPriority(tc, lowest - 1);
+            else
             {
-                int p = otc->getPriority();
-                otc->setPriority(p + 1);
+                // no more room, spread everybody out again
+                setPriority(tc, 0);
+                reindexQueue();
             }
-            tc->setAllowedToStart(start_torrent);
-            tc->setPriority(0);
-            rearrangeQueue();
             orderQueue();
         }
         else
@@ -672,8 +769,8 @@ namespace kt
 
     void QueueManager::torrentRemoved(bt::TorrentInterface* tc)
     {
+        // priorities stay unique when a torrent is removed, so no need to reindex
         remove(tc);
-        rearrangeQueue();
         orderQueue();
     }
 
@@ -681,7 +778,6 @@ namespace kt
     {
         for (bt::TorrentInterface* tc : qAsConst(tors))
             remove(tc);
-        rearrangeQueue();
         orderQueue();
     }
 
@@ -708,7 +804,8 @@ namespace kt
         }
         else
         {
-            for (TorrentInterface* tc : qAsConst(downloads))
+            const QList<bt::TorrentInterface*> todo = sortedList();
+            for (TorrentInterface* tc : todo)
             {
                 const TorrentStats& s = tc->getStats();
                 if (s.running)
@@ -721,12 +818,6 @@ namespace kt
         emit suspendStateChanged(suspended_state);
     }
 
-    void QueueManager::rearrangeQueue()
-    {
-        downloads.sort();
-        reindexQueue();
-    }
-
     void QueueManager::startSafely(bt::TorrentInterface* tc)
     {
         try
@@ -785,7 +876,8 @@ namespace kt
         bool can_decrease = false;
 
         // find all stalled ones
-        for (bt::TorrentInterface* tc : qAsConst(downloads))
+        syncPriorities();
+        for (bt::TorrentInterface* tc : sortedList())
         {
             if (IsStalled(tc, now, min_stall_time))
             {
@@ -799,20 +891,24 @@ namespace kt
             }
         }
 
-        if (stalled.count() == 0 || stalled.count() == downloads.count() || !can_decrease)
+        if (stalled.count() == 0 || stalled.count() == queue.count() || !can_decrease)
             return;
 
         for (bt::TorrentInterface* tc : qAsConst(stalled))
             Out(SYS_GEN | LOG_NOTICE) << "The torrent " << tc->getStats().torrent_name << " has stalled longer than " << min_stall_time << " minutes, decreasing its priority" << endl;
 
-        downloads.clear();
-        downloads += newlist;
-        downloads += stalled;
-        // redo priorities and then order the queue
-        int prio = downloads.count();
-        for (bt::TorrentInterface* tc : qAsConst(downloads))
+        // Move the stalled ones below the lowest torrent which isn't stalled.
+        // Only when there is no room left there, all priorities are redone.
+        int prio = newlist.last()->getPriority();
+        if (prio - stalled.count() >= 1)
         {
-            tc->setPriority(prio--);
+            for (bt::TorrentInterface* tc : qAsConst(stalled))
+                setPriority(tc, --prio);
+        }
+        else
+        {
+            newlist += stalled;
+            renumber(newlist);
         }
         orderQueue();
     }
@@ -827,7 +923,8 @@ namespace kt
             // running torrents, that they need to reannounce and kill stale peers
             if (network_down_time.isValid() && network_down_time.secsTo(QDateTime::currentDateTime()) > 120)
             {
-                for (bt::TorrentInterface* tc : qAsConst(downloads))
+                const QList<bt::TorrentInterface*> todo = sortedList();
+                for (bt::TorrentInterface* tc : todo)
                 {
                     if (tc->getStats().running)
                         tc->networkUp();
@@ -845,11 +942,19 @@ namespace kt
 
     void QueueManager::reindexQueue()
     {
-        int prio = downloads.count();
+        syncPriorities();
+        const QList<bt::TorrentInterface*> order = sortedList();
+        renumber(order);
+    }
+
+    void QueueManager::renumber(const QList<bt::TorrentInterface*> & order)
+    {
+        int prio = order.count() * PRIORITY_STEP;
         // make sure everybody has an unique priority
-        for (bt::TorrentInterface* tc : qAsConst(downloads))
+        for (bt::TorrentInterface* tc : order)
         {
-            tc->setPriority(prio--);
+            setPriority(tc, prio);
+            prio -= PRIORITY_STEP;
         }
     }
 
@@ -861,9 +966,10 @@ namespace kt
         if (suspended_state)
         {
             QStringList info_hash_list = g.readEntry("suspended_torrents", QStringList());
-            for (bt::TorrentInterface* t : qAsConst(downloads))
+            for (const QString& ih : qAsConst(info_hash_list))
             {
-                if (info_hash_list.contains(t->getInfoHash().toString()))
+                bt::TorrentInterface* t = find(ih);
+                if (t)
                     suspended_torrents.insert(t);
             }
         }
@@ -899,7 +1005,7 @@ namespace kt
         else
             files.insert(tc->getStats().output_path);
 
-        for (bt::TorrentInterface* t : qAsConst(downloads))
+        for (bt::TorrentInterface* t : sortedList())
         {
             if (t == tc)
                 continue;
@@ -24,16 +24,19 @@
 
 #include <set>
 
+#include <QHash>
 #include <QObject>
 #include <KSharedConfig>
 
+#include <util/sha1hash.h>
+#include <util/priorityindex.h>
+
 #include <interfaces/torrentinterface.h>
 #include <interfaces/queuemanagerinterface.h>
 #include <ktcore_export.h>
 
 namespace bt
 {
-    class SHA1Hash;
     struct TrackerTier;
     class WaitJob;
 }
@@ -129,7 +132,7 @@ namespace kt
         void onExit(bt::WaitJob* wjob);
 
         /// Get the number of torrents
-        int count() { return downloads.count(); }
+        int count() const { return queue.count(); }
 
         /// Get the number of downloads
         int countDownloads();
@@ -187,6 +190,26 @@ namespace kt
          */
         bool alreadyLoaded(const bt::SHA1Hash& ih) const;
 
+        /**
+         * Find a torrent by info hash.
+         * @param ih The info hash of a torrent
+         * @return The torrent or 0 if it isn't loaded
+         */
+        bt::TorrentInterface* find(const bt::SHA1Hash& ih) const;
+
+        /**
+         * Find a torrent by info hash.
+         * @param ih The info hash of a torrent in hexadecimal notation
+         * @return The torrent or 0 if it isn't loaded
+         */
+        bt::TorrentInterface* find(const QString& ih) const;
+
+        /**
+         * Get the index of a torrent in the list.
+         * @param tc The torrent
+         * @return The index or -1 if the torrent isn't loaded
+         */
+        int indexOf(bt::TorrentInterface* tc) const;
 
         /**
          * Merge announce lists to a torrent
@@ -224,9 +247,35 @@ namespace kt
 
         /**
          * Reindex the queue priorities.
+         * Priorities are spread PRIORITY_STEP apart, so that torrents can be
+         * moved around afterwards without having to renumber everybody.
          */
         void reindexQueue();
 
+        /**
+         * Change the priority of a torrent.
+         * Torrent priorities may also be changed directly, but then the
+         * change is only noticed at the next orderQueue.
+         * @param tc The torrent
+         * @param p The new priority
+         */
+        void setPriority(bt::TorrentInterface* tc, int p);
+
+        /**
+         * Move a torrent in the queue so that it directly follows another one.
+         * Only the moved torrent gets a new priority, unless there is no room
+         * left between the two, then the queue is reindexed first.
+         * @param tc The torrent
+         * @param after The torrent it should follow, 0 to move it to the top
+         */
+        void moveTorrent(bt::TorrentInterface* tc, bt::TorrentInterface* after);
+
+        /// Get the highest priority in use
+        int highestPriority() const {return queue.highest();}
+
+        /// Spacing between priorities set by reindexQueue
+        static const int PRIORITY_STEP = 1024;
+
         /**
          * Check if a torrent has file conflicts with other torrents.
          * If conflicting are found, a list of names of the conflicting torrents is filled in.
@@ -285,7 +334,6 @@ namespace kt
         void checkDiskSpace(QList<bt::TorrentInterface*> & todo);
         void checkMaxSeedTime(QList<bt::TorrentInterface*> & todo);
         void checkMaxRatio(QList<bt::TorrentInterface*> & todo);
-        void rearrangeQueue();
         bt::TorrentStartResponse startInternal(bt::TorrentInterface* tc);
         bool checkLimits(bt::TorrentInterface* tc, bool interactive);
         bool checkDiskSpace(bt::TorrentInterface* tc, bool interactive);
@@ -294,7 +342,18 @@ namespace kt
         void onOnlineStateChanged(bool);
 
     private:
-        QueuePtrList downloads;
+        const QueuePtrList& sortedList() const;
+        void updatePositions() const;
+        void syncPriorities();
+        void renumber(const QList<bt::TorrentInterface*> & order);
+
+    private:
+        PriorityIndex<bt::TorrentInterface> queue;
+        mutable QueuePtrList downloads;
+        mutable bool list_dirty;
+        QHash<bt::SHA1Hash, bt::TorrentInterface*> torrent_index;
+        mutable QHash<bt::TorrentInterface*, int> positions;
+        mutable bool positions_dirty;
         std::set<bt::TorrentInterface*> suspended_torrents;
         int max_downloads;
         int max_seeds;
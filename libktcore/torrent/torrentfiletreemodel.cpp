@@ -26,9 +26,12 @@
 #include <QIcon>
 #include <QMimeDatabase>
 #include <QMimeType>
+#include <QSet>
 #include <QSortFilterProxyModel>
 #include <QTreeView>
 
+#include <algorithm>
+
 #include <bcodec/bdecoder.h>
 #include <bcodec/bencoder.h>
 #include <bcodec/bnode.h>
@@ -37,23 +40,43 @@
 #include <util/functions.h>
 #include <util/log.h>
 #include <util/error.h>
+#include <util/bitset.h>
+#include <util/bitsetkernels.h>
+#include <util/treefiltermodel.h>
 
 using namespace bt;
 
 namespace kt
 {
 
-    TorrentFileTreeModel::Node::Node(Node* parent, bt::TorrentFileInterface* file,
-                                     const QString& name, const bt::Uint32 total_chunks)
-        : parent(parent), file(file), name(name), size(0), chunks(total_chunks), chunks_set(false), percentage(0.0f)
+    static void CheckFile(bt::TorrentFileInterface* file, Qt::CheckState state, TorrentFileModel::DeselectMode mode)
+    {
+        if (state == Qt::Checked)
+        {
+            if (file->getPriority() == ONLY_SEED_PRIORITY)
+                file->setPriority(NORMAL_PRIORITY);
+            else
+                file->setDoNotDownload(false);
+        }
+        else
+        {
+            if (mode == TorrentFileModel::KEEP_FILES)
+                file->setPriority(ONLY_SEED_PRIORITY);
+            else
+                file->setDoNotDownload(true);
+        }
+    }
+
+    TorrentFileTreeModel::Node::Node(Node* parent, bt::TorrentFileInterface* file, const QString& name, bt::Uint32 pos)
+        : parent(parent), file(file), name(name), row_index(0), first(pos), last(pos + 1), populated(true),
+          size(0), chunks_set(false), num_chunks(0), num_have(0), percentage_set(false), percentage(0.0f)
     {
-        chunks.setAll(false);
     }
 
-    TorrentFileTreeModel::Node::Node(Node* parent, const QString& name, const bt::Uint32 total_chunks)
-        : parent(parent), file(0), name(name), size(0), chunks(total_chunks), chunks_set(false), percentage(0.0f)
+    TorrentFileTreeModel::Node::Node(Node* parent, const QString& name, bt::Uint32 first, bt::Uint32 last)
+        : parent(parent), file(0), name(name), row_index(0), first(first), last(last), populated(false),
+          size(0), chunks_set(false), num_chunks(0), num_have(0), percentage_set(false), percentage(0.0f)
     {
-        chunks.setAll(false);
     }
 
     TorrentFileTreeModel::Node::~Node()
@@ -61,198 +84,96 @@ namespace kt
         qDeleteAll(children);
     }
 
-    void TorrentFileTreeModel::Node::insert(const QString& path, bt::TorrentFileInterface* file, bt::Uint32 num_chunks)
+    void TorrentFileTreeModel::Node::append(Node* child)
     {
-        int p = path.indexOf(bt::DirSeparator());
-        if (p == -1)
-        {
-            // the file is part of this directory
-            children.append(new Node(this, file, path, num_chunks));
-        }
-        else
-        {
-            QString subdir = path.left(p);
-            for (Node* n : qAsConst(children))
-            {
-                if (n->name == subdir)
-                {
-                    n->insert(path.mid(p + 1), file, num_chunks);
-                    return;
-                }
-            }
-
-            Node* n = new Node(this, subdir, num_chunks);
-            children.append(n);
-            n->insert(path.mid(p + 1), file, num_chunks);
-        }
+        child->row_index = children.count();
+        children.append(child);
     }
 
     int TorrentFileTreeModel::Node::row()
     {
-        if (parent)
-            return parent->children.indexOf(this);
-        else
+        return parent ? row_index : 0;
+    }
+
+    TorrentFileTreeModel::Node* TorrentFileTreeModel::Node::childContaining(bt::Uint32 pos)
+    {
+        // children are ordered on their range of files
+        QList<Node*>::const_iterator i = std::upper_bound(children.constBegin(), children.constEnd(), pos,
+                                         [](bt::Uint32 p, const Node* n) {return p < n->first;});
+        if (i == children.constBegin())
             return 0;
+
+        Node* n = *(i - 1);
+        return pos < n->last ? n : 0;
     }
 
-    bt::Uint64 TorrentFileTreeModel::Node::fileSize(const bt::TorrentInterface* tc)
+    bt::Uint64 TorrentFileTreeModel::Node::fileSize(const QVector<bt::TorrentFileInterface*>& files)
     {
         if (size > 0)
             return size;
 
-        if (!file)
-        {
-            // directory
-            for (Node* n : qAsConst(children))
-                size += n->fileSize(tc);
-        }
-        else
-        {
-            size = file->getSize();
-        }
+        for (Uint32 i = first; i < last; i++)
+            size += files[i]->getSize();
         return size;
     }
 
-    void TorrentFileTreeModel::Node::fillChunks()
+    void TorrentFileTreeModel::Node::fillChunks(const QVector<bt::TorrentFileInterface*>& files)
     {
         if (chunks_set)
             return;
 
-        if (!file)
-        {
-            for (Node* n : qAsConst(children))
-            {
-                n->fillChunks();
-                chunks.orBitSet(n->chunks);
-            }
-        }
-        else
-        {
-            for (Uint32 i = file->getFirstChunk(); i <= file->getLastChunk(); i++)
-                chunks.set(i, true);
-        }
-        chunks_set = true;
-    }
+        QVector<ChunkRange> ranges;
+        ranges.reserve(last - first);
+        for (Uint32 i = first; i < last; i++)
+            ranges.append(ChunkRange(files[i]->getFirstChunk(), files[i]->getLastChunk()));
 
-    void TorrentFileTreeModel::Node::updatePercentage(const BitSet& havechunks)
-    {
-        if (!chunks_set)
-            fillChunks(); // make sure we know the chunks which are part of this node
-
-        if (file)
+        // files of a directory are usually next to each other in the torrent, so this mostly merges into one range
+        std::sort(ranges.begin(), ranges.end());
+        chunks.clear();
+        num_chunks = 0;
+        for (const ChunkRange& r : qAsConst(ranges))
         {
-            percentage = file->getDownloadPercentage();
-        }
-        else
-        {
-            if (havechunks.numOnBits() == 0 || chunks.numOnBits() == 0)
-            {
-                percentage = 0.0f;
-            }
-            else if (havechunks.allOn())
-            {
-                percentage = 100.0f;
-            }
+            if (!chunks.isEmpty() && r.first <= chunks.last().second + 1)
+                chunks.last().second = qMax(chunks.last().second, r.second);
             else
-            {
-                // take the chunks of the node and
-                // logical and them with the chunks we have
-                BitSet tmp(chunks);
-                tmp.andBitSet(havechunks);
-
-                percentage = 100.0f * ((float)tmp.numOnBits() / (float)chunks.numOnBits());
-            }
-        }
-
-        if (parent)
-            parent->updatePercentage(havechunks); // update the percentage of the parent
-    }
-
-    void TorrentFileTreeModel::Node::initPercentage(const bt::TorrentInterface* tc, const bt::BitSet& havechunks)
-    {
-        if (!chunks_set)
-            fillChunks();
-
-        if (!tc->getStats().multi_file_torrent)
-        {
-            percentage = bt::Percentage(tc->getStats());
-            return;
-        }
-
-        if (file)
-        {
-            percentage = file->getDownloadPercentage();
+                chunks.append(r);
         }
-        else
-        {
-            if (havechunks.numOnBits() == 0 || chunks.numOnBits() == 0)
-            {
-                percentage = 0.0f;
-            }
-            else if (havechunks.allOn())
-            {
-                percentage = 100.0f;
-            }
-            else
-            {
-                // take the chunks of the node and
-                // logical and them with the chunks we have
-                BitSet tmp(chunks);
-                tmp.andBitSet(havechunks);
 
-                percentage = 100.0f * ((float)tmp.numOnBits() / (float)chunks.numOnBits());
-            }
+        for (const ChunkRange& r : qAsConst(chunks))
+            num_chunks += r.second - r.first + 1;
 
-            for (Node* n : qAsConst(children))
-                n->initPercentage(tc, havechunks); // update the percentage of the children
-        }
+        chunks.squeeze();
+        chunks_set = true;
     }
 
-    bt::Uint64 TorrentFileTreeModel::Node::bytesToDownload(const bt::TorrentInterface* tc)
+    bt::Uint64 TorrentFileTreeModel::Node::bytesToDownload(const QVector<bt::TorrentFileInterface*>& files)
     {
         bt::Uint64 s = 0;
-
-        if (!file)
+        for (Uint32 i = first; i < last; i++)
         {
-            // directory
-            for (Node* n : qAsConst(children))
-                s += n->bytesToDownload(tc);
-        }
-        else
-        {
-            if (!file->doNotDownload())
-                s = file->getSize();
+            if (!files[i]->doNotDownload())
+                s += files[i]->getSize();
         }
         return s;
     }
 
-    Qt::CheckState TorrentFileTreeModel::Node::checkState(const bt::TorrentInterface* tc) const
+    Qt::CheckState TorrentFileTreeModel::Node::checkState(const QVector<bt::TorrentFileInterface*>& files) const
     {
-        if (!file)
+        bool found_checked = false;
+        bool found_unchecked = false;
+        for (Uint32 i = first; i < last; i++)
         {
-            bool found_checked = false;
-            bool found_unchecked = false;
-            // directory
-            for (Node* n : qAsConst(children))
-            {
-                Qt::CheckState s = n->checkState(tc);
-                if (s == Qt::PartiallyChecked)
-                    return s;
-                else if (s == Qt::Checked)
-                    found_checked = true;
-                else
-                    found_unchecked = true;
-
-                if (found_checked && found_unchecked)
-                    return Qt::PartiallyChecked;
-            }
+            const bt::TorrentFileInterface* f = files[i];
+            if (f->doNotDownload() || f->getPriority() == ONLY_SEED_PRIORITY)
+                found_unchecked = true;
+            else
+                found_checked = true;
 
-            return found_checked ? Qt::Checked : Qt::Unchecked;
-        }
-        else
-        {
-            return file->doNotDownload() || file->getPriority() == ONLY_SEED_PRIORITY ? Qt::Unchecked : Qt::Checked;
+            if (found_checked && found_unchecked)
+                return Qt::PartiallyChecked;
         }
+
+        return found_checked ? Qt::Checked : Qt::Unchecked;
     }
 
     void TorrentFileTreeModel::Node::saveExpandedState(const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, BEncoder* enc)
@@ -277,7 +198,7 @@ namespace kt
         }
     }
 
-    void TorrentFileTreeModel::Node::loadExpandedState(const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, BNode* n)
+    void TorrentFileTreeModel::Node::loadExpandedState(TorrentFileTreeModel* model, const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, BNode* n)
     {
         if (file)
             return;
@@ -286,6 +207,10 @@ namespace kt
         if (!dict)
             return;
 
+        // the children need to exist, before we can expand them
+        if (model->canFetchMore(index))
+            model->fetchMore(index);
+
         BValueNode* v = dict->getValue("expanded");
         if (v)
             tv->setExpanded(pm->mapFromSource(index), v->data().toInt() == 1);
@@ -296,7 +221,7 @@ namespace kt
             if (!n->file)
             {
                 if (BDictNode* d = dict->getDict(n->name.toUtf8()))
-                    n->loadExpandedState(index.child(idx, 0), pm, tv, d);
+                    n->loadExpandedState(model, index.child(idx, 0), pm, tv, d);
             }
             idx++;
         }
@@ -314,14 +239,17 @@ namespace kt
     }
 
     TorrentFileTreeModel::TorrentFileTreeModel(bt::TorrentInterface* tc, DeselectMode mode, QObject* parent)
-        : TorrentFileModel(tc, mode, parent), root(0), emit_check_state_change(true)
+        : TorrentFileModel(tc, mode, parent), root(0), emit_check_state_change(true), num_downloaded(0), num_only_seed(0), checking_data(false)
     {
+        resetChunkCounts();
         if (tc)
         {
+            connect(tc, SIGNAL(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)),
+                    this, SLOT(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)));
             if (tc->getStats().multi_file_torrent)
                 constructTree();
             else
-                root = new Node(0, tc->getUserModifiedFileName(), tc->getStats().total_chunks);
+                root = new Node(0, tc->getUserModifiedFileName(), 0, 0);
         }
     }
 
@@ -334,15 +262,25 @@ namespace kt
     void TorrentFileTreeModel::changeTorrent(bt::TorrentInterface* tc)
     {
         beginResetModel();
+        if (this->tc)
+            disconnect(this->tc, SIGNAL(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)),
+                       this, SLOT(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)));
+
         this->tc = tc;
         delete root;
         root = 0;
+        files.clear();
+        positions.clear();
+        changed_dirs.clear();
+        resetChunkCounts();
         if (tc)
         {
+            connect(tc, SIGNAL(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)),
+                    this, SLOT(chunkDownloaded(bt::TorrentInterface*, bt::Uint32)));
             if (tc->getStats().multi_file_torrent)
                 constructTree();
             else
-                root = new Node(0, tc->getUserModifiedFileName(), tc->getStats().total_chunks);
+                root = new Node(0, tc->getUserModifiedFileName(), 0, 0);
         }
         endResetModel();
     }
@@ -350,15 +288,57 @@ namespace kt
 
     void TorrentFileTreeModel::constructTree()
     {
-        bt::Uint32 num_chunks = tc->getStats().total_chunks;
+        // Sort the files on path, so the files of each directory follow each other
+        Uint32 num_files = tc->getNumFiles();
+        QVector<QPair<QString, Uint32> > paths(num_files);
+        for (Uint32 i = 0; i < num_files; i++)
+            paths[i] = qMakePair(tc->getTorrentFile(i).getUserModifiedPath(), i);
+
+        std::sort(paths.begin(), paths.end());
+        files.resize(num_files);
+        positions.resize(num_files);
+        for (Uint32 i = 0; i < num_files; i++)
+        {
+            files[i] = &tc->getTorrentFile(paths[i].second);
+            positions[paths[i].second] = i;
+        }
+
+        // the children are created in fetchMore
         if (!root)
-            root = new Node(0, tc->getUserModifiedFileName(), num_chunks);
+            root = new Node(0, tc->getUserModifiedFileName(), 0, num_files);
+    }
 
-        for (Uint32 i = 0; i < tc->getNumFiles(); i++)
+    QList<TorrentFileTreeModel::Node*> TorrentFileTreeModel::createChildren(Node* n) const
+    {
+        QList<Node*> children;
+        int prefix = n->path().length();
+        Uint32 i = n->first;
+        while (i < n->last)
         {
-            bt::TorrentFileInterface& tf = tc->getTorrentFile(i);
-            root->insert(tf.getUserModifiedPath(), &tf, num_chunks);
+            bt::TorrentFileInterface* tf = files[i];
+            const QString path = tf->getUserModifiedPath();
+            int p = path.indexOf(bt::DirSeparator(), prefix);
+            if (p == -1)
+            {
+                // the file is part of this directory
+                children.append(new Node(n, tf, path.mid(prefix), i));
+                i++;
+            }
+            else
+            {
+                // find the first file which is not in the subdirectory
+                const QString dir = path.left(p + 1);
+                QVector<bt::TorrentFileInterface*>::const_iterator end = std::partition_point(
+                            files.constBegin() + i + 1, files.constBegin() + n->last,
+                            [&dir](bt::TorrentFileInterface* f) {return f->getUserModifiedPath().startsWith(dir);});
+
+                Uint32 j = end - files.constBegin();
+                children.append(new Node(n, path.mid(prefix, p - prefix), i, j));
+                i = j;
+            }
         }
+
+        return children;
     }
 
     void TorrentFileTreeModel::onCodecChange()
@@ -366,6 +346,7 @@ namespace kt
         beginResetModel();
         delete root;
         root = 0;
+        changed_dirs.clear();
         constructTree();
         endResetModel();
     }
@@ -387,6 +368,47 @@ namespace kt
         return 2;
     }
 
+    bool TorrentFileTreeModel::hasChildren(const QModelIndex& parent) const
+    {
+        if (!tc)
+            return false;
+
+        if (!parent.isValid())
+            return true;
+
+        Node* n = (Node*)parent.internalPointer();
+        if (n->file)
+            return false;
+
+        return n->populated ? !n->children.isEmpty() : n->first < n->last;
+    }
+
+    bool TorrentFileTreeModel::canFetchMore(const QModelIndex& parent) const
+    {
+        if (!tc || !parent.isValid())
+            return false;
+
+        Node* n = (Node*)parent.internalPointer();
+        return !n->populated;
+    }
+
+    void TorrentFileTreeModel::fetchMore(const QModelIndex& parent)
+    {
+        if (!canFetchMore(parent))
+            return;
+
+        Node* n = (Node*)parent.internalPointer();
+        QList<Node*> children = createChildren(n);
+        n->populated = true;
+        if (children.isEmpty())
+            return;
+
+        beginInsertRows(parent, 0, children.count() - 1);
+        for (Node* c : qAsConst(children))
+            n->append(c);
+        endInsertRows();
+    }
+
     QVariant TorrentFileTreeModel::headerData(int section, Qt::Orientation orientation, int role) const
     {
         if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
@@ -417,7 +439,7 @@ namespace kt
             case 0: return n->name;
             case 1:
                 if (tc->getStats().multi_file_torrent)
-                    return BytesToString(n->fileSize(tc));
+                    return BytesToString(n->fileSize(files));
                 else
                     return BytesToString(tc->getStats().total_bytes);
             default: return QVariant();
@@ -430,7 +452,7 @@ namespace kt
             case 0: return n->name;
             case 1:
                 if (tc->getStats().multi_file_torrent)
-                    return n->fileSize(tc);
+                    return n->fileSize(files);
                 else
                     return tc->getStats().total_bytes;
             default: return QVariant();
@@ -438,24 +460,9 @@ namespace kt
         }
         else if (role == Qt::DecorationRole && index.column() == 0)
         {
-#if 0
-            if (!n->file && n->children.count() <= 0)
-            {
-                qWarning()<<tc;
-                qWarning()<<tc->getStats().torrent_name;
-            }
-
-            if (n->file)
-            {
-                qWarning()<<n;
-                qWarning()<<n->file;
-                qWarning()<<n->file->getPath();
-            }
-#endif
-
-            // if this is an empty folder then we are in the single file case
+            // if this is not a multi file torrent, the root is the file
             if (!n->file)
-                return n->children.count() > 0 ?
+                return tc->getStats().multi_file_torrent ?
                        QIcon::fromTheme(QStringLiteral("folder")) : QIcon::fromTheme(QMimeDatabase().mimeTypeForFile(tc->getStats().torrent_name).iconName());
             else
                 return QIcon::fromTheme(QMimeDatabase().mimeTypeForFile(n->file->getPath()).iconName());
@@ -463,7 +470,22 @@ namespace kt
         else if (role == Qt::CheckStateRole && index.column() == 0)
         {
             if (tc->getStats().multi_file_torrent)
-                return n->checkState(tc);
+                return n->checkState(files);
+        }
+        else if (role == TreeFilterModel::UnfetchedLeavesRole && index.column() == 0)
+        {
+            // a filter needs to see the files of directories which haven't been expanded
+            if (n->file || n->populated)
+                return QVariant();
+
+            QStringList names;
+            names.reserve(n->last - n->first);
+            for (Uint32 i = n->first; i < n->last; i++)
+            {
+                const QString path = files[i]->getUserModifiedPath();
+                names.append(path.mid(path.lastIndexOf(bt::DirSeparator()) + 1));
+            }
+            return names;
         }
 
         return QVariant();
@@ -516,44 +538,27 @@ namespace kt
 
         if (!n->file)
         {
-            bool reenable = false;
-            if (emit_check_state_change)
-            {
-                reenable = true;
-                emit_check_state_change = false;
-            }
-
-            for (int i = 0; i < n->children.count(); i++)
-            {
-                // recurse down the tree
-                setCheckState(index.child(i, 0), state);
-            }
+            // change all files below the directory, including the ones which are not shown yet
+            for (Uint32 i = n->first; i < n->last; i++)
+                CheckFile(files[i], state, mode);
 
-            if (reenable)
-                emit_check_state_change = true;
+            subtreeChanged(n);
         }
         else
         {
-            bt::TorrentFileInterface* file = n->file;
-            if (state == Qt::Checked)
-            {
-                if (file->getPriority() == ONLY_SEED_PRIORITY)
-                    file->setPriority(NORMAL_PRIORITY);
-                else
-                    file->setDoNotDownload(false);
-            }
-            else
-            {
-                if (mode == KEEP_FILES)
-                    file->setPriority(ONLY_SEED_PRIORITY);
-                else
-                    file->setDoNotDownload(true);
-            }
-            dataChanged(createIndex(index.row(), 0), createIndex(index.row(), columnCount(index) - 1));
+            CheckFile(n->file, state, mode);
+            dataChanged(createIndex(index.row(), 0, n), createIndex(index.row(), columnCount(index) - 1, n));
+        }
+
+        // only seed chunks do not count in the percentage of a directory
+        resetPercentages(n);
 
-            QModelIndex parent = index.parent();
-            if (parent.isValid())
-                dataChanged(parent, parent); // parent needs to be updated to
+        // parents need to be updated too
+        QModelIndex parent = index.parent();
+        while (parent.isValid())
+        {
+            dataChanged(parent, parent);
+            parent = parent.parent();
         }
 
         if (emit_check_state_change)
@@ -561,18 +566,26 @@ namespace kt
         return true;
     }
 
-    void TorrentFileTreeModel::modifyPathOfFiles(Node* n, const QString& path)
+    void TorrentFileTreeModel::subtreeChanged(Node* n)
     {
-        if (!tc)
-            return;
+        int last_column = columnCount(QModelIndex()) - 1;
+        emit dataChanged(createIndex(n->row(), 0, n), createIndex(n->row(), last_column, n));
 
-        for (int i = 0; i < n->children.count(); i++)
+        QList<Node*> todo;
+        todo.append(n);
+        while (!todo.isEmpty())
         {
-            Node* c = n->children.at(i);
-            if (!c->file) // another directory, continue recursively
-                modifyPathOfFiles(c, path + c->name + bt::DirSeparator());
-            else
-                c->file->setUserModifiedPath(path + c->name);
+            Node* d = todo.takeLast();
+            if (d->children.isEmpty())
+                continue;
+
+            Node* last = d->children.last();
+            emit dataChanged(createIndex(0, 0, d->children.first()), createIndex(last->row(), last_column, last));
+            for (Node* c : qAsConst(d->children))
+            {
+                if (!c->file)
+                    todo.append(c);
+            }
         }
     }
 
@@ -599,23 +612,31 @@ namespace kt
             // we are in a directory
             if (!n->parent)
             {
-                // toplevel directory name has changed
+                // toplevel directory name has changed, it is not part of the path of the files
                 tc->setUserModifiedFileName(name);
+                n->name = name;
+                dataChanged(index, index);
+                return true;
             }
-            else
+
+            // Check if there is a sibling with the same name
+            for (const Node* sibling : qAsConst(n->parent->children))
             {
-                // Check if there is a sibling with the same name
-                for (const Node* sibling : qAsConst(n->parent->children))
-                {
-                    if (sibling != n && sibling->name == name)
-                        return false;
-                }
+                if (sibling != n && sibling->name == name)
+                    return false;
             }
 
+            const QString old_path = n->path();
             n->name = name;
+            const QString new_path = n->path();
             dataChanged(index, index);
-            // modify the path of all files
-            modifyPathOfFiles(n, n->path());
+
+            // modify the path of all files, the files stay in the same order relative to each other
+            for (Uint32 i = n->first; i < n->last; i++)
+            {
+                bt::TorrentFileInterface* file = files[i];
+                file->setUserModifiedPath(new_path + file->getUserModifiedPath().mid(old_path.length()));
+            }
             return true;
         }
         else
@@ -664,33 +685,12 @@ namespace kt
         if (!tc || !tc->getStats().multi_file_torrent)
             return;
 
-        invertCheck(index(0, 0, QModelIndex()));
-    }
-
-    void TorrentFileTreeModel::invertCheck(const QModelIndex& idx)
-    {
-        if (!tc)
-            return;
+        for (bt::TorrentFileInterface* file : qAsConst(files))
+            CheckFile(file, file->doNotDownload() ? Qt::Checked : Qt::Unchecked, mode);
 
-        Node* n = static_cast<Node*>(idx.internalPointer());
-        if (!n)
-            return;
-
-        if (!n->file)
-        {
-            for (int i = 0; i < n->children.count(); i++)
-            {
-                // recurse down the tree
-                invertCheck(idx.child(i, 0));
-            }
-        }
-        else
-        {
-            if (n->file->doNotDownload())
-                setData(idx, Qt::Checked, Qt::CheckStateRole);
-            else
-                setData(idx, Qt::Unchecked, Qt::CheckStateRole);
-        }
+        resetPercentages(root);
+        subtreeChanged(root);
+        checkStateChanged();
     }
 
     bt::Uint64 TorrentFileTreeModel::bytesToDownload()
@@ -699,7 +699,7 @@ namespace kt
             return 0;
 
         if (tc->getStats().multi_file_torrent)
-            return root->bytesToDownload(tc);
+            return root->bytesToDownload(files);
         else
             return tc->getStats().total_bytes;
     }
@@ -730,7 +730,7 @@ namespace kt
             n = dec.decode();
             if (n && n->getType() == BNode::DICT)
             {
-                root->loadExpandedState(index(0, 0, QModelIndex()), pm, tv, n);
+                root->loadExpandedState(this, index(0, 0, QModelIndex()), pm, tv, n);
             }
         }
         catch (bt::Error& err)
@@ -787,4 +787,144 @@ namespace kt
             setData(idx, newpriority, Qt::UserRole);
         }
     }
+
+    float TorrentFileTreeModel::nodePercentage(Node* n) const
+    {
+        if (!tc->getStats().multi_file_torrent)
+            return bt::Percentage(tc->getStats());
+
+        if (n->file)
+            return n->file->getDownloadPercentage();
+
+        if (n->percentage_set)
+            return n->percentage;
+
+        // only seed chunks are not counted, they will never be downloaded
+        const BitSet& downloaded = tc->downloadedChunksBitSet();
+        const BitSet& only_seed = tc->onlySeedChunksBitSet();
+        n->fillChunks(files);
+        n->num_have = 0;
+        for (const ChunkRange& r : qAsConst(n->chunks))
+            n->num_have += CountOnBitsAndNot(downloaded, only_seed, r.first, r.second + 1);
+
+        n->percentage = n->num_chunks == 0 ? 0.0f : 100.0f * ((float)n->num_have / (float)n->num_chunks);
+        n->percentage_set = true;
+        return n->percentage;
+    }
+
+    void TorrentFileTreeModel::resetPercentages(Node* n)
+    {
+        for (Node* p = n->parent; p; p = p->parent)
+        {
+            p->percentage_set = false;
+            changed_dirs.insert(p);
+        }
+
+        QList<Node*> todo;
+        todo.append(n);
+        while (!todo.isEmpty())
+        {
+            Node* d = todo.takeLast();
+            if (d->file)
+                continue;
+
+            d->percentage_set = false;
+            changed_dirs.insert(d);
+            todo.append(d->children);
+        }
+    }
+
+    void TorrentFileTreeModel::resetChunkCounts()
+    {
+        num_downloaded = tc ? tc->downloadedChunksBitSet().numOnBits() : 0;
+        num_only_seed = tc ? tc->onlySeedChunksBitSet().numOnBits() : 0;
+        checking_data = tc && tc->getStats().status == bt::CHECKING_DATA;
+    }
+
+    void TorrentFileTreeModel::chunkDownloaded(bt::TorrentInterface* tor, bt::Uint32 chunk)
+    {
+        if (tor != tc)
+            return;
+
+        num_downloaded++;
+        if (!root || !tc->getStats().multi_file_torrent)
+            return;
+
+        if (tc->onlySeedChunksBitSet().get(chunk))
+            return;
+
+        // Files are ordered on chunk in the torrent, find the first one which contains the chunk
+        Uint32 num_files = tc->getNumFiles();
+        Uint32 lo = 0;
+        Uint32 hi = num_files;
+        while (lo < hi)
+        {
+            Uint32 mid = (lo + hi) / 2;
+            if (tc->getTorrentFile(mid).getLastChunk() < chunk)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        // Find the directories shown so far which contain those files, a chunk can be part
+        // of multiple files in the same directory, but may only be counted once
+        QSet<Node*> dirs;
+        for (Uint32 i = lo; i < num_files && tc->getTorrentFile(i).getFirstChunk() <= chunk; i++)
+        {
+            Uint32 pos = positions[i];
+            for (Node* n = root; n && !n->file; n = n->childContaining(pos))
+            {
+                if (n->percentage_set)
+                    dirs.insert(n);
+            }
+        }
+
+        for (Node* n : qAsConst(dirs))
+        {
+            if (n->num_have < n->num_chunks)
+                n->num_have++;
+
+            n->percentage = 100.0f * ((float)n->num_have / (float)n->num_chunks);
+            changed_dirs.insert(n);
+        }
+    }
+
+    void TorrentFileTreeModel::update()
+    {
+        // A finished data check, chunks which were lost, or only seed chunks which were changed
+        // by another view: the chunks which count are different, so count them again
+        bool checking = tc && tc->getStats().status == bt::CHECKING_DATA;
+        if (tc && root && ((checking_data && !checking) ||
+                           tc->downloadedChunksBitSet().numOnBits() != num_downloaded ||
+                           tc->onlySeedChunksBitSet().numOnBits() != num_only_seed))
+        {
+            resetChunkCounts();
+            resetPercentages(root);
+        }
+        checking_data = checking;
+
+        // A directory can get a lot of chunks between two updates, only tell the view once
+        if (changed_dirs.isEmpty())
+            return;
+
+        int last_column = columnCount(QModelIndex()) - 1;
+        for (Node* n : qAsConst(changed_dirs))
+            emit dataChanged(createIndex(n->row(), 0, n), createIndex(n->row(), last_column, n));
+
+        changed_dirs.clear();
+    }
+
+    TorrentFileTreeModel::Node* TorrentFileTreeModel::fileNode(bt::Uint32 file_index) const
+    {
+        if (!root || file_index >= (Uint32)positions.size())
+            return 0;
+
+        // Follow the directories which contain the file, stops at a directory whose children haven't been created
+        Uint32 pos = positions[file_index];
+        Node* n = root;
+        while (n && !n->file)
+            n = n->childContaining(pos);
+
+        return n;
+    }
 }
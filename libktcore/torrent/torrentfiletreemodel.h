@@ -22,6 +22,11 @@
 #ifndef KTTORRENTFILETREEMODEL_H
 #define KTTORRENTFILETREEMODEL_H
 
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
 #include "torrentfilemodel.h"
 #include <util/bitset.h>
 
@@ -44,34 +49,46 @@ namespace kt
     {
         Q_OBJECT
     protected:
+        /// Inclusive range of chunks
+        typedef QPair<bt::Uint32, bt::Uint32> ChunkRange;
+
+        /**
+         * Node in the file tree. The files below a node are the range [first, last) of
+         * the files vector, the children of a directory are only created when they are needed.
+         */
         struct KTCORE_EXPORT Node
         {
             Node* parent;
             bt::TorrentFileInterface* file; // file (0 if this is a directory)
             QString name; // name or directory
             QList<Node*> children; // child dirs
+            int row_index; // row of this node in the children of it's parent
+            bt::Uint32 first;
+            bt::Uint32 last;
+            bool populated; // children have been created
             bt::Uint64 size;
-            bt::BitSet chunks;
+            QVector<ChunkRange> chunks; // sorted and non overlapping chunk ranges of a directory
             bool chunks_set;
+            bt::Uint32 num_chunks;
+            bt::Uint32 num_have;
+            bool percentage_set;
             float percentage;
 
-            Node(Node* parent, bt::TorrentFileInterface* file, const QString& name,
-                 bt::Uint32 total_chunks);
-            Node(Node* parent, const QString& name, bt::Uint32 total_chunks);
+            Node(Node* parent, bt::TorrentFileInterface* file, const QString& name, bt::Uint32 pos);
+            Node(Node* parent, const QString& name, bt::Uint32 first, bt::Uint32 last);
             ~Node();
 
-            void insert(const QString& path, bt::TorrentFileInterface* file, bt::Uint32 num_chunks);
+            void append(Node* child);
             int row();
-            bt::Uint64 fileSize(const bt::TorrentInterface* tc);
-            bt::Uint64 bytesToDownload(const bt::TorrentInterface* tc);
-            Qt::CheckState checkState(const bt::TorrentInterface* tc) const;
+            Node* childContaining(bt::Uint32 pos);
+            bt::Uint64 fileSize(const QVector<bt::TorrentFileInterface*>& files);
+            bt::Uint64 bytesToDownload(const QVector<bt::TorrentFileInterface*>& files);
+            Qt::CheckState checkState(const QVector<bt::TorrentFileInterface*>& files) const;
             QString path();
-            void fillChunks();
-            void updatePercentage(const bt::BitSet& havechunks);
-            void initPercentage(const bt::TorrentInterface* tc, const bt::BitSet& havechunks);
+            void fillChunks(const QVector<bt::TorrentFileInterface*>& files);
 
             void saveExpandedState(const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, bt::BEncoder* enc);
-            void loadExpandedState(const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, bt::BNode* node);
+            void loadExpandedState(TorrentFileTreeModel* model, const QModelIndex& index, QSortFilterProxyModel* pm, QTreeView* tv, bt::BNode* node);
         };
     public:
         TorrentFileTreeModel(bt::TorrentInterface* tc, DeselectMode mode, QObject* parent);
@@ -80,6 +97,9 @@ namespace kt
         virtual void changeTorrent(bt::TorrentInterface* tc);
         virtual int rowCount(const QModelIndex& parent) const;
         virtual int columnCount(const QModelIndex& parent) const;
+        virtual bool hasChildren(const QModelIndex& parent) const;
+        virtual bool canFetchMore(const QModelIndex& parent) const;
+        virtual void fetchMore(const QModelIndex& parent);
         virtual QVariant headerData(int section, Qt::Orientation orientation, int role) const;
         virtual QVariant data(const QModelIndex& index, int role) const;
         virtual QModelIndex parent(const QModelIndex& index) const;
@@ -95,18 +115,48 @@ namespace kt
         virtual QString dirPath(const QModelIndex& idx);
         virtual void changePriority(const QModelIndexList& indexes, bt::Priority newpriority);
         virtual void onCodecChange();
+        virtual void update();
+
+    protected:
+        /**
+         * Get the download percentage of a node, for directories this
+         * is calculated the first time it is needed and kept up to date when chunks are downloaded.
+         */
+        float nodePercentage(Node* n) const;
+
+        /**
+         * Forget the percentage of a node, the directories below it and the directories above it,
+         * they are calculated again when they are needed. Used when chunks are lost or the file
+         * selection changes, the chunks which count are different then.
+         */
+        void resetPercentages(Node* n);
+
+        /// Emit dataChanged for a node and all it's children which have been created
+        void subtreeChanged(Node* n);
+
+        /// Get the node of a file, 0 if it has not been created yet
+        Node* fileNode(bt::Uint32 file_index) const;
+
+    private slots:
+        void chunkDownloaded(bt::TorrentInterface* tc, bt::Uint32 chunk);
 
     private:
         void constructTree();
-        void invertCheck(const QModelIndex& idx);
+        void resetChunkCounts();
+        QList<Node*> createChildren(Node* n) const;
         bool setCheckState(const QModelIndex& index, Qt::CheckState state);
         bool setName(const QModelIndex& index, const QString& name);
-        void modifyPathOfFiles(Node* n, const QString& path);
 
 
     protected:
         Node* root;
         bool emit_check_state_change;
+        QVector<bt::TorrentFileInterface*> files; // files sorted on path
+        QVector<bt::Uint32> positions; // position in files of each file index
+        QSet<Node*> changed_dirs; // directories whose percentage changed since the last update
+        bt::Uint32 num_downloaded; // downloaded chunks, counted with the chunkDownloaded signal
+        bt::Uint32 num_only_seed; // only seed chunks, at the last update
+        bool checking_data; // a data check was running at the last update
     };
 
 }
@@ -0,0 +1,215 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include "bitsetkernels.h"
+
+#include <string.h>
+#include <QtAlgorithms>
+#include <util/bitset.h>
+
+using namespace bt;
+
+namespace kt
+{
+    namespace
+    {
+        // Operations applied to the bytes or words of two bitsets before counting
+        struct First
+        {
+            template<class T> T operator()(T a, T) const {return a;}
+        };
+
+        struct And
+        {
+            template<class T> T operator()(T a, T b) const {return T(a & b);}
+        };
+
+        struct AndNot
+        {
+            template<class T> T operator()(T a, T b) const {return T(a & ~b);}
+        };
+
+        struct Xor
+        {
+            template<class T> T operator()(T a, T b) const {return T(a ^ b);}
+        };
+
+        inline quint64 LoadWord(const Uint8* data)
+        {
+            quint64 w;
+            memcpy(&w, data, sizeof(w));
+            return w;
+        }
+
+        /*
+         * Bits are stored most significant bit first, so the order of the bytes in a word
+         * doesn't matter for counting, only the partial bytes at the start and end need masking.
+         */
+        template<class Op>
+        Uint32 CountRange(const Uint8* a, const Uint8* b, Uint32 first, Uint32 last, Op op)
+        {
+            if (first >= last)
+                return 0;
+
+            Uint32 first_byte = first >> 3;
+            Uint32 last_byte = (last - 1) >> 3;
+            Uint8 head = 0xFF >> (first & 7);
+            Uint8 tail = 0xFF << (7 - ((last - 1) & 7));
+            if (first_byte == last_byte)
+                return qPopulationCount(quint8(op(a[first_byte], b[first_byte]) & head & tail));
+
+            Uint32 count = qPopulationCount(quint8(op(a[first_byte], b[first_byte]) & head));
+            Uint32 i = first_byte + 1;
+            for (; i + 8 <= last_byte; i += 8)
+                count += qPopulationCount(op(LoadWord(a + i), LoadWord(b + i)));
+
+            for (; i < last_byte; i++)
+                count += qPopulationCount(quint8(op(a[i], b[i])));
+
+            count += qPopulationCount(quint8(op(a[last_byte], b[last_byte]) & tail));
+            return count;
+        }
+
+        /// Find the runs of bits which are set after applying op, skips or extends runs a word or byte at a time
+        template<class Op>
+        void FindRuns(const Uint8* a, const Uint8* b, Uint32 num_bits, Op op, QVector<BitRun>& runs)
+        {
+            runs.clear();
+            bool in_run = false;
+            Uint32 run_start = 0;
+            Uint32 i = 0;
+            while (i < num_bits)
+            {
+                Uint32 step = 1;
+                int value = -1;
+                if ((i & 7) == 0 && i + 64 <= num_bits)
+                {
+                    quint64 w = op(LoadWord(a + (i >> 3)), LoadWord(b + (i >> 3)));
+                    if (w == 0 || w == ~quint64(0))
+                    {
+                        step = 64;
+                        value = w == 0 ? 0 : 1;
+                    }
+                }
+
+                if (value == -1 && (i & 7) == 0 && i + 8 <= num_bits)
+                {
+                    Uint8 v = op(a[i >> 3], b[i >> 3]);
+                    if (v == 0 || v == 0xFF)
+                    {
+                        step = 8;
+                        value = v == 0 ? 0 : 1;
+                    }
+                }
+
+                if (value == -1)
+                    value = (op(a[i >> 3], b[i >> 3]) & (0x80 >> (i & 7))) ? 1 : 0;
+
+                if (value && !in_run)
+                {
+                    run_start = i;
+                    in_run = true;
+                }
+                else if (!value && in_run)
+                {
+                    BitRun r = {run_start, i - 1};
+                    runs.append(r);
+                    in_run = false;
+                }
+
+                i += step;
+            }
+
+            if (in_run)
+            {
+                BitRun r = {run_start, num_bits - 1};
+                runs.append(r);
+            }
+        }
+    }
+
+    Uint32 CountOnBits(const BitSet& bs, Uint32 first, Uint32 last)
+    {
+        last = qMin(last, bs.getNumBits());
+        return CountRange(bs.getData(), bs.getData(), first, last, First());
+    }
+
+    Uint32 CountOnBitsAnd(const BitSet& a, const BitSet& b, Uint32 first, Uint32 last)
+    {
+        last = qMin(last, qMin(a.getNumBits(), b.getNumBits()));
+        return CountRange(a.getData(), b.getData(), first, last, And());
+    }
+
+    Uint32 CountOnBitsAndNot(const BitSet& a, const BitSet& b, Uint32 first, Uint32 last)
+    {
+        // bits of a beyond the end of b are not masked
+        Uint32 end = qMin(last, a.getNumBits());
+        Uint32 masked_end = qMin(end, b.getNumBits());
+        Uint32 count = CountRange(a.getData(), b.getData(), first, masked_end, AndNot());
+        if (masked_end < end)
+            count += CountRange(a.getData(), a.getData(), qMax(first, masked_end), end, First());
+        return count;
+    }
+
+    void OnBitRuns(const BitSet& bs, QVector<BitRun>& runs)
+    {
+        FindRuns(bs.getData(), bs.getData(), bs.getNumBits(), First(), runs);
+    }
+
+    void DifferentBitRuns(const BitSet& a, const BitSet& b, QVector<BitRun>& runs)
+    {
+        FindRuns(a.getData(), b.getData(), qMin(a.getNumBits(), b.getNumBits()), Xor(), runs);
+
+        // bits beyond the end of the shortest set are all different
+        Uint32 common = qMin(a.getNumBits(), b.getNumBits());
+        Uint32 num_bits = qMax(a.getNumBits(), b.getNumBits());
+        if (common < num_bits)
+        {
+            if (!runs.isEmpty() && runs.last().last + 1 == common)
+            {
+                runs.last().last = num_bits - 1;
+            }
+            else
+            {
+                BitRun r = {common, num_bits - 1};
+                runs.append(r);
+            }
+        }
+    }
+
+    void BucketCounts(const BitSet& bs, Uint32 num_buckets, QVector<Uint32>& counts)
+    {
+        BucketCounts(bs, num_buckets, 0, num_buckets, counts);
+    }
+
+    void BucketCounts(const BitSet& bs, Uint32 num_buckets, Uint32 first, Uint32 last, QVector<Uint32>& counts)
+    {
+        last = qMin(last, num_buckets);
+        counts.resize(first < last ? last - first : 0);
+        Uint32 num_bits = bs.getNumBits();
+        Uint32 start = BucketStart(first, num_bits, num_buckets);
+        for (Uint32 i = first; i < last; i++)
+        {
+            Uint32 end = BucketStart(i + 1, num_bits, num_buckets);
+            counts[i - first] = CountRange(bs.getData(), bs.getData(), start, end, First());
+            start = end;
+        }
+    }
+}
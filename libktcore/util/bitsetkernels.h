@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_BITSETKERNELS_HH
+#define KT_BITSETKERNELS_HH
+
+#include <QVector>
+#include <util/constants.h>
+#include <ktcore_export.h>
+
+namespace bt
+{
+    class BitSet;
+}
+
+namespace kt
+{
+    /*
+     * Functions which work on ranges of a BitSet a 64 bit word at a time,
+     * instead of calling BitSet::get for every bit. All ranges are clamped
+     * to the number of bits in the bitsets.
+     */
+
+    /// Inclusive range of bits which are all set
+    struct BitRun
+    {
+        bt::Uint32 first;
+        bt::Uint32 last;
+    };
+
+    /// Count the bits set in the range [first, last)
+    KTCORE_EXPORT bt::Uint32 CountOnBits(const bt::BitSet& bs, bt::Uint32 first, bt::Uint32 last);
+
+    /// Count the bits set in both a and b in the range [first, last), without creating a temporary BitSet
+    KTCORE_EXPORT bt::Uint32 CountOnBitsAnd(const bt::BitSet& a, const bt::BitSet& b, bt::Uint32 first, bt::Uint32 last);
+
+    /// Count the bits set in a but not in b in the range [first, last), without creating a temporary BitSet
+    KTCORE_EXPORT bt::Uint32 CountOnBitsAndNot(const bt::BitSet& a, const bt::BitSet& b, bt::Uint32 first, bt::Uint32 last);
+
+    /// Get all runs of set bits, in order
+    KTCORE_EXPORT void OnBitRuns(const bt::BitSet& bs, QVector<BitRun>& runs);
+
+    /// Get all runs of bits which differ between a and b, in order
+    KTCORE_EXPORT void DifferentBitRuns(const bt::BitSet& a, const bt::BitSet& b, QVector<BitRun>& runs);
+
+    /// Get the first bit of a bucket, when dividing num_bits bits in num_buckets equally sized buckets
+    inline bt::Uint32 BucketStart(bt::Uint32 bucket, bt::Uint32 num_bits, bt::Uint32 num_buckets)
+    {
+        return (bt::Uint32)((bt::Uint64)bucket * num_bits / num_buckets);
+    }
+
+    /**
+     * Count the bits set in each of num_buckets equally sized buckets, bucket i
+     * covers the range [BucketStart(i), BucketStart(i + 1)). Used to draw a chunk bar
+     * when there are more chunks than pixels.
+     */
+    KTCORE_EXPORT void BucketCounts(const bt::BitSet& bs, bt::Uint32 num_buckets, QVector<bt::Uint32>& counts);
+
+    /// Count the bits set in the buckets [first, last) only, counts[0] is the count of bucket first
+    KTCORE_EXPORT void BucketCounts(const bt::BitSet& bs, bt::Uint32 num_buckets, bt::Uint32 first, bt::Uint32 last, QVector<bt::Uint32>& counts);
+}
+
+#endif
@@ -0,0 +1,203 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KT_PRIORITYINDEX_HH
+#define KT_PRIORITYINDEX_HH
+
+#include <functional>
+#include <map>
+
+#include <QHash>
+
+namespace kt
+{
+    /**
+     * Keeps a set of items ordered by priority (highest first). Inserting,
+     * removing and changing the priority of an item are all O(log n), so
+     * the order can be maintained incrementally instead of sorting the
+     * whole list each time it is needed. Items with the same priority keep
+     * the order in which they were inserted.
+     *
+     * The priority of an item is cached in the index, so when it changes,
+     * update needs to be called.
+     */
+    template <class Item>
+    class PriorityIndex
+    {
+    public:
+        typedef std::multimap<int, Item*, std::greater<int> > Map;
+        typedef typename Map::const_iterator const_iterator;
+        typedef typename Map::const_reverse_iterator const_reverse_iterator;
+
+        PriorityIndex() {}
+
+        /// Insert an item with a priority, if it is already present its priority is updated
+        void insert(Item* item, int priority)
+        {
+            typename QHash<Item*, typename Map::iterator>::iterator i = index.find(item);
+            if (i != index.end())
+            {
+                if (i.value()->first == priority)
+                    return;
+
+                entries.erase(i.value());
+                i.value() = entries.insert(std::make_pair(priority, item));
+            }
+            else
+                index.insert(item, entries.insert(std::make_pair(priority, item)));
+        }
+
+        /// Remove an item, returns false if it was not present
+        bool remove(Item* item)
+        {
+            typename QHash<Item*, typename Map::iterator>::iterator i = index.find(item);
+            if (i == index.end())
+                return false;
+
+            entries.erase(i.value());
+            index.erase(i);
+            return true;
+        }
+
+        /**
+         * Change the priority of an item.
+         * @return true if the priority was different from the cached one
+         */
+        bool update(Item* item, int priority)
+        {
+            typename QHash<Item*, typename Map::iterator>::iterator i = index.find(item);
+            if (i == index.end() || i.value()->first == priority)
+                return false;
+
+            entries.erase(i.value());
+            i.value() = entries.insert(std::make_pair(priority, item));
+            return true;
+        }
+
+        /**
+         * Move an item so that it directly follows another one, by giving it a
+         * priority between the two neighbours. Only the moved item changes priority.
+         * @param item The item to move
+         * @param after The item it should follow, 0 to move it to the top
+         * @param step Distance from the neighbour when moving to the top or bottom
+         * @param priority Set to the new priority of item
+         * @return false if there is no free priority between the neighbours, nothing is changed then
+         */
+        bool move(Item* item, const Item* after, int step, int& priority)
+        {
+            typename QHash<Item*, typename Map::iterator>::iterator i = index.find(item);
+            if (i == index.end() || item == after)
+                return false;
+
+            typename Map::iterator next = entries.begin();
+            int high = 0;
+            if (after)
+            {
+                typename QHash<Item*, typename Map::iterator>::const_iterator a = index.find(const_cast<Item*>(after));
+                if (a == index.end())
+                    return false;
+
+                high = a.value()->first;
+                next = a.value();
+                ++next;
+            }
+
+            if (next != entries.end() && next->second == item)
+            {
+                // already in the right place
+                priority = next->first;
+                return true;
+            }
+
+            if (!after)
+            {
+                priority = next == entries.end() ? step : next->first + step;
+            }
+            else
+            {
+                // keep priorities positive at the bottom of the queue
+                int low = next != entries.end() ? next->first : qMax(0, high - 2 * step);
+                if (high - low < 2)
+                    return false;
+
+                priority = low + (high - low) / 2;
+            }
+
+            entries.erase(i.value());
+            // insert before the items with the same priority, so it ends up right after after
+            i.value() = entries.insert(entries.lower_bound(priority), std::make_pair(priority, item));
+            return true;
+        }
+
+        /// Remove all items
+        void clear()
+        {
+            entries.clear();
+            index.clear();
+        }
+
+        /// Does the index contain an item
+        bool contains(Item* item) const {return index.contains(item);}
+
+        /// Get the cached priority of an item (def if it is not present)
+        int priority(Item* item, int def = 0) const
+        {
+            typename QHash<Item*, typename Map::iterator>::const_iterator i = index.find(item);
+            return i != index.end() ? i.value()->first : def;
+        }
+
+        /// Get the highest priority (def if the index is empty)
+        int highest(int def = 0) const
+        {
+            return entries.empty() ? def : entries.begin()->first;
+        }
+
+        /**
+         * Get the lowest priority.
+         * @param skip Item to leave out of consideration
+         * @param def Returned when there are no other items
+         */
+        int lowest(const Item* skip = 0, int def = 0) const
+        {
+            for (const_reverse_iterator i = entries.rbegin(); i != entries.rend(); ++i)
+            {
+                if (i->second != skip)
+                    return i->first;
+            }
+            return def;
+        }
+
+        /// Get the number of items
+        int count() const {return index.count();}
+
+        /// Is the index empty
+        bool isEmpty() const {return entries.empty();}
+
+        /// Iterate over all (priority, item) pairs, highest priority first
+        const_iterator begin() const {return entries.begin();}
+        const_iterator end() const {return entries.end();}
+
+    private:
+        Map entries;
+        QHash<Item*, typename Map::iterator> index;
+    };
+}
+
+#endif
@@ -20,6 +20,8 @@
 
 #include "treefiltermodel.h"
 
+#include <QStringList>
+
 namespace kt
 {
 
@@ -39,6 +41,26 @@ namespace kt
         if (!idx.isValid())
             return false;
 
+        // children which have not been created yet, match the names of the leaves below it
+        if (sourceModel()->canFetchMore(idx))
+        {
+            QVariant leaves = sourceModel()->data(idx, UnfetchedLeavesRole);
+            if (leaves.isValid())
+            {
+                const QRegExp rx = filterRegExp();
+                if (rx.isEmpty())
+                    return true;
+
+                const QStringList names = leaves.toStringList();
+                for (const QString& name : names)
+                {
+                    if (name.contains(rx))
+                        return true;
+                }
+                return false;
+            }
+        }
+
         // if we are in a leaf return filterAcceptsRow
         if (!idx.child(0, 0).isValid())
             return QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
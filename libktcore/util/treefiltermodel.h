@@ -32,6 +32,16 @@ namespace kt
     class KTCORE_EXPORT TreeFilterModel : public QSortFilterProxyModel
     {
     public:
+        enum
+        {
+            /**
+             * Source models which create children on demand can answer this role for a node whose
+             * children have not been fetched yet. The value is a QStringList with the names of all
+             * the leaves below the node, so they can be filtered without creating the children.
+             */
+            UnfetchedLeavesRole = Qt::UserRole + 64
+        };
+
         TreeFilterModel(QObject* parent = 0);
         virtual ~TreeFilterModel();
 
@@ -19,7 +19,9 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  ***************************************************************************/
 
+#include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <algorithm>
 #include <plasma/theme.h>
 #include "chunkbar.h"
 
@@ -45,35 +47,84 @@ namespace ktplasma
         bt::BitSet dc((const bt::Uint8*)downloaded.data(), num_chunks);
         bt::BitSet ec((const bt::Uint8*)excluded.data(), num_chunks);
 
-        if (downloaded_chunks != dc || excluded_chunks != ec)
+        if (pixmap.isNull() || downloaded_chunks.getNumBits() != dc.getNumBits() || excluded_chunks.getNumBits() != ec.getNumBits())
         {
             downloaded_chunks = dc;
             excluded_chunks = ec;
+            dirty = QRegion(pixmap.rect());
             update();
+            return;
         }
+
+        // Only the columns of the chunks which changed need to be redrawn
+        QVector<kt::BitRun> changed;
+        QVector<kt::BitRun> changed_excluded;
+        kt::DifferentBitRuns(downloaded_chunks, dc, changed);
+        kt::DifferentBitRuns(excluded_chunks, ec, changed_excluded);
+        if (changed.isEmpty() && changed_excluded.isEmpty())
+            return;
+
+        if (!changed_excluded.isEmpty())
+        {
+            changed += changed_excluded;
+            std::sort(changed.begin(), changed.end(), [](const kt::BitRun& a, const kt::BitRun& b) {return a.first < b.first;});
+        }
+
+        downloaded_chunks = dc;
+        excluded_chunks = ec;
+        dirty += chunkRegion(changed, dc.getNumBits(), pixmap.size());
+        update();
     }
 
-    void ChunkBar::paintChunks(QPainter* p, const QStyleOptionGraphicsItem* option,
-                               const QColor& color, const bt::BitSet& chunks)
+    void ChunkBar::paintChunks(QPainter* p, const QRect& rect, const QColor& color, const bt::BitSet& chunks)
     {
-        Uint32 w = option->rect.width();
+        Uint32 w = rect.width();
         if (chunks.allOn())
-            drawAllOn(p, color, option->rect);
+            drawAllOn(p, color, rect);
         else if (chunks.getNumBits() > w)
-            drawMoreChunksThenPixels(p, chunks, color, option->rect);
+            drawMoreChunksThenPixels(p, chunks, color, rect);
         else
-            drawEqual(p, chunks, color, option->rect);
+            drawEqual(p, chunks, color, rect);
     }
 
     void ChunkBar::paint(QPainter* p, const QStyleOptionGraphicsItem* option, QWidget* widget)
     {
         Q_UNUSED(widget);
-        QColor highlight_color = palette().color(QPalette::Active, QPalette::Highlight);
-        paintChunks(p, option, highlight_color, downloaded_chunks);
-        if (excluded_chunks.numOnBits() > 0)
+        if (pixmap.isNull() || pixmap.size() != option->rect.size())
+        {
+            pixmap = QPixmap(option->rect.size());
+            dirty = QRegion(pixmap.rect());
+        }
+
+        if (!dirty.isEmpty())
         {
-            QColor excluded_color = palette().color(QPalette::Active, QPalette::Mid);
-            paintChunks(p, option, excluded_color, excluded_chunks);
+            QPainter painter(&pixmap);
+            painter.setClipRegion(dirty);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(pixmap.rect(), Qt::transparent);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+            QColor highlight_color = palette().color(QPalette::Active, QPalette::Highlight);
+            paintChunks(&painter, pixmap.rect(), highlight_color, downloaded_chunks);
+            if (excluded_chunks.numOnBits() > 0)
+            {
+                QColor excluded_color = palette().color(QPalette::Active, QPalette::Mid);
+                paintChunks(&painter, pixmap.rect(), excluded_color, excluded_chunks);
+            }
+            dirty = QRegion();
+        }
+
+        p->drawPixmap(option->rect.topLeft(), pixmap);
+    }
+
+    void ChunkBar::changeEvent(QEvent* ev)
+    {
+        // the colors come from the palette, so everything needs to be redrawn
+        if (ev->type() == QEvent::PaletteChange)
+        {
+            pixmap = QPixmap();
+            update();
         }
+        QGraphicsWidget::changeEvent(ev);
     }
 }
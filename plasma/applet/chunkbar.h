@@ -23,6 +23,8 @@
 #define KTPLASMACHUNKBAR_H
 
 #include <QGraphicsWidget>
+#include <QPixmap>
+#include <QRegion>
 #include <torrent/chunkbarrenderer.h>
 #include <util/bitset.h>
 
@@ -41,13 +43,17 @@ namespace ktplasma
         void updateBitSets(int num_chunks, const QByteArray& downloaded, const QByteArray& excluded);
         virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget);
 
+    protected:
+        virtual void changeEvent(QEvent* ev);
+
     private:
-        void paintChunks(QPainter* p, const QStyleOptionGraphicsItem* option,
-                         const QColor& color, const bt::BitSet& chunks);
+        void paintChunks(QPainter* p, const QRect& rect, const QColor& color, const bt::BitSet& chunks);
 
     private:
         bt::BitSet downloaded_chunks;
         bt::BitSet excluded_chunks;
+        QPixmap pixmap;
+        QRegion dirty; // part of the pixmap which needs to be redrawn
     };
 
 }
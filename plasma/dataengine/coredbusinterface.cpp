@@ -19,9 +19,15 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  ***************************************************************************/
 
+#include <bcodec/bnode.h>
+#include <bcodec/bdecoder.h>
+#include <util/error.h>
+#include <util/log.h>
 #include "coredbusinterface.h"
 #include "engine.h"
 
+using namespace bt;
+
 namespace ktplasma
 {
 
@@ -35,6 +41,7 @@ namespace ktplasma
 
         con.connect("org.ktorrent.ktorrent", "/core", "org.ktorrent.core", "torrentAdded", this, SLOT(torrentAdded(const QString&)));
         con.connect("org.ktorrent.ktorrent", "/core", "org.ktorrent.core", "torrentRemoved", this, SLOT(torrentRemoved(const QString&)));
+        con.connect("org.ktorrent.ktorrent", "/core", "org.ktorrent.core", "statsChanged", this, SLOT(statsChanged(const QByteArray&)));
     }
 
 
@@ -53,7 +60,11 @@ namespace ktplasma
             {
                 engine->addTorrent(tor);
             }
+            updateStats(QStringList());
         }
+
+        // Only changed torrents are sent to us from now on, without the chunk bitsets
+        core->call("subscribeStats", 0u);
     }
 
     void CoreDBusInterface::update()
@@ -63,10 +74,46 @@ namespace ktplasma
     void CoreDBusInterface::torrentAdded(const QString& tor)
     {
         engine->addTorrent(tor);
+        updateStats(QStringList() << tor);
     }
 
     void CoreDBusInterface::torrentRemoved(const QString& tor)
     {
         engine->removeTorrent(tor);
     }
+
+    void CoreDBusInterface::updateStats(const QStringList& torrents)
+    {
+        QDBusReply<QByteArray> r = core->call("torrentStats", torrents, 0u);
+        if (r.isValid())
+            statsChanged(r.value());
+    }
+
+    void CoreDBusInterface::statsChanged(const QByteArray& stats)
+    {
+        BDecoder dec(stats, false, 0);
+        BNode* node = 0;
+        try
+        {
+            node = dec.decode();
+            if (!node || node->getType() != BNode::DICT)
+                throw bt::Error("Root not a dict !");
+
+            BDictNode* dict = (BDictNode*)node;
+            const QStringList keys = dict->keys();
+            foreach (const QString& ih, keys)
+            {
+                BDictNode* d = dict->getDict(ih.toLatin1());
+                TorrentDBusInterface* tor = engine->torrent_map.find(ih);
+                if (d && tor)
+                    tor->setStats(d);
+            }
+        }
+        catch (bt::Error& err)
+        {
+            Out(SYS_GEN | LOG_DEBUG) << "Failed to decode stats: " << err.toString() << endl;
+        }
+
+        delete node;
+    }
 }
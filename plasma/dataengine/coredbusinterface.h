@@ -45,6 +45,11 @@ namespace ktplasma
     private slots:
         void torrentAdded(const QString& tor);
         void torrentRemoved(const QString& tor);
+        void statsChanged(const QByteArray& stats);
+
+    private:
+        /// Get the stats of a number of torrents (all if empty) in one call
+        void updateStats(const QStringList& torrents);
 
     private:
         QDBusInterface* core;
@@ -129,7 +129,6 @@ namespace ktplasma
     void Engine::addTorrent(const QString& tor)
     {
         torrent_map.insert(tor, new TorrentDBusInterface(tor, this));
-        updateSourceEvent(tor);
         setData("core", "num_torrents", torrent_map.count());
     }
 
@@ -63,34 +63,7 @@ namespace ktplasma
             if (!node || node->getType() != BNode::DICT)
                 throw bt::Error("Root not a dict !");
 
-            BDictNode* dict = (BDictNode*)node;
-            const QStringList keys = dict->keys();
-            foreach (const QString& key, keys)
-            {
-                BValueNode* vn = dict->getValue(key);
-                if (!vn)
-                    continue;
-
-                if (key == "downloaded_chunks" || key == "excluded_chunks")
-                {
-                    engine->setData(info_hash, key, vn->data().toByteArray());
-                }
-                else
-                {
-                    switch (vn->data().getType())
-                    {
-                    case bt::Value::STRING:
-                        engine->setData(info_hash, key, QString::fromUtf8(vn->data().toByteArray()));
-                        break;
-                    case bt::Value::INT:
-                        engine->setData(info_hash, key, vn->data().toInt());
-                        break;
-                    case bt::Value::INT64:
-                        engine->setData(info_hash, key, vn->data().toInt64());
-                        break;
-                    }
-                }
-            }
+            setStats((BDictNode*)node);
         }
         catch (bt::Error& err)
         {
@@ -99,4 +72,35 @@ namespace ktplasma
 
         delete node;
     }
+
+    void TorrentDBusInterface::setStats(bt::BDictNode* dict)
+    {
+        const QStringList keys = dict->keys();
+        foreach (const QString& key, keys)
+        {
+            BValueNode* vn = dict->getValue(key);
+            if (!vn)
+                continue;
+
+            if (key == "downloaded_chunks" || key == "excluded_chunks")
+            {
+                engine->setData(info_hash, key, vn->data().toByteArray());
+            }
+            else
+            {
+                switch (vn->data().getType())
+                {
+                case bt::Value::STRING:
+                    engine->setData(info_hash, key, QString::fromUtf8(vn->data().toByteArray()));
+                    break;
+                case bt::Value::INT:
+                    engine->setData(info_hash, key, vn->data().toInt());
+                    break;
+                case bt::Value::INT64:
+                    engine->setData(info_hash, key, vn->data().toInt64());
+                    break;
+                }
+            }
+        }
+    }
 }
@@ -25,6 +25,11 @@
 #include <QDBusInterface>
 #include <QObject>
 
+namespace bt
+{
+    class BDictNode;
+}
+
 namespace ktplasma
 {
     class Engine;
@@ -39,6 +44,9 @@ namespace ktplasma
         virtual ~TorrentDBusInterface();
 
         void update();
+
+        /// Set the data of the torrent from a decoded stats dictionary
+        void setStats(bt::BDictNode* dict);
     private:
         QString info_hash;
         Engine* engine;
@@ -55,13 +55,7 @@ namespace kt
     void AvailabilityChunkBar::setTC(bt::TorrentInterface* tc)
     {
         curr_tc = tc;
-        QSize s = contentsRect().size();
-        //Out() << "Pixmap : " << s.width() << " " << s.height() << endl;
-        pixmap = QPixmap(s);
-        pixmap.fill(palette().color(QPalette::Active, QPalette::Base));
-        QPainter painter(&pixmap);
-        drawBarContents(&painter);
-        update();
+        drawPixmap();
     }
 }
 
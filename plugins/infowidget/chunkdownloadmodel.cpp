@@ -21,6 +21,8 @@
 
 #include "chunkdownloadmodel.h"
 
+#include <algorithm>
+
 #include <KLocalizedString>
 
 #include <interfaces/torrentfileinterface.h>
@@ -32,7 +34,7 @@ using namespace bt;
 namespace kt
 {
 
-    ChunkDownloadModel::Item::Item(ChunkDownloadInterface* cd, const QString& files) : cd(cd), files(files)
+    ChunkDownloadModel::Item::Item(ChunkDownloadInterface* cd, const QString& files) : cd(cd), files(files), row(0)
     {
         cd->getStats(stats);
     }
@@ -89,6 +91,32 @@ namespace kt
         qDeleteAll(items);
     }
 
+    QString ChunkDownloadModel::filesOfChunk(Uint32 chunk) const
+    {
+        if (!tc || file_last_chunks.isEmpty())
+            return QString();
+
+        // the first file which ends at or after the chunk, the following files
+        // contain the chunk as long as they start at or before it
+        QString files;
+        int n = 0;
+        QVector<Uint32>::const_iterator i = std::lower_bound(file_last_chunks.begin(), file_last_chunks.end(), chunk);
+        for (Uint32 idx = i - file_last_chunks.begin(); idx < (Uint32)file_last_chunks.count(); idx++)
+        {
+            const bt::TorrentFileInterface& tf = tc.data()->getTorrentFile(idx);
+            if (chunk < tf.getFirstChunk())
+                break;
+
+            if (n > 0)
+                files += QStringLiteral(", ");
+
+            files += tf.getUserModifiedPath();
+            n++;
+        }
+
+        return files;
+    }
+
     void ChunkDownloadModel::downloadAdded(bt::ChunkDownloadInterface* cd)
     {
         if (!tc)
@@ -96,49 +124,34 @@ namespace kt
 
         bt::ChunkDownloadInterface::Stats stats;
         cd->getStats(stats);
-        QString files;
-        int n = 0;
-        if (tc.data()->getStats().multi_file_torrent)
-        {
-            for (Uint32 i = 0; i < tc.data()->getNumFiles(); i++)
-            {
-                const bt::TorrentFileInterface& tf = tc.data()->getTorrentFile(i);
-                if (stats.chunk_index >= tf.getFirstChunk() && stats.chunk_index <= tf.getLastChunk())
-                {
-                    if (n > 0)
-                        files += QStringLiteral(", ");
-
-                    files += tf.getUserModifiedPath();
-                    n++;
-                }
-                else if (stats.chunk_index < tf.getFirstChunk())
-                    break;
-            }
-        }
 
-        Item* nitem = new Item(cd, files);
+        Item* nitem = new Item(cd, filesOfChunk(stats.chunk_index));
+        nitem->row = items.count();
         items.append(nitem);
-        insertRow(items.count() - 1);
+        item_map.insert(cd, nitem);
+        insertRow(nitem->row);
     }
 
     void ChunkDownloadModel::downloadRemoved(bt::ChunkDownloadInterface* cd)
     {
-        for (QVector<Item*>::iterator i = items.begin(); i != items.end(); i++)
-        {
-            const Item* item = *i;
-            if (item->cd == cd)
-            {
-                removeRow(i - items.begin());
-                break;
-            }
-        }
+        Item* item = item_map.value(cd);
+        if (item)
+            removeRow(item->row);
     }
 
     void ChunkDownloadModel::changeTC(bt::TorrentInterface* tc)
     {
         qDeleteAll(items);
         items.clear();
+        item_map.clear();
+        file_last_chunks.clear();
         this->tc = tc;
+        if (tc && tc->getStats().multi_file_torrent)
+        {
+            file_last_chunks.reserve(tc->getNumFiles());
+            for (Uint32 i = 0; i < tc->getNumFiles(); i++)
+                file_last_chunks.append(tc->getTorrentFile(i).getLastChunk());
+        }
         reset();
     }
 
@@ -146,29 +159,30 @@ namespace kt
     {
         qDeleteAll(items);
         items.clear();
+        item_map.clear();
         reset();
     }
 
     void ChunkDownloadModel::update()
     {
-        int idx = 0;
-        int lowest = -1;
-        int highest = -1;
-
-        foreach (Item* i, items)
+        // emit dataChanged per run of changed downloads
+        int first = -1;
+        for (int i = 0; i < items.count(); i++)
         {
-            if (i->changed())
+            if (items[i]->changed())
             {
-                if (lowest == -1)
-                    lowest = idx;
-                highest = idx;
+                if (first == -1)
+                    first = i;
+            }
+            else if (first != -1)
+            {
+                emit dataChanged(index(first, 1), index(i - 1, 3));
+                first = -1;
             }
-            idx++;
         }
 
-        // emit only one data changed signal
-        if (lowest != -1)
-            emit dataChanged(index(lowest, 1), index(highest, 3));
+        if (first != -1)
+            emit dataChanged(index(first, 1), index(items.count() - 1, 3));
     }
 
     int ChunkDownloadModel::rowCount(const QModelIndex& parent) const
@@ -245,8 +259,13 @@ namespace kt
     {
         beginRemoveRows(QModelIndex(), row, row + count - 1);
         for (int i = 0; i < count; i++)
+        {
+            item_map.remove(items[row + i]->cd);
             delete items[row + i];
+        }
         items.remove(row, count);
+        for (int i = row; i < items.count(); i++)
+            items[i]->row = i;
         endRemoveRows();
         return true;
     }
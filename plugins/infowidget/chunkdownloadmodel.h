@@ -23,6 +23,7 @@
 #define KTCHUNKDOWNLOADMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QVector>
 #include <interfaces/chunkdownloadinterface.h>
 #include <interfaces/torrentinterface.h>
@@ -74,6 +75,7 @@ namespace kt
             mutable bt::ChunkDownloadInterface::Stats stats;
             bt::ChunkDownloadInterface* cd;
             QString files;
+            int row;
 
             Item(bt::ChunkDownloadInterface* cd, const QString& files);
 
@@ -81,9 +83,15 @@ namespace kt
             QVariant data(int col) const;
             QVariant sortData(int col) const;
         };
+    private:
+        QString filesOfChunk(bt::Uint32 chunk) const;
+
     private:
         QVector<Item*> items;
+        QHash<bt::ChunkDownloadInterface*, Item*> item_map;
         bt::TorrentInterface::WPtr tc;
+        // last chunk of every file of a multi file torrent, files are ordered by chunk
+        QVector<bt::Uint32> file_last_chunks;
     };
 
 }
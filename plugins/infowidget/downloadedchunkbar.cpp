@@ -21,6 +21,8 @@
 #include <QPainter>
 #include <QToolTip>
 
+#include <algorithm>
+
 #include "downloadedchunkbar.h"
 
 #include <util/bitset.h>
@@ -51,36 +53,43 @@ namespace kt
     void DownloadedChunkBar::setTC(bt::TorrentInterface* tc)
     {
         curr_tc = tc;
-        QSize s = contentsRect().size();
-        //Out() << "Pixmap : " << s.width() << " " << s.height() << endl;
-        pixmap = QPixmap(s);
-        pixmap.fill(palette().color(QPalette::Active, QPalette::Base));
-        QPainter painter(&pixmap);
-        drawBarContents(&painter);
-        update();
+        drawPixmap();
     }
 
     void DownloadedChunkBar::updateBar(bool force)
     {
         const BitSet& bs = getBitSet();
         QSize s = contentsRect().size();
-        bool changed = !(curr == bs);
 
+        BitSet ebs = curr_ebs;
         if (curr_tc)
         {
-            BitSet ebs = curr_tc->excludedChunksBitSet();
-            ebs.orBitSet(curr_tc->onlySeedChunksBitSet()),
-                         changed = changed || !(curr_ebs == ebs);
-            curr_ebs = ebs;
+            ebs = curr_tc->excludedChunksBitSet();
+            ebs.orBitSet(curr_tc->onlySeedChunksBitSet());
         }
 
-        if (changed || pixmap.isNull() || pixmap.width() != s.width() || force)
+        if (force || pixmap.isNull() || pixmap.size() != s ||
+                curr.getNumBits() != bs.getNumBits() || curr_ebs.getNumBits() != ebs.getNumBits())
+        {
+            curr_ebs = ebs;
+            drawPixmap();
+        }
+        else
         {
-            pixmap = QPixmap(s);
-            pixmap.fill(palette().color(QPalette::Active, QPalette::Base));
-            QPainter painter(&pixmap);
-            drawBarContents(&painter);
-            update();
+            // Only repaint the columns of the chunks which were downloaded or (de)selected since the last time
+            QVector<BitRun> changed;
+            QVector<BitRun> changed_excluded;
+            DifferentBitRuns(curr, bs, changed);
+            DifferentBitRuns(curr_ebs, ebs, changed_excluded);
+            curr_ebs = ebs;
+            if (!changed_excluded.isEmpty())
+            {
+                changed += changed_excluded;
+                std::sort(changed.begin(), changed.end(), [](const BitRun& a, const BitRun& b) {return a.first < b.first;});
+            }
+
+            if (!changed.isEmpty())
+                drawChangedChunks(changed);
         }
     }
 
@@ -23,6 +23,8 @@
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
+#include <QHostAddress>
+#include <QRunnable>
 #include <QStandardPaths>
 
 #include <util/log.h>
@@ -35,10 +37,41 @@ using namespace bt;
 
 namespace kt
 {
+    namespace
+    {
+        /// Number of addresses remembered in the cache
+        const int CACHE_SIZE = 4096;
+
+        /// Maximum number of addresses looked up by one task
+        const int MAX_BATCH_SIZE = 64;
+
+        class LookupTask : public QRunnable
+        {
+        public:
+            LookupTask(GeoIPManager* manager, const QVector<quint32>& ips) : manager(manager), ips(ips)
+            {}
+
+            virtual void run()
+            {
+                manager->lookup(ips);
+            }
+
+        private:
+            GeoIPManager* manager;
+            QVector<quint32> ips;
+        };
+    }
+
     QUrl GeoIPManager::geoip_url = QUrl(QStringLiteral("http://geolite.maxmind.com/download/geoip/database/GeoLiteCountry/GeoIP.dat.gz"));
 
-    GeoIPManager::GeoIPManager(QObject* parent): QObject(parent), geo_ip(0), decompress_thread(0)
+    GeoIPManager::GeoIPManager(QObject* parent): QObject(parent), geo_ip(0), decompress_thread(0), cache(CACHE_SIZE), database_pending(false)
     {
+        connect(&timer, SIGNAL(timeout()), this, SLOT(startLookups()));
+        timer.setSingleShot(true);
+
+        // a GeoIP handle can only be used by one thread at a time
+        pool.setMaxThreadCount(1);
+
 #ifdef USE_SYSTEM_GEOIP
         geo_ip = GeoIP_open_type(GEOIP_COUNTRY_EDITION, GEOIP_STANDARD);
 #else
@@ -52,7 +85,7 @@ namespace kt
         }
         else
         {
-            geo_ip = GeoIP_open(QFile::encodeName(geoip_data_file).data(), 0);
+            openDataBase(geoip_data_file);
             if (geo_ip)
             {
                 QFileInfo fi(geoip_data_file);
@@ -70,6 +103,9 @@ namespace kt
 
     GeoIPManager::~GeoIPManager()
     {
+        pool.clear();
+        pool.waitForDone();
+
         if (geo_ip)
             GeoIP_delete(geo_ip);
 
@@ -81,12 +117,111 @@ namespace kt
         }
     }
 
-    int GeoIPManager::findCountry(const QString& addr)
+    bool GeoIPManager::toIPv4Address(const QString& addr, quint32& ip)
+    {
+        QHostAddress a;
+        if (!a.setAddress(addr))
+            return false;
+
+        bool ok = false;
+        ip = a.toIPv4Address(&ok);
+        return ok;
+    }
+
+    bool GeoIPManager::cachedCountry(quint32 ip, int& country_id)
+    {
+        const int* id = cache.object(ip);
+        if (!id)
+            return false;
+
+        country_id = *id;
+        return true;
+    }
+
+    void GeoIPManager::findCountry(quint32 ip)
+    {
+        if ((!geo_ip && !database_pending) || queued.contains(ip) || cache.contains(ip))
+            return;
+
+        queued.insert(ip);
+        to_lookup.append(ip);
+        if (geo_ip && !timer.isActive())
+            timer.start(0);
+    }
+
+    void GeoIPManager::startLookups()
     {
         if (!geo_ip)
-            return 0;
+            return;
+
+        for (int i = 0; i < to_lookup.count(); i += MAX_BATCH_SIZE)
+            pool.start(new LookupTask(this, to_lookup.mid(i, MAX_BATCH_SIZE)));
+        to_lookup.clear();
+    }
+
+    void GeoIPManager::lookup(const QVector<quint32>& ips)
+    {
+        QVector<Result> found;
+        found.reserve(ips.count());
+
+        QMutexLocker lock(&mutex);
+        for (quint32 ip : ips)
+        {
+            Result r = {ip, geo_ip ? GeoIP_id_by_ipnum(geo_ip, ip) : 0};
+            found.append(r);
+        }
+
+        // Only wake up the manager for the first batch, the others are picked up with it
+        bool wake_up = results.isEmpty();
+        results += found;
+        if (wake_up)
+            QMetaObject::invokeMethod(this, "processResults", Qt::QueuedConnection);
+    }
+
+    void GeoIPManager::processResults()
+    {
+        QVector<Result> done;
+        {
+            QMutexLocker lock(&mutex);
+            done.swap(results);
+        }
+
+        for (const Result& r : qAsConst(done))
+        {
+            queued.remove(r.ip);
+            cache.insert(r.ip, new int(r.country_id));
+            emit countryFound(r.ip, r.country_id);
+        }
+    }
+
+    void GeoIPManager::openDataBase(const QString& file)
+    {
+        QMutexLocker lock(&mutex);
+        if (geo_ip)
+        {
+            GeoIP_delete(geo_ip);
+            geo_ip = 0;
+        }
+
+        geo_ip = GeoIP_open(QFile::encodeName(file).data(), 0);
+        cache.clear();
+    }
+
+    void GeoIPManager::startPendingLookups()
+    {
+        database_pending = false;
+        if (geo_ip)
+        {
+            if (!to_lookup.isEmpty() && !timer.isActive())
+                timer.start(0);
+        }
         else
-            return GeoIP_id_by_name(geo_ip, addr.toAscii().data());
+        {
+            // there is no database to look them up in
+            for (quint32 ip : qAsConst(to_lookup))
+                queued.remove(ip);
+            to_lookup.clear();
+        }
     }
 
     QString GeoIPManager::countryCode(int country_id)
@@ -109,6 +244,7 @@ namespace kt
     {
 #ifndef USE_SYSTEM_GEOIP
         Out(SYS_INW | LOG_NOTICE) << "Downloading GeoIP database: " << geoip_url << endl;
+        database_pending = true;
         download_destination = kt::DataDir(CreateIfNotExists) + geoip_url.fileName();
         KIO::CopyJob* job = KIO::copy(geoip_url, QUrl::fromLocalFile(download_destination), KIO::Overwrite | KIO::HideProgressInfo);
         connect(job, SIGNAL(result(KJob*)), this, SLOT(databaseDownloadFinished(KJob*)));
@@ -120,6 +256,7 @@ namespace kt
         if (job->error())
         {
             Out(SYS_INW | LOG_IMPORTANT) << "Failed to download GeoIP database: " << job->errorString() << endl;
+            startPendingLookups();
             return;
         }
 
@@ -127,14 +264,10 @@ namespace kt
         {
             Out(SYS_INW | LOG_NOTICE) << "GeoIP database downloaded, opening ...  " << endl;
             geoip_data_file = download_destination;
-            if (geo_ip)
-            {
-                GeoIP_delete(geo_ip);
-                geo_ip = 0;
-            }
-            geo_ip = GeoIP_open(QFile::encodeName(geoip_data_file).data(), 0);
+            openDataBase(geoip_data_file);
             if (!geo_ip)
                 Out(SYS_INW | LOG_NOTICE) << "Failed to open GeoIP database  " << endl;
+            startPendingLookups();
         }
         else
         {
@@ -152,12 +285,7 @@ namespace kt
         if (!decompress_thread->error())
         {
             geoip_data_file = kt::DataDir() + QLatin1String("geoip.dat");
-            if (geo_ip)
-            {
-                GeoIP_delete(geo_ip);
-                geo_ip = 0;
-            }
-            geo_ip = GeoIP_open(QFile::encodeName(geoip_data_file).data(), 0);
+            openDataBase(geoip_data_file);
             if (!geo_ip)
                 Out(SYS_INW | LOG_NOTICE) << "Failed to open GeoIP database  " << endl;
         }
@@ -165,6 +293,7 @@ namespace kt
         decompress_thread->wait();
         delete decompress_thread;
         decompress_thread = 0;
+        startPendingLookups();
     }
 
 
@@ -21,9 +21,15 @@
 #ifndef KT_GEOIPMANAGER_H
 #define KT_GEOIPMANAGER_H
 
+#include <QCache>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 #include <QUrl>
+#include <QVector>
 
 #ifdef USE_SYSTEM_GEOIP
 #include <GeoIP.h>
@@ -44,6 +50,7 @@ namespace kt
 
     /**
      * Manages GeoIP database. Downloads it from the internet and handles all queries to it.
+     * Queries are done in batches on a background thread, the results are kept in an LRU cache.
      */
     class GeoIPManager : public QObject
     {
@@ -53,11 +60,28 @@ namespace kt
         virtual ~GeoIPManager();
 
         /**
-         * Find the country given an IP address
-         * @param addr The IP address
-         * @return The country ID
+         * Convert an IP address to the binary form used for lookups.
+         * @param addr The IP address, IPv4 or IPv4 mapped IPv6
+         * @param ip The address in host byte order
+         * @return false if addr is not an IPv4 address, the database only covers IPv4
          */
-        int findCountry(const QString& addr);
+        static bool toIPv4Address(const QString& addr, quint32& ip);
+
+        /**
+         * Find the country of an IP address in the cache.
+         * @param ip The IP address
+         * @param country_id Set to the country ID if found
+         * @return true if the address is in the cache
+         */
+        bool cachedCountry(quint32 ip, int& country_id);
+
+        /**
+         * Find the country of an IP address in the background, countryFound will be emitted
+         * with the result. Addresses which are already in the cache are not looked up again.
+         * While the database is being downloaded, the address is looked up once it is opened.
+         * @param ip The IP address
+         */
+        void findCountry(quint32 ip);
 
         /**
          * Get the name of the country
@@ -82,15 +106,49 @@ namespace kt
         /// Download the database
         void downloadDataBase();
 
+        /**
+         * Look up a batch of addresses in the database (called from the thread pool).
+         * @param ips The IP addresses
+         */
+        void lookup(const QVector<quint32>& ips);
+
+    signals:
+        /**
+         * The country of an IP address has been found.
+         * @param ip The IP address
+         * @param country_id The country ID, 0 if unknown
+         */
+        void countryFound(quint32 ip, int country_id);
+
     private slots:
         void databaseDownloadFinished(KJob* job);
         void decompressFinished();
+        void startLookups();
+        void processResults();
 
     private:
-        GeoIP* geo_ip;
+        void openDataBase(const QString& file);
+        void startPendingLookups();
+
+    private:
+        struct Result
+        {
+            quint32 ip;
+            int country_id;
+        };
+
+        GeoIP* geo_ip; // only used by the thread pool while it is running, changes are protected by mutex
         QString geoip_data_file;
         QString download_destination;
         bt::DecompressThread* decompress_thread;
+        QCache<quint32, int> cache;
+        QSet<quint32> queued; // addresses which are being looked up
+        QVector<quint32> to_lookup;
+        bool database_pending; // the database is being downloaded, lookups wait for it
+        QTimer timer;
+        QThreadPool pool;
+        QMutex mutex;
+        QVector<Result> results; // protected by mutex, filled by the thread pool
         static QUrl geoip_url;
     };
 
@@ -43,13 +43,6 @@ namespace kt
         mmfile = tc ? IsMultimediaFile(tc->getStats().output_path) : 0;
         preview = false;
         percentage = 0;
-
-        if (root && tc)
-        {
-            BitSet d = tc->downloadedChunksBitSet();
-            d -= tc->onlySeedChunksBitSet();
-            root->initPercentage(tc, d);
-        }
     }
 
 
@@ -63,13 +56,7 @@ namespace kt
         mmfile = tc ? IsMultimediaFile(tc->getStats().output_path) : 0;
         preview = false;
         percentage = 0;
-
-        if (root && tc)
-        {
-            BitSet d = tc->downloadedChunksBitSet();
-            d -= tc->onlySeedChunksBitSet();
-            root->initPercentage(tc, d);
-        }
+        changed_files.clear();
     }
 
 
@@ -168,7 +155,7 @@ namespace kt
                 if (file->getPriority() == ONLY_SEED_PRIORITY || file->getPriority() == EXCLUDED)
                     return QVariant();
                 else
-                    return ki18n("%1 %").subs(n->percentage, 0, 'f', 2).toString();
+                    return ki18n("%1 %").subs(nodePercentage(n), 0, 'f', 2).toString();
             default: return QVariant();
             }
         }
@@ -194,7 +181,7 @@ namespace kt
         }
         else if (tc->getStats().multi_file_torrent && index.column() == 4)
         {
-            return ki18n("%1 %").subs(n->percentage, 0, 'f', 2).toString();
+            return ki18n("%1 %").subs(nodePercentage(n), 0, 'f', 2).toString();
         }
 
         return QVariant();
@@ -219,7 +206,7 @@ namespace kt
                 else
                     return 1;
             case 4:
-                return n->percentage;
+                return nodePercentage(n);
             }
         }
         else if (!tc->getStats().multi_file_torrent)
@@ -243,7 +230,7 @@ namespace kt
         }
         else if (tc->getStats().multi_file_torrent && index.column() == 4)
         {
-            return n->percentage;
+            return nodePercentage(n);
         }
 
         return QVariant();
@@ -266,13 +253,17 @@ namespace kt
     {
         if (!n->file)
         {
-            for (int i = 0; i < n->children.count(); i++)
+            // change all files below the directory, but don't reinclude excluded files
+            for (Uint32 i = n->first; i < n->last; i++)
             {
-                // recurse down the tree
-                setPriority(n->children.at(i), newpriority, false);
+                bt::TorrentFileInterface* file = files[i];
+                Priority old = file->getPriority();
+                if (old != EXCLUDED && old != ONLY_SEED_PRIORITY && old != newpriority)
+                    file->setPriority(newpriority);
             }
 
-            emit dataChanged(createIndex(n->row(), 0, n), createIndex(n->row(), 4, n));
+            resetPercentages(n);
+            subtreeChanged(n);
         }
         else
         {
@@ -286,6 +277,7 @@ namespace kt
             if (newpriority != old)
             {
                 file->setPriority(newpriority);
+                resetPercentages(n);
                 emit dataChanged(createIndex(n->row(), 0, n), createIndex(n->row(), 4, n));
             }
         }
@@ -294,62 +286,39 @@ namespace kt
     void IWFileTreeModel::filePercentageChanged(bt::TorrentFileInterface* file, float percentage)
     {
         Q_UNUSED(percentage);
+        // shown at the next update, the percentage of a file can change many times in between
         if (tc)
-            update(index(0, 0, QModelIndex()), file, 4);
+            changed_files.insert(file->getIndex());
     }
 
     void IWFileTreeModel::filePreviewChanged(bt::TorrentFileInterface* file, bool preview)
     {
         Q_UNUSED(preview);
         if (tc)
-            update(index(0, 0, QModelIndex()), file, 3);
+            update(file->getIndex(), 3);
     }
 
-    void IWFileTreeModel::update(const QModelIndex& idx, bt::TorrentFileInterface* file, int col)
+    void IWFileTreeModel::update(bt::Uint32 file_index, int col)
     {
-        if (!tc)
-            return;
-
-        Node* n = (Node*)idx.internalPointer();
-        if (n->file && n->file == file)
+        // the directories are updated when chunks are downloaded
+        Node* n = fileNode(file_index);
+        if (n)
         {
-            QModelIndex i = createIndex(idx.row(), col, n);
+            QModelIndex i = createIndex(n->row(), col, n);
             emit dataChanged(i, i);
-            if (col == 4)
-            {
-                // update percentages along the tree
-                // this will go back up the tree and update the percentage of
-                // all directories involved
-                BitSet d = tc->downloadedChunksBitSet();
-                d -= tc->onlySeedChunksBitSet();
-                n->updatePercentage(d);
-
-                // emit necessary signals
-                QModelIndex parent = idx.parent();
-                while (parent.isValid())
-                {
-                    Node* nd = (Node*)parent.internalPointer();
-                    i = createIndex(parent.row(), 4, nd);
-                    emit dataChanged(i, i);
-                    parent = parent.parent();
-                }
-            }
-        }
-        else
-        {
-            for (int i = 0; i < n->children.count(); i++)
-            {
-                // recurse down the tree
-                update(idx.child(i, 0), file, col);
-            }
         }
     }
 
     void IWFileTreeModel::update()
     {
+        TorrentFileTreeModel::update();
         if (!tc)
             return;
 
+        for (bt::Uint32 file_index : qAsConst(changed_files))
+            update(file_index, 4);
+        changed_files.clear();
+
         if (!tc->getStats().multi_file_torrent)
         {
             bool changed = false;
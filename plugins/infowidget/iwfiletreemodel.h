@@ -51,7 +51,7 @@ namespace kt
         void filePreviewChanged(bt::TorrentFileInterface* file, bool preview);
 
     private:
-        void update(const QModelIndex& index, bt::TorrentFileInterface* file, int col);
+        void update(bt::Uint32 file_index, int col);
         QVariant displayData(Node* n, const QModelIndex& index) const;
         QVariant sortData(Node* n, const QModelIndex& index) const;
         void setPriority(Node* n, bt::Priority newpriority, bool selected_node);
@@ -60,6 +60,7 @@ namespace kt
         bool preview;
         bool mmfile;
         double percentage;
+        QSet<bt::Uint32> changed_files; // files whose percentage changed since the last update
     };
 
 }
@@ -41,7 +41,7 @@ namespace kt
     static FlagDB flagDB(22, 18);
 
 
-    PeerViewModel::Item::Item(bt::PeerInterface* peer, GeoIPManager* geo_ip) : peer(peer)
+    PeerViewModel::Item::Item(bt::PeerInterface* peer) : peer(peer), row(0), ip(0)
     {
         stats = peer->getStats();
         if (!icons_loaded)
@@ -57,14 +57,16 @@ namespace kt
                 flagDB.addFlagSource(path + QStringLiteral("/%1/flag.png"));
         }
 
-        if (geo_ip)
+        if (!GeoIPManager::toIPv4Address(stats.ip_address, ip))
+            ip = 0;
+    }
+
+    void PeerViewModel::Item::setCountry(GeoIPManager* geo_ip, int country_id)
+    {
+        if (country_id > 0)
         {
-            int country_id = geo_ip->findCountry(stats.ip_address);
-            if (country_id > 0)
-            {
-                country = geo_ip->countryName(country_id);
-                flag = flagDB.getFlag(geo_ip->countryCode(country_id));
-            }
+            country = geo_ip->countryName(country_id);
+            flag = flagDB.getFlag(geo_ip->countryCode(country_id));
         }
     }
 
@@ -173,6 +175,7 @@ namespace kt
         : QAbstractTableModel(parent), geo_ip(0)
     {
         geo_ip = new GeoIPManager(this);
+        connect(geo_ip, SIGNAL(countryFound(quint32, int)), this, SLOT(countryFound(quint32, int)));
     }
 
 
@@ -183,49 +186,80 @@ namespace kt
 
     void PeerViewModel::peerAdded(bt::PeerInterface* peer)
     {
-        items.append(new Item(peer, geo_ip));
-        insertRow(items.count() - 1);
+        Item* item = new Item(peer);
+        item->row = items.count();
+        items.append(item);
+        item_map.insert(peer, item);
+
+        // Countries which are not in the cache are filled in when the lookup is done
+        int country_id = 0;
+        if (item->ip != 0)
+        {
+            if (geo_ip->cachedCountry(item->ip, country_id))
+            {
+                item->setCountry(geo_ip, country_id);
+            }
+            else
+            {
+                waiting_for_country.insert(item->ip, item);
+                geo_ip->findCountry(item->ip);
+            }
+        }
+
+        insertRow(item->row);
     }
 
-    void PeerViewModel::peerRemoved(bt::PeerInterface* peer)
+    void PeerViewModel::countryFound(quint32 ip, int country_id)
     {
-        for (QVector<Item*>::iterator i = items.begin(); i != items.end(); i++)
+        QList<Item*> found = waiting_for_country.values(ip);
+        waiting_for_country.remove(ip);
+        if (country_id <= 0)
+            return;
+
+        for (Item* item : qAsConst(found))
         {
-            if ((*i)->peer == peer)
-            {
-                removeRow(i - items.begin());
-                break;
-            }
+            item->setCountry(geo_ip, country_id);
+            emit dataChanged(index(item->row, 1), index(item->row, 1));
         }
     }
 
+    void PeerViewModel::peerRemoved(bt::PeerInterface* peer)
+    {
+        Item* item = item_map.value(peer);
+        if (item)
+            removeRow(item->row);
+    }
+
     void PeerViewModel::clear()
     {
         qDeleteAll(items);
         items.clear();
+        item_map.clear();
+        waiting_for_country.clear();
         reset();
     }
 
     void PeerViewModel::update()
     {
-        int idx = 0;
-        int lowest = -1;
-        int highest = -1;
-
-        foreach (Item* i, items)
+        // Only emit dataChanged for runs of peers which have changed, so the sort
+        // proxy doesn't have to look at every row between the first and last changed peer
+        int first = -1;
+        for (int i = 0; i < items.count(); i++)
         {
-            if (i->changed())
+            if (items[i]->changed())
+            {
+                if (first == -1)
+                    first = i;
+            }
+            else if (first != -1)
             {
-                if (lowest == -1)
-                    lowest = idx;
-                highest = idx;
+                emit dataChanged(index(first, 3), index(i - 1, 15));
+                first = -1;
             }
-            idx++;
         }
 
-        // emit only one data changed signal
-        if (lowest != -1)
-            emit dataChanged(index(lowest, 3), index(highest, 15));
+        if (first != -1)
+            emit dataChanged(index(first, 3), index(items.count() - 1, 15));
     }
 
     QModelIndex PeerViewModel::index(int row, int column, const QModelIndex& parent) const
@@ -327,8 +361,15 @@ namespace kt
     {
         beginRemoveRows(QModelIndex(), row, row + count - 1);
         for (int i = 0; i < count; i++)
-            delete items[row + i];
+        {
+            Item* item = items[row + i];
+            item_map.remove(item->peer);
+            waiting_for_country.remove(item->ip, item);
+            delete item;
+        }
         items.remove(row, count);
+        for (int i = row; i < items.count(); i++)
+            items[i]->row = i;
         endRemoveRows();
         return true;
     }
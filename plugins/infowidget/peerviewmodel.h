@@ -23,7 +23,9 @@
 #define KTPEERVIEWMODEL_H
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QIcon>
+#include <QMultiHash>
 #include <QVector>
 
 #include <interfaces/peerinterface.h>
@@ -69,6 +71,9 @@ namespace kt
 
         bt::PeerInterface* indexToPeer(const QModelIndex& idx);
 
+    private slots:
+        void countryFound(quint32 ip, int country_id);
+
     public:
         struct Item
         {
@@ -76,9 +81,12 @@ namespace kt
             mutable bt::PeerInterface::Stats stats;
             QString country;
             QIcon flag;
+            int row;
+            quint32 ip; // binary IPv4 address used for the GeoIP lookup, 0 if not an IPv4 address
 
-            Item(bt::PeerInterface* peer, GeoIPManager* geo_ip);
+            Item(bt::PeerInterface* peer);
 
+            void setCountry(GeoIPManager* geo_ip, int country_id);
             bool changed() const;
             QVariant data(int col) const;
             QVariant decoration(int col) const;
@@ -86,6 +94,8 @@ namespace kt
         };
     private:
         QVector<Item*> items;
+        QHash<bt::PeerInterface*, Item*> item_map;
+        QMultiHash<quint32, Item*> waiting_for_country;
         GeoIPManager* geo_ip;
     };
 
@@ -21,12 +21,12 @@
 
 #include <errno.h>
 #include <string.h>
+#include <algorithm>
 
 #include <QFile>
-#include <QRegExp>
-#include <QRegExpValidator>
-#include <QTimer>
-#include <QTextStream>
+#include <QHostAddress>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <KLocalizedString>
 #include <KIO/Job>
@@ -42,12 +42,235 @@ using namespace bt;
 
 namespace kt
 {
+    /// Number of input bytes a parse task handles before it reports progress
+    const int PROGRESS_STEP = 1024 * 1024;
 
-    ConvertThread::ConvertThread(ConvertDialog* dlg) : dlg(dlg), abort(false)
+    static inline bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static inline bool IsIPv6Char(char c)
+    {
+        return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') || c == ':' || c == '.';
+    }
+
+    static inline bool IsSpace(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    static bool ToIPv6(const QString& str, IPv6Key& key)
+    {
+        QHostAddress addr;
+        if (!addr.setAddress(str) || addr.protocol() != QAbstractSocket::IPv6Protocol)
+            return false;
+
+        key = IPv6Key(addr.toIPv6Address());
+        return true;
+    }
+
+    /**
+     * Parse a line with an IPv6 range, in the same name:start-end format as the IPv4 lines.
+     * The end address is everything after the last dash. The name separator is also a colon,
+     * and names can end in hex digits, so the start address is taken from the run of address
+     * characters before the dash: of the valid addresses which start at the beginning of that
+     * run or after one of its colons, the largest one not larger then the end address.
+     * @return false if the line does not contain an IPv6 range
+     */
+    static bool ParseLine6(const char* p, const char* end, IPv6Block& block)
+    {
+        const char* dash = end;
+        while (dash > p && *(dash - 1) != '-')
+            dash--;
+
+        if (dash == p)
+            return false;
+
+        const char* e = end;
+        while (e > dash && IsSpace(*(e - 1)))
+            e--;
+
+        const char* s = dash;
+        while (s < e && IsSpace(*s))
+            s++;
+
+        if (!ToIPv6(QString::fromLatin1(s, e - s), block.ip2))
+            return false;
+
+        // dash points past the '-'
+        e = dash - 1;
+        while (e > p && IsSpace(*(e - 1)))
+            e--;
+
+        s = e;
+        while (s > p && IsIPv6Char(*(s - 1)))
+            s--;
+
+        bool found = false;
+        for (; s < e; s++)
+        {
+            if (s > p && *(s - 1) != ':' && IsIPv6Char(*(s - 1)))
+                continue; // only try to start after a colon
+
+            IPv6Key start;
+            if (ToIPv6(QString::fromLatin1(s, e - s), start) && start <= block.ip2 && (!found || block.ip1 <= start))
+            {
+                block.ip1 = start;
+                found = true;
+            }
+        }
+
+        return found;
+    }
+
+    /**
+     * Try to match an IPv4 address at p, the same way the regular expression
+     * ([0-9]{1,3}\.){3}[0-9]{1,3} would. The octets are combined the way
+     * IPBlock(QString, QString) does it, so the results are identical.
+     * @return The end of the match, or 0 if there is none
+     */
+    static const char* MatchAddress(const char* p, const char* end, Uint32& ip)
+    {
+        Uint32 ret = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            int digits = 0;
+            Uint32 octet = 0;
+            while (p + digits < end && IsDigit(p[digits]) && digits < 4)
+            {
+                if (digits < 3)
+                    octet = octet * 10 + (p[digits] - '0');
+                digits++;
+            }
+
+            if (digits == 0)
+                return 0;
+
+            if (i < 3)
+            {
+                // 1 to 3 digits followed by a dot
+                if (digits > 3 || p + digits >= end || p[digits] != '.')
+                    return 0;
+                p += digits + 1;
+            }
+            else
+            {
+                // the last octet takes at most 3 digits
+                p += digits > 3 ? 3 : digits;
+            }
+
+            ret = i == 0 ? octet : ((ret << 8) | octet);
+        }
+
+        ip = ret;
+        return p;
+    }
+
+    /**
+     * Parse one line, a block is made out of lines which contain exactly two addresses.
+     * Lines without any IPv4 address are tried as an IPv6 range.
+     */
+    static void ParseLine(const char* p, const char* end, QVector<IPBlock>& out, QVector<IPv6Block>& out6)
+    {
+        const char* begin = p;
+        Uint32 ips[2];
+        int found = 0;
+        while (p < end)
+        {
+            Uint32 ip = 0;
+            const char* match = IsDigit(*p) ? MatchAddress(p, end, ip) : 0;
+            if (!match)
+            {
+                p++;
+                continue;
+            }
+
+            if (found == 2)
+                return; // more then two addresses
+
+            ips[found++] = ip;
+            p = match;
+        }
+
+        if (found == 2)
+        {
+            IPBlock block;
+            block.ip1 = ips[0];
+            block.ip2 = ips[1];
+            out.append(block);
+        }
+        else if (found == 0)
+        {
+            IPv6Block block;
+            if (!ParseLine6(begin, end, block))
+                return;
+
+            // IPv4 mapped addresses are looked up in the IPv4 ranges
+            const bt::Uint64 mapped = Q_UINT64_C(0xFFFF00000000);
+            if (block.ip1.hi == 0 && block.ip2.hi == 0 && (block.ip1.lo >> 32) == 0xFFFF && (block.ip2.lo >> 32) == 0xFFFF)
+            {
+                IPBlock b;
+                b.ip1 = block.ip1.lo - mapped;
+                b.ip2 = block.ip2.lo - mapped;
+                out.append(b);
+            }
+            else
+                out6.append(block);
+        }
+    }
+
+    /**
+     * Parses a piece of the mmapped text file on the thread pool.
+     */
+    class ConvertThread::ParseTask : public QRunnable
+    {
+    public:
+        ParseTask(ConvertThread* ct, const char* begin, const char* end, QVector<IPBlock>& out, QVector<IPv6Block>& out6)
+            : ct(ct), begin(begin), end(end), out(out), out6(out6)
+        {
+            setAutoDelete(true);
+        }
+
+        virtual void run()
+        {
+            const char* p = begin;
+            const char* reported = begin;
+            while (p < end && !ct->abort)
+            {
+                const char* eol = p;
+                while (eol < end && *eol != '\n' && *eol != '\r')
+                    eol++;
+
+                ParseLine(p, eol, out, out6);
+                p = eol + 1;
+
+                if (p - reported >= PROGRESS_STEP)
+                {
+                    ct->bytesParsed(p - reported);
+                    reported = p;
+                }
+            }
+
+            if (p > reported)
+                ct->bytesParsed(qMin(p, end) - reported);
+        }
+
+    private:
+        ConvertThread* ct;
+        const char* begin;
+        const char* end;
+        QVector<IPBlock>& out;
+        QVector<IPv6Block>& out6;
+    };
+
+    ConvertThread::ConvertThread(ConvertDialog* dlg) : dlg(dlg), abort(false), source_size(0)
     {
         txt_file = kt::DataDir() + QStringLiteral("level1.txt");
         dat_file = kt::DataDir() + QStringLiteral("level1.dat");
         tmp_file = kt::DataDir() + QStringLiteral("level1.dat.tmp");
+        dat6_file = kt::DataDir() + QStringLiteral("level1v6.dat");
+        tmp6_file = kt::DataDir() + QStringLiteral("level1v6.dat.tmp");
     }
 
     ConvertThread::~ConvertThread()
@@ -60,6 +283,13 @@ namespace kt
         writeOutput();
     }
 
+    void ConvertThread::bytesParsed(qint64 bytes)
+    {
+        qint64 done = parsed.fetchAndAddOrdered(bytes) + bytes;
+        // the dialog takes ints, so report in kilobytes
+        dlg->progress(done / 1024, source_size / 1024);
+    }
+
     void ConvertThread::readInput()
     {
         /*    READ INPUT FILE  */
@@ -74,119 +304,191 @@ namespace kt
         Out(SYS_IPF | LOG_NOTICE) << "Loading " << txt_file << " ..." << endl;
         dlg->message(i18n("Loading txt file..."));
 
-        ulong source_size = source.size();
-        QTextStream stream(&source);
-
-        int i = 0;
-        QRegExp rx(QLatin1String("([0-9]{1,3}\\.){3}[0-9]{1,3}"));
+        source_size = source.size();
+        if (source_size == 0)
+            return;
 
-        while (!stream.atEnd() && !abort)
+        const char* data = (const char*)source.map(0, source_size);
+        if (!data)
         {
-            QString line = stream.readLine();
-            i += line.length() * sizeof(char);   //rough estimation of string size
-            dlg->progress(i, source_size);
-            ++i;
+            Out(SYS_IPF | LOG_IMPORTANT) << "Cannot map " << txt_file << endl;
+            failure_reason = i18n("Cannot open %1: %2", txt_file, source.errorString());
+            return;
+        }
 
-            QStringList addresses;
-            int pos = 0;
-            while ((pos = rx.indexIn(line, pos)) != -1)
-            {
-                addresses << rx.cap(0);
-                pos += rx.matchedLength();
-            }
+        // Split the file in pieces on line boundaries, and parse them in parallel
+        QThreadPool pool;
+        int num_pieces = qMax(QThread::idealThreadCount(), 1) * 4;
+        QVector<QVector<IPBlock> > results(num_pieces);
+        QVector<QVector<IPv6Block> > results6(num_pieces);
+        const char* end = data + source_size;
+        const char* p = data;
+        for (int i = 0; i < num_pieces && p < end; i++)
+        {
+            const char* piece_end = i == num_pieces - 1 ? end : qMin(end, data + source_size * (i + 1) / num_pieces);
+            while (piece_end < end && *piece_end != '\n' && *piece_end != '\r')
+                piece_end++;
 
-            // if we have found two addresses, create a block out of it
-            if (addresses.count() == 2)
-            {
-                input += IPBlock(addresses[0], addresses[1]);
-            }
+            if (piece_end > p)
+                pool.start(new ParseTask(this, p, piece_end, results[i], results6[i]));
+            p = piece_end;
         }
+        pool.waitForDone();
+        source.unmap((uchar*)data);
         source.close();
+
+        int total = 0;
+        for (const QVector<IPBlock>& r : qAsConst(results))
+            total += r.size();
+
+        input.reserve(total);
+        for (const QVector<IPBlock>& r : qAsConst(results))
+            input += r;
+
+        for (const QVector<IPv6Block>& r : qAsConst(results6))
+            input6 += r;
+
         Out(SYS_IPF | LOG_NOTICE) << "Loaded " << input.count() << " lines"  << endl;
+        Out(SYS_IPF | LOG_NOTICE) << "Loaded " << input6.count() << " IPv6 lines"  << endl;
         dlg->progress(100, 100);
     }
 
-    static bool LessThan(const IPBlock& a, const IPBlock& b)
+    void ConvertThread::sort()
     {
-        if (a.ip2 < b.ip1) // a range is before b range
-            return true;
-        else if (b.ip2 < a.ip1) // b range is before a range
-            return false;
-        else
-            return a.ip1 < b.ip1;// a and b intersect
+        // LSD radix sort on the start address, in two passes of 16 bits
+        QVector<IPBlock> tmp(input.size());
+        QVector<int> counts(0x10000);
+        for (int shift = 0; shift < 32; shift += 16)
+        {
+            counts.fill(0);
+            for (const IPBlock& b : qAsConst(input))
+                counts[(b.ip1 >> shift) & 0xFFFF]++;
+
+            int pos = 0;
+            for (int& c : counts)
+            {
+                int n = c;
+                c = pos;
+                pos += n;
+            }
+
+            for (const IPBlock& b : qAsConst(input))
+                tmp[counts[(b.ip1 >> shift) & 0xFFFF]++] = b;
+
+            input.swap(tmp);
+        }
     }
 
-    void ConvertThread::sort()
+    void ConvertThread::merge()
     {
-        qSort(input.begin(), input.end(), LessThan);
+        // Ranges are sorted on their start, so one pass merges all overlapping ranges
+        int out = -1;
+        for (int i = 0; i < input.size(); i++)
+        {
+            const IPBlock& b = input[i];
+            if (b.ip1 > b.ip2)
+                continue; // reversed range, blocks nothing
+
+            if (out >= 0 && b.ip1 <= input[out].ip2)
+            {
+                IPBlock& a = input[out];
+                if (b.ip2 > a.ip2)
+                    a.ip2 = b.ip2;
+            }
+            else
+                input[++out] = b;
+        }
+        input.resize(out + 1);
     }
 
-    void ConvertThread::merge()
+    static bool StartLessThan6(const IPv6Block& a, const IPv6Block& b)
     {
-        if (input.count() < 2) // noting to merge
-            return;
+        return !(b.ip1 <= a.ip1);
+    }
 
-        QList<IPBlock>::iterator i = input.begin();
-        QList<IPBlock>::iterator j = i;
-        j++;
-        while (j != input.end() && i != input.end())
+    void ConvertThread::sortAndMerge6()
+    {
+        // there are few IPv6 ranges, so a comparison sort is good enough
+        std::sort(input6.begin(), input6.end(), StartLessThan6);
+        int out = -1;
+        for (int i = 0; i < input6.size(); i++)
         {
-            IPBlock& a = *i;
-            IPBlock& b = *j;
-            if (a.ip2 < b.ip1 || b.ip2 < a.ip1)
+            const IPv6Block& b = input6[i];
+            if (out >= 0 && b.ip1 <= input6[out].ip2)
             {
-                // separate ranges, so go to the next pair
-                i = j;
-                j++;
+                IPv6Block& a = input6[out];
+                if (a.ip2 <= b.ip2)
+                    a.ip2 = b.ip2;
             }
             else
-            {
+                input6[++out] = b;
+        }
+        input6.resize(out + 1);
+    }
 
-                // merge b into a
-                a.ip1 = (a.ip1 < b.ip1) ? a.ip1 : b.ip1;
-                a.ip2 = (a.ip2 > b.ip2) ? a.ip2 : b.ip2;
+    bool ConvertThread::writeFile(const QString& file, const QString& tmp, const char* data, qint64 size)
+    {
+        // Write to a temporary file first, the old file might still be mapped
+        QFile target(tmp);
+        if (!target.open(QIODevice::WriteOnly))
+        {
+            Out(SYS_IPF | LOG_IMPORTANT) << "Unable to open file for writing" << endl;
+            failure_reason = i18n("Cannot open %1: %2", tmp, QString::fromLatin1(strerror(errno)));
+            return false;
+        }
 
-                // remove b
-                j = input.erase(j);
-            }
+        if (target.write(data, size) != size)
+        {
+            failure_reason = i18n("Cannot write %1: %2", tmp, target.errorString());
+            target.close();
+            bt::Delete(tmp, true);
+            return false;
+        }
+        target.close();
+
+        if (abort)
+        {
+            bt::Delete(tmp, true);
+            return false;
         }
+
+        bt::Delete(file, true);
+        if (!QFile::rename(tmp, file))
+        {
+            failure_reason = i18n("Cannot open %1: %2", file, QString::fromLatin1(strerror(errno)));
+            return false;
+        }
+
+        return true;
     }
 
     void ConvertThread::writeOutput()
     {
-        if (input.count() == 0)
+        if (!failure_reason.isEmpty() || abort)
+            return;
+
+        if (input.count() == 0 && input6.count() == 0)
         {
             failure_reason = i18n("There are no IP addresses to convert in %1", txt_file);
             return;
         }
 
+        Out(SYS_IPF | LOG_NOTICE) << "Loading finished, starting conversion..." << endl;
+        dlg->message(i18n("Converting..."));
+
         sort(); // sort the block
         merge(); // merge neigbhouring blocks
+        sortAndMerge6();
 
-        QFile target(dat_file);
-        if (!target.open(QIODevice::WriteOnly))
-        {
-            Out(SYS_IPF | LOG_IMPORTANT) << "Unable to open file for writing" << endl;
-            failure_reason = i18n("Cannot open %1: %2", dat_file, QString::fromLatin1(strerror(errno)));
+        if (!writeFile(dat_file, tmp_file, (const char*)input.constData(), (qint64)input.count() * sizeof(IPBlock)))
             return;
-        }
-
 
+        // the IPv6 ranges go in a separate file, remove a stale one if there are none
+        if (input6.isEmpty())
+            bt::Delete(dat6_file, true);
+        else if (!writeFile(dat6_file, tmp6_file, (const char*)input6.constData(), (qint64)input6.count() * sizeof(IPv6Block)))
+            return;
 
-        Out(SYS_IPF | LOG_NOTICE) << "Loading finished, starting conversion..." << endl;
-        dlg->message(i18n("Converting..."));
-
-        int i = 0;
-        int tot = input.count();
-        foreach (const IPBlock& block, input)
-        {
-            dlg->progress(i, tot);
-            target.write((char*) & block, sizeof(IPBlock));
-            if (abort)
-            {
-                return;
-            }
-            i++;
-        }
+        dlg->progress(100, 100);
     }
 }
@@ -22,7 +22,9 @@
 #ifndef KTCONVERTTHREAD_H
 #define KTCONVERTTHREAD_H
 
+#include <QAtomicInteger>
 #include <QThread>
+#include <QVector>
 #include "ipblocklist.h"
 
 
@@ -32,10 +34,14 @@ namespace kt
 
     /**
      * Thread which does the converting of the text filter file to our own format.
+     * The text file is mmapped and parsed in pieces on a thread pool, the blocks are radix sorted
+     * and merged in a single pass, and written out in one go. Lines with an IPv6 range
+     * are written to a separate file, level1v6.dat.
      * @author Joris Guisson
     */
     class ConvertThread : public QThread
     {
+        class ParseTask;
     public:
         ConvertThread(ConvertDialog* dlg);
         virtual ~ConvertThread();
@@ -48,10 +54,13 @@ namespace kt
 
     private:
         void readInput();
+        void bytesParsed(qint64 bytes);
         void writeOutput();
         void cleanUp(bool failed);
         void sort();
         void merge();
+        void sortAndMerge6();
+        bool writeFile(const QString& file, const QString& tmp, const char* data, qint64 size);
 
     private:
         ConvertDialog* dlg;
@@ -59,8 +68,13 @@ namespace kt
         QString txt_file;
         QString dat_file;
         QString tmp_file;
-        QList<IPBlock> input;
+        QString dat6_file;
+        QString tmp6_file;
+        QVector<IPBlock> input;
+        QVector<IPv6Block> input6;
         QString failure_reason;
+        qint64 source_size;
+        QAtomicInteger<qint64> parsed;
     };
 
 }
@@ -334,6 +334,7 @@ namespace kt
         cleanUp(kt::DataDir() + QStringLiteral("level1.txt"));
         cleanUp(kt::DataDir() + QStringLiteral("level1.tmp"));
         cleanUp(kt::DataDir() + QStringLiteral("level1.dat.tmp"));
+        cleanUp(kt::DataDir() + QStringLiteral("level1v6.dat.tmp"));
     }
 
     void DownloadAndConvertJob::cleanUp(const QString& path)
@@ -21,6 +21,8 @@
 
 #include "ipblocklist.h"
 #include <QFile>
+#include <QFileInfo>
+#include <algorithm>
 #include <util/log.h>
 #include <util/constants.h>
 #include <net/address.h>
@@ -44,6 +46,58 @@ namespace kt
         return ret;
     }
 
+    static inline int FindFirstSet(Uint32 x)
+    {
+#ifdef __GNUC__
+        return __builtin_ffs(x);
+#else
+        if (x == 0)
+            return 0;
+
+        int r = 1;
+        while (!(x & 1))
+        {
+            x >>= 1;
+            r++;
+        }
+        return r;
+#endif
+    }
+
+    static bool StartLessThan(const IPBlock& a, const IPBlock& b)
+    {
+        return a.ip1 < b.ip1;
+    }
+
+    static bool StartLessThan6(const IPv6Block& a, const IPv6Block& b)
+    {
+        return !(b.ip1 <= a.ip1);
+    }
+
+    /// Sort ranges on their start address and merge the overlapping ones, in one pass
+    template<class Block>
+    static void SortAndMerge(QVector<Block>& list, bool (*less_than)(const Block&, const Block&))
+    {
+        if (list.isEmpty())
+            return;
+
+        std::sort(list.begin(), list.end(), less_than);
+        int out = 0;
+        for (int i = 1; i < list.size(); i++)
+        {
+            Block& a = list[out];
+            const Block& b = list[i];
+            if (b.ip1 <= a.ip2)
+            {
+                if (a.ip2 <= b.ip2)
+                    a.ip2 = b.ip2;
+            }
+            else
+                list[++out] = b;
+        }
+        list.resize(out + 1);
+    }
+
     IPBlock::IPBlock() : ip1(0), ip2(0)
     {}
 
@@ -56,7 +110,20 @@ namespace kt
         ip2 = StringToUint32(end);
     }
 
-    IPBlockList::IPBlockList()
+    IPv6Key::IPv6Key(const Q_IPV6ADDR& addr) : hi(0), lo(0)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            hi = (hi << 8) | addr[i];
+            lo = (lo << 8) | addr[i + 8];
+        }
+    }
+
+    IPv6Block::IPv6Block(const QString& start, const QString& end)
+        : ip1(QHostAddress(start).toIPv6Address()), ip2(QHostAddress(end).toIPv6Address())
+    {}
+
+    IPBlockList::IPBlockList() : ranges(0), num_ranges(0)
     {
     }
 
@@ -66,59 +133,178 @@ namespace kt
 
     bool IPBlockList::blocked(const net::Address& addr) const
     {
-        if (addr.protocol() == QAbstractSocket::IPv6Protocol || blocks.empty())
+        // also true for IPv4 mapped IPv6 addresses
+        bool ipv4 = false;
+        quint32 ip = addr.toIPv4Address(&ipv4);
+        if (ipv4)
+            return isBlockedIP(ip);
+        else if (addr.protocol() == QAbstractSocket::IPv6Protocol)
+            return isBlockedIP(IPv6Key(addr.toIPv6Address()));
+        else
+            return false;
+    }
+
+    bool IPBlockList::isBlockedIP(Uint32 ip) const
+    {
+        if (num_ranges == 0)
+            return false;
+
+        // Find the first start address larger then ip in the Eytzinger layout,
+        // the next node is picked with a comparison instead of a branch.
+        const Uint32* tree = eytzinger.constData();
+        Uint32 k = 1;
+        while (k <= num_ranges)
+        {
+#ifdef __GNUC__
+            __builtin_prefetch(tree + k * 16);
+#endif
+            k = 2 * k + (tree[k] <= ip);
+        }
+        // strip the trailing right turns
+        k >>= FindFirstSet(~k);
+
+        // The range before that is the only one which can contain ip
+        Uint32 upper = k ? rank[k] : num_ranges;
+        return upper > 0 && ip <= ranges[upper - 1].ip2;
+    }
+
+    bool IPBlockList::isBlockedIP(const IPv6Key& ip) const
+    {
+        if (blocks6.isEmpty())
             return false;
 
-        // Binary search the list of blocks which are sorted
-        quint32 ip = addr.toIPv4Address();
-        int begin = 0;
-        int end = blocks.size() - 1;
-        while (true)
+        // Branchless binary search for the last range starting at or before ip
+        const IPv6Block* base = blocks6.constData();
+        int n = blocks6.size();
+        while (n > 1)
         {
-            if (begin == end)
-                return blocks[begin].constains(ip);
-            else if (begin == end - 1)
-                return blocks[begin].constains(ip) || blocks[end].constains(ip);
-
-            int pivot = begin + (end - begin) / 2;
-            if (blocks[pivot].constains(ip))
-                return true;
-            else if (ip < blocks[pivot].ip1)
-                end = pivot - 1; // continue in the range [begin, pivot - 1]
-            else // ip > blocks[pivot].ip2
-                begin = pivot + 1; // continue in the range [pivot + 1, end]
+            int half = n / 2;
+            base = base[half].ip1 <= ip ? base + half : base;
+            n -= half;
         }
-        return false;
+        return base->contains(ip);
     }
 
     bool IPBlockList::load(const QString& path)
     {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly))
+        QFileInfo info(path);
+        if (info.exists() && info.size() == 0)
         {
-            Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << path << ": " << file.errorString() << endl;
+            // A list with only IPv6 ranges, nothing to map
+            Out(SYS_IPF | LOG_NOTICE) << "Loaded 0 blocked IP ranges" << endl;
+            return true;
+        }
+
+        if (!file.open(path, QIODevice::ReadOnly))
+        {
+            Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << path << endl;
             return false;
         }
 
-        // Note: the conversion process has sorted the blocks !
-        int num_blocks = file.size() / sizeof(IPBlock);
-        blocks.reserve(num_blocks);
-        while (!file.atEnd() && blocks.size() < num_blocks)
+        // Note: the conversion process has sorted and merged the blocks !
+        const IPBlock* data = (const IPBlock*)file.getData(0);
+        Uint32 num = file.getSize() / sizeof(IPBlock);
+        bool ok = data != 0;
+        for (Uint32 i = 0; ok && i < num; i++)
+            ok = data[i].ip1 <= data[i].ip2 && (i == 0 || data[i - 1].ip2 < data[i].ip1);
+
+        if (ok)
         {
-            IPBlock block;
-            if (file.read((char*)&block, sizeof(IPBlock)) == sizeof(IPBlock))
-                addBlock(block);
-            else
-                break;
+            blocks.clear();
+            ranges = data;
+            num_ranges = num;
+            buildIndex();
+        }
+        else
+        {
+            // Old or hand made file, sort it ourselves
+            Out(SYS_IPF | LOG_NOTICE) << path << " is not sorted, sorting it" << endl;
+            QVector<IPBlock> list;
+            if (data)
+            {
+                list.resize(num);
+                std::copy(data, data + num, list.begin());
+            }
+            file.close();
+            ranges = 0;
+            num_ranges = 0;
+            addBlocks(list);
         }
 
-        Out(SYS_IPF | LOG_NOTICE) << "Loaded " << blocks.size() << " blocked IP ranges" << endl;
+        Out(SYS_IPF | LOG_NOTICE) << "Loaded " << num_ranges << " blocked IP ranges" << endl;
+        return true;
+    }
+
+    bool IPBlockList::loadIPv6(const QString& path)
+    {
+        QFile fptr(path);
+        if (!fptr.open(QIODevice::ReadOnly))
+        {
+            Out(SYS_IPF | LOG_NOTICE) << "Cannot open " << path << ": " << fptr.errorString() << endl;
+            return false;
+        }
+
+        QVector<IPv6Block> list(fptr.size() / sizeof(IPv6Block));
+        qint64 size = list.size() * sizeof(IPv6Block);
+        if (fptr.read((char*)list.data(), size) != size)
+        {
+            Out(SYS_IPF | LOG_NOTICE) << "Failed to read " << path << ": " << fptr.errorString() << endl;
+            return false;
+        }
+
+        blocks6 += list;
+        SortAndMerge(blocks6, StartLessThan6);
+        Out(SYS_IPF | LOG_NOTICE) << "Loaded " << blocks6.size() << " blocked IPv6 ranges" << endl;
         return true;
     }
 
     void IPBlockList::addBlock(const IPBlock& block)
     {
-        blocks.append(block);
+        addBlocks(QVector<IPBlock>() << block);
+    }
+
+    void IPBlockList::addBlocks(const QVector<IPBlock>& list)
+    {
+        if (num_ranges > 0 && ranges != blocks.constData())
+        {
+            // ranges come from the file, take a copy so we can add to it
+            blocks.resize(num_ranges);
+            if (num_ranges > 0)
+                std::copy(ranges, ranges + num_ranges, blocks.begin());
+            file.close();
+        }
+
+        blocks += list;
+        SortAndMerge(blocks, StartLessThan);
+        ranges = blocks.constData();
+        num_ranges = blocks.size();
+        buildIndex();
+    }
+
+    void IPBlockList::addBlock(const IPv6Block& block)
+    {
+        blocks6.append(block);
+        SortAndMerge(blocks6, StartLessThan6);
+    }
+
+    void IPBlockList::buildIndex()
+    {
+        eytzinger.resize(num_ranges + 1);
+        rank.resize(num_ranges + 1);
+        buildIndex(0, 1);
+    }
+
+    Uint32 IPBlockList::buildIndex(Uint32 i, Uint32 k)
+    {
+        // in order walk of the implicit tree, fills it with the sorted start addresses
+        if (k <= num_ranges)
+        {
+            i = buildIndex(i, 2 * k);
+            eytzinger[k] = ranges[i].ip1;
+            rank[k] = i;
+            i = buildIndex(i + 1, 2 * k + 1);
+        }
+        return i;
     }
 
 }
@@ -22,9 +22,11 @@
 #ifndef ANTIP2P_H
 #define ANTIP2P_H
 
+#include <QHostAddress>
 #include <QVector>
 
 #include <util/constants.h>
+#include <util/mmapfile.h>
 #include <interfaces/blocklistinterface.h>
 
 namespace kt
@@ -39,7 +41,36 @@ namespace kt
         IPBlock(const IPBlock& block);
         IPBlock(const QString& start, const QString& end);
 
-        bool constains(bt::Uint32 ip) const
+        bool contains(bt::Uint32 ip) const
+        {
+            return ip1 <= ip && ip <= ip2;
+        }
+    };
+
+    /// 128 bit IPv6 address in host byte order, so it can be compared as two integers
+    struct IPv6Key
+    {
+        bt::Uint64 hi;
+        bt::Uint64 lo;
+
+        IPv6Key() : hi(0), lo(0) {}
+        IPv6Key(const Q_IPV6ADDR& addr);
+
+        bool operator <= (const IPv6Key& other) const
+        {
+            return hi < other.hi || (hi == other.hi && lo <= other.lo);
+        }
+    };
+
+    struct IPv6Block
+    {
+        IPv6Key ip1;
+        IPv6Key ip2;
+
+        IPv6Block() {}
+        IPv6Block(const QString& start, const QString& end);
+
+        bool contains(const IPv6Key& ip) const
         {
             return ip1 <= ip && ip <= ip2;
         }
@@ -48,6 +79,11 @@ namespace kt
     /**
      * @author Ivan Vasic <ivasic@gmail.com>
      * @brief This class is used to manage anti-p2p filter list, so called level1.
+     *
+     * The IPv4 ranges are used straight from the mmapped level1.dat file (sorted and merged by the converter).
+     * On top of that an Eytzinger (breadth first) ordered copy of the start addresses is kept,
+     * which is searched without branches and with good cache behavior.
+     * IPv6 ranges are kept in a separate sorted list, IPv4 mapped IPv6 addresses are checked against the IPv4 ranges.
      */
     class IPBlockList : public bt::BlockListInterface
     {
@@ -60,7 +96,12 @@ namespace kt
         /**
          * Overloaded function. Uses Uint32 IP to be checked
          **/
-        bool isBlockedIP(bt::Uint32 ip);
+        bool isBlockedIP(bt::Uint32 ip) const;
+
+        /**
+         * Overloaded function, for IPv6 addresses.
+         **/
+        bool isBlockedIP(const IPv6Key& ip) const;
 
         /**
          * Loads filter file
@@ -69,14 +110,46 @@ namespace kt
          */
         bool load(const QString& path);
 
+        /**
+         * Loads a file with IPv6 ranges (IPv6Block structs, sorted and merged)
+         * @param path The file to load
+         * @return true upon success, false otherwise
+         */
+        bool loadIPv6(const QString& path);
+
         /**
          * Add a single block
          * @param block
          */
         void addBlock(const IPBlock& block);
 
+        /**
+         * Add a list of blocks, in any order, the index is only rebuilt once.
+         * @param list The blocks
+         */
+        void addBlocks(const QVector<IPBlock>& list);
+
+        /**
+         * Add a single IPv6 block
+         * @param block
+         */
+        void addBlock(const IPv6Block& block);
+
+        /// Get the number of IPv4 ranges
+        bt::Uint32 count() const {return num_ranges;}
+
+    private:
+        void buildIndex();
+        bt::Uint32 buildIndex(bt::Uint32 i, bt::Uint32 k);
+
     private:
-        QVector<IPBlock> blocks;
+        bt::MMapFile file;
+        QVector<IPBlock> blocks; // only used when the ranges do not come from the file
+        const IPBlock* ranges;
+        bt::Uint32 num_ranges;
+        QVector<bt::Uint32> eytzinger; // start addresses in Eytzinger order, starting at index 1
+        QVector<bt::Uint32> rank; // index in ranges of each element of eytzinger
+        QVector<IPv6Block> blocks6;
     };
 }
 #endif
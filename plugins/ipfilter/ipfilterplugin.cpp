@@ -31,6 +31,7 @@
 #include <interfaces/guiinterface.h>
 #include <interfaces/functions.h>
 #include <util/constants.h>
+#include <util/fileops.h>
 #include <util/log.h>
 #include <util/logsystemmanager.h>
 #include <peer/accessmanager.h>
@@ -95,6 +96,11 @@ namespace kt
             ip_filter.reset();
             return false;
         }
+
+        QString ipv6_file = kt::DataDir() + QStringLiteral("level1v6.dat");
+        if (bt::Exists(ipv6_file))
+            ip_filter->loadIPv6(ipv6_file);
+
         AccessManager::instance().addBlockList(ip_filter.data());
         return true;
     }
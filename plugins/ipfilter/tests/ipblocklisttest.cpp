@@ -19,14 +19,103 @@
  ***************************************************************************/
 
 #include <QtTest>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <random>
 #include <util/log.h>
 #include <net/address.h>
 #include "../ipblocklist.h"
 
+namespace
+{
+    const int NUM_RANGES = 300000;
+    const int NUM_LOOKUPS = 2000;
+    const int NUM_BENCHMARK_LOOKUPS = 100000;
+
+    /// Random number in [0, max)
+    int bounded(std::mt19937& rnd, int max)
+    {
+        return std::uniform_int_distribution<int>(0, max - 1)(rnd);
+    }
+
+    bt::Uint64 generate64(std::mt19937& rnd)
+    {
+        bt::Uint64 hi = rnd();
+        return (hi << 32) | rnd();
+    }
+}
+
 class IPBlockListTest : public QObject
 {
     Q_OBJECT
 private:
+    // Random sorted, non overlapping ranges, like the converter produces
+    QVector<kt::IPBlock> randomRanges(std::mt19937& rnd, int num)
+    {
+        QVector<bt::Uint32> points(num * 2);
+        for (int i = 0; i < points.size(); i++)
+            points[i] = rnd();
+
+        std::sort(points.begin(), points.end());
+        points.erase(std::unique(points.begin(), points.end()), points.end());
+
+        QVector<kt::IPBlock> ranges;
+        for (int i = 0; i + 1 < points.size(); i += 2)
+        {
+            kt::IPBlock b;
+            b.ip1 = points[i];
+            b.ip2 = points[i + 1];
+            ranges.append(b);
+        }
+        return ranges;
+    }
+
+    // Random addresses, plus the addresses on and just outside the edges of some ranges
+    QVector<bt::Uint32> randomAddresses(std::mt19937& rnd, const QVector<kt::IPBlock>& ranges, int num)
+    {
+        QVector<bt::Uint32> ips(num);
+        for (int i = 0; i < num; i++)
+            ips[i] = rnd();
+
+        for (int i = 0; i < num / 4 && !ranges.isEmpty(); i++)
+        {
+            const kt::IPBlock& b = ranges[bounded(rnd, ranges.size())];
+            ips << b.ip1 << b.ip2 << b.ip1 - 1 << b.ip2 + 1;
+        }
+        return ips;
+    }
+
+    static bool linearBlocked(const QVector<kt::IPBlock>& ranges, bt::Uint32 ip)
+    {
+        for (const kt::IPBlock& b : ranges)
+        {
+            if (b.contains(ip))
+                return true;
+        }
+        return false;
+    }
+
+    static bool startLessThan(const kt::IPBlock& a, bt::Uint32 ip)
+    {
+        return a.ip2 < ip;
+    }
+
+    // Plain binary search over the sorted ranges, the way it used to be done
+    static bool binarySearchBlocked(const QVector<kt::IPBlock>& ranges, bt::Uint32 ip)
+    {
+        QVector<kt::IPBlock>::const_iterator i = std::lower_bound(ranges.begin(), ranges.end(), ip, startLessThan);
+        return i != ranges.end() && i->contains(ip);
+    }
+
+    static bool linearBlocked(const QVector<kt::IPv6Block>& ranges, const kt::IPv6Key& ip)
+    {
+        for (const kt::IPv6Block& b : ranges)
+        {
+            if (b.contains(ip))
+                return true;
+        }
+        return false;
+    }
 
 private slots:
     void initTestCase()
@@ -56,9 +145,185 @@ private slots:
         QVERIFY(bl.blocked(net::Address(QStringLiteral("135.25.25.25"), 0)));
         QVERIFY(!bl.blocked(net::Address(QStringLiteral("138.255.255.255"), 0)));
         QVERIFY(bl.blocked(net::Address(QStringLiteral("197.25.25.25"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("0.0.0.1"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("255.255.255.255"), 0)));
+    }
+
+    void testMergeUnsorted()
+    {
+        kt::IPBlockList bl;
+        bl.addBlock(kt::IPBlock(QStringLiteral("10.0.0.0"), QStringLiteral("10.0.0.255")));
+        bl.addBlock(kt::IPBlock(QStringLiteral("5.0.0.0"), QStringLiteral("5.255.255.255")));
+        bl.addBlock(kt::IPBlock(QStringLiteral("10.0.0.128"), QStringLiteral("10.0.1.255")));
+        QCOMPARE(bl.count(), (bt::Uint32)2);
+
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("5.1.2.3"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("10.0.1.10"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("10.0.2.0"), 0)));
+    }
+
+    void testIPv6()
+    {
+        kt::IPBlockList bl;
+        bl.addBlock(kt::IPBlock(QStringLiteral("127.0.0.0"), QStringLiteral("127.255.255.255")));
+        bl.addBlock(kt::IPv6Block(QStringLiteral("2001:db8::"), QStringLiteral("2001:db8::ffff")));
+        bl.addBlock(kt::IPv6Block(QStringLiteral("fe80::"), QStringLiteral("febf:ffff:ffff:ffff:ffff:ffff:ffff:ffff")));
+
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("2001:db8::1234"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("2001:db8::1:0"), 0)));
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("fe80::1"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("::1"), 0)));
+        // IPv4 mapped addresses use the IPv4 ranges
+        QVERIFY(bl.blocked(net::Address(QStringLiteral("::ffff:127.0.0.1"), 0)));
+        QVERIFY(!bl.blocked(net::Address(QStringLiteral("::ffff:128.0.0.1"), 0)));
+    }
+
+    void testLoad()
+    {
+        std::mt19937 rnd(7);
+        QVector<kt::IPBlock> ranges = randomRanges(rnd, 1000);
+
+        QTemporaryFile tmp;
+        QVERIFY(tmp.open());
+        tmp.write((const char*)ranges.constData(), ranges.size() * sizeof(kt::IPBlock));
+        tmp.close();
+
+        kt::IPBlockList bl;
+        QVERIFY(bl.load(tmp.fileName()));
+        QCOMPARE(bl.count(), (bt::Uint32)ranges.size());
+
+        const QVector<bt::Uint32> ips = randomAddresses(rnd, ranges, 10000);
+        for (bt::Uint32 ip : ips)
+            QCOMPARE(bl.isBlockedIP(ip), linearBlocked(ranges, ip));
+    }
+
+    void testLoadUnsorted()
+    {
+        std::mt19937 rnd(11);
+        QVector<kt::IPBlock> ranges = randomRanges(rnd, 1000);
+        std::reverse(ranges.begin(), ranges.end());
+
+        QTemporaryFile tmp;
+        QVERIFY(tmp.open());
+        tmp.write((const char*)ranges.constData(), ranges.size() * sizeof(kt::IPBlock));
+        tmp.close();
+
+        kt::IPBlockList bl;
+        QVERIFY(bl.load(tmp.fileName()));
+        QCOMPARE(bl.count(), (bt::Uint32)ranges.size());
+
+        const QVector<bt::Uint32> ips = randomAddresses(rnd, ranges, 10000);
+        for (bt::Uint32 ip : ips)
+            QCOMPARE(bl.isBlockedIP(ip), linearBlocked(ranges, ip));
+    }
+
+    void testLargeList()
+    {
+        // the Eytzinger lookup must agree with a linear scan on a full sized list
+        std::mt19937 rnd(42);
+        const QVector<kt::IPBlock> ranges = randomRanges(rnd, NUM_RANGES);
+        kt::IPBlockList bl;
+        bl.addBlocks(ranges);
+        QCOMPARE(bl.count(), (bt::Uint32)ranges.size());
+
+        int hits = 0;
+        const QVector<bt::Uint32> ips = randomAddresses(rnd, ranges, NUM_LOOKUPS);
+        for (bt::Uint32 ip : ips)
+        {
+            bool blocked = linearBlocked(ranges, ip);
+            QCOMPARE(bl.isBlockedIP(ip), blocked);
+            hits += blocked ? 1 : 0;
+        }
+
+        // the edges of the ranges make sure both outcomes are covered
+        QVERIFY(hits > 0);
+        QVERIFY(hits < ips.size());
+    }
+
+    void benchmarkLookup()
+    {
+        std::mt19937 rnd(42);
+        const QVector<kt::IPBlock> ranges = randomRanges(rnd, NUM_RANGES);
+        kt::IPBlockList bl;
+        bl.addBlocks(ranges);
+        const QVector<bt::Uint32> ips = randomAddresses(rnd, ranges, NUM_BENCHMARK_LOOKUPS);
+
+        int expected = 0;
+        for (bt::Uint32 ip : ips)
+            expected += binarySearchBlocked(ranges, ip) ? 1 : 0;
+
+        int hits = 0;
+        QBENCHMARK
+        {
+            hits = 0;
+            for (bt::Uint32 ip : ips)
+                hits += bl.isBlockedIP(ip) ? 1 : 0;
+        }
+        QCOMPARE(hits, expected);
     }
 
+    void benchmarkBinarySearchLookup()
+    {
+        std::mt19937 rnd(42);
+        const QVector<kt::IPBlock> ranges = randomRanges(rnd, NUM_RANGES);
+        const QVector<bt::Uint32> ips = randomAddresses(rnd, ranges, NUM_BENCHMARK_LOOKUPS);
 
+        int hits = 0;
+        QBENCHMARK
+        {
+            hits = 0;
+            for (bt::Uint32 ip : ips)
+                hits += binarySearchBlocked(ranges, ip) ? 1 : 0;
+        }
+        QVERIFY(hits > 0);
+        QVERIFY(hits < ips.size());
+    }
+
+    void testLoadIPv6()
+    {
+        std::mt19937 rnd(3);
+        QVector<kt::IPv6Block> ranges;
+        for (int i = 0; i < 500; i++)
+        {
+            kt::IPv6Block b;
+            b.ip1.hi = generate64(rnd);
+            b.ip1.lo = generate64(rnd);
+            b.ip2.hi = b.ip1.hi + bounded(rnd, 4);
+            b.ip2.lo = generate64(rnd);
+            if (!(b.ip1 <= b.ip2))
+                b.ip2.lo = b.ip1.lo;
+            ranges.append(b);
+        }
+
+        QTemporaryFile tmp;
+        QVERIFY(tmp.open());
+        tmp.write((const char*)ranges.constData(), ranges.size() * sizeof(kt::IPv6Block));
+        tmp.close();
+
+        kt::IPBlockList bl;
+        QVERIFY(bl.loadIPv6(tmp.fileName()));
+
+        QVector<kt::IPv6Key> ips;
+        for (int i = 0; i < 2000; i++)
+        {
+            kt::IPv6Key k;
+            k.hi = generate64(rnd);
+            k.lo = generate64(rnd);
+            ips << k;
+        }
+
+        for (const kt::IPv6Block& b : qAsConst(ranges))
+        {
+            kt::IPv6Key before = b.ip1;
+            kt::IPv6Key after = b.ip2;
+            before.lo--;
+            after.lo++;
+            ips << b.ip1 << b.ip2 << before << after;
+        }
+
+        for (const kt::IPv6Key& ip : qAsConst(ips))
+            QCOMPARE(bl.isBlockedIP(ip), linearBlocked(ranges, ip));
+    }
 
 private:
 
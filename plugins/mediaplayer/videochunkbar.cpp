@@ -73,7 +73,17 @@ namespace kt
     void VideoChunkBar::updateChunkBar()
     {
         updateBitSet();
-        updateBar(true);
+
+        // The position marker can jump anywhere, when it moves the whole bar needs to be redrawn
+        bool moved = false;
+        MediaFile::Ptr file = mfile.mediaFile();
+        if (file)
+        {
+            bt::TorrentFileStream::Ptr stream = file->stream().toStrongRef();
+            moved = stream && stream->currentChunk() != current_chunk;
+        }
+
+        updateBar(moved);
         setVisible(!bitset.allOn());
     }
 
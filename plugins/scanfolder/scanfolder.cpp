@@ -21,6 +21,8 @@
 #include "scanfolder.h"
 
 #include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
 
 #include <KConfigGroup>
 #include <KFileItem>
@@ -34,6 +36,11 @@
 #include "torrentloadqueue.h"
 #include "scanthread.h"
 
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 
 
 using namespace bt;
@@ -45,27 +52,201 @@ namespace kt
         : scanner(scanner),
           scan_directory(dir),
           watch(0),
-          recursive(recursive)
+          recursive(recursive),
+          inotify_fd(-1),
+          notifier(0)
     {
         bt::Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: scanning " << dir << endl;
 
-        KConfigGroup config(KSharedConfig::openConfig(), "DirWatch");
-        config.writeEntry("NFSPollInterval", 5000);
-        config.writeEntry("nfsPreferredMethod", "Stat"); // Force the usage of Stat method for NFS
-        config.sync();
+#ifdef Q_OS_LINUX
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd >= 0)
+        {
+            notifier = new QSocketNotifier(inotify_fd, QSocketNotifier::Read, this);
+            connect(notifier, SIGNAL(activated(int)), this, SLOT(inotifyEvents()));
+        }
+        else
+            bt::Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: inotify not available, using KDirWatch" << endl;
+#endif
 
-        watch = new KDirWatch(this);
-        connect(watch, SIGNAL(dirty(QString)), this, SLOT(scanDir(QString)));
-        connect(watch, SIGNAL(created(QString)), this, SLOT(scanDir(QString)));
+        startWatching();
+    }
 
-        watch->addDir(dir.toLocalFile(), recursive ? KDirWatch::WatchSubDirs : KDirWatch::WatchDirOnly);
 
-        scanner->addDirectory(dir, recursive);
+    ScanFolder::~ScanFolder()
+    {
+#ifdef Q_OS_LINUX
+        if (inotify_fd >= 0)
+        {
+            delete notifier;
+            ::close(inotify_fd);
+        }
+#endif
     }
 
+    void ScanFolder::startWatching()
+    {
+        const QString dir = QDir(scan_directory.toLocalFile()).absolutePath();
+        if (inotify_fd >= 0)
+        {
+            // Watch the top directory first, so that nothing written during the scan is missed
+            addWatch(dir);
+            const QStringList dirs = scanner->scan(dir, recursive);
+            for (const QString& d : dirs)
+                addWatch(d);
+            return;
+        }
 
-    ScanFolder::~ScanFolder()
+        if (!watch)
+        {
+            KConfigGroup config(KSharedConfig::openConfig(), "DirWatch");
+            config.writeEntry("NFSPollInterval", 5000);
+            config.writeEntry("nfsPreferredMethod", "Stat"); // Force the usage of Stat method for NFS
+            config.sync();
+
+            watch = new KDirWatch(this);
+            connect(watch, SIGNAL(dirty(QString)), this, SLOT(scanDir(QString)));
+            connect(watch, SIGNAL(created(QString)), this, SLOT(scanDir(QString)));
+        }
+
+        watch->addDir(scan_directory.toLocalFile(), recursive ? KDirWatch::WatchSubDirs : KDirWatch::WatchDirOnly);
+        scanner->scan(dir, recursive);
+    }
+
+    void ScanFolder::stopWatching()
+    {
+#ifdef Q_OS_LINUX
+        for (QHash<int, QString>::const_iterator i = watches.constBegin(); i != watches.constEnd(); i++)
+            inotify_rm_watch(inotify_fd, i.key());
+#endif
+        watches.clear();
+
+        if (watch)
+            watch->removeDir(scan_directory.toLocalFile());
+    }
+
+    void ScanFolder::addWatch(const QString& dir)
+    {
+#ifdef Q_OS_LINUX
+        // Files are only reported when they are closed after writing, so torrents which are still being written are not seen
+        int wd = inotify_add_watch(inotify_fd, QFile::encodeName(dir).constData(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+        if (wd >= 0)
+            watches.insert(wd, dir);
+        else
+            bt::Out(SYS_SNF | LOG_DEBUG) << "ScanFolder: cannot watch " << dir << endl;
+#else
+        Q_UNUSED(dir);
+#endif
+    }
+
+    void ScanFolder::removeWatches(const QString& dir)
     {
+        const QString prefix = dir + QLatin1Char('/');
+        QHash<int, QString>::iterator i = watches.begin();
+        while (i != watches.end())
+        {
+            if (i.value() == dir || i.value().startsWith(prefix))
+            {
+#ifdef Q_OS_LINUX
+                inotify_rm_watch(inotify_fd, i.key());
+#endif
+                i = watches.erase(i);
+            }
+            else
+                i++;
+        }
+    }
+
+    void ScanFolder::inotifyEvents()
+    {
+#ifdef Q_OS_LINUX
+        const QString loaded_localized = i18nc("folder name part", "loaded");
+        QStringList changed;
+        QStringList removed;
+        QStringList removed_dirs;
+        QStringList new_dirs;
+        bool overflow = false;
+
+        char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t len = 0;
+        while ((len = ::read(inotify_fd, buf, sizeof(buf))) > 0)
+        {
+            const char* ptr = buf;
+            while (ptr < buf + len)
+            {
+                const struct inotify_event* ev = (const struct inotify_event*)ptr;
+                ptr += sizeof(struct inotify_event) + ev->len;
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    overflow = true;
+                    continue;
+                }
+
+                if (ev->mask & IN_IGNORED)
+                {
+                    watches.remove(ev->wd);
+                    continue;
+                }
+
+                QHash<int, QString>::const_iterator w = watches.constFind(ev->wd);
+                if (w == watches.constEnd() || ev->len == 0)
+                    continue;
+
+                const QString name = QFile::decodeName(ev->name);
+                const QString path = w.value() + QLatin1Char('/') + name;
+                if (ev->mask & IN_ISDIR)
+                {
+                    if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                    {
+                        if (recursive && !name.startsWith(QLatin1Char('.')) && name != loaded_localized)
+                            new_dirs.append(path);
+                    }
+                    else if (ev->mask & IN_MOVED_FROM)
+                    {
+                        removeWatches(path);
+                        removed_dirs.append(path);
+                    }
+                }
+                else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                {
+                    changed.append(path);
+                }
+                else if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    removed.append(path);
+                }
+            }
+        }
+
+        if (!removed.isEmpty())
+            scanner->filesRemoved(removed);
+
+        if (!removed_dirs.isEmpty())
+            scanner->dirsRemoved(removed_dirs);
+
+        if (overflow)
+        {
+            // events have been lost, so everything needs to be looked at again
+            Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: too many changes, rescanning " << scan_directory.toLocalFile() << endl;
+            const QStringList dirs = scanner->scan(scan_directory.toLocalFile(), recursive);
+            for (const QString& d : dirs)
+                addWatch(d);
+            return;
+        }
+
+        if (!changed.isEmpty())
+            scanner->filesChanged(changed);
+
+        for (const QString& dir : qAsConst(new_dirs))
+        {
+            addWatch(dir);
+            const QStringList dirs = scanner->scan(dir, true);
+            for (const QString& d : dirs)
+                addWatch(d);
+        }
+#endif
     }
 
     void ScanFolder::scanDir(const QString& path)
@@ -82,7 +263,7 @@ namespace kt
             return;
 
         Out(SYS_SNF | LOG_NOTICE) << "Directory dirty: " << path << endl;
-        scanner->addDirectory(QUrl::fromLocalFile(path), false);
+        scanner->scan(path, false);
     }
 
     void ScanFolder::setRecursive(bool rec)
@@ -90,8 +271,8 @@ namespace kt
         if (recursive != rec)
         {
             recursive = rec;
-            watch->removeDir(scan_directory.toLocalFile());
-            watch->addDir(scan_directory.toLocalFile(), recursive ? KDirWatch::WatchSubDirs : KDirWatch::WatchDirOnly);
+            stopWatching();
+            startWatching();
         }
     }
 
@@ -21,10 +21,13 @@
 #ifndef SCANFOLDER_H
 #define SCANFOLDER_H
 
+#include <QHash>
 #include <QObject>
 #include <QUrl>
 #include <KDirWatch>
 
+class QSocketNotifier;
+
 namespace kt
 {
 
@@ -33,7 +36,9 @@ namespace kt
     class ScanThread;
 
     /**
-     * Monitors a folder for changes, and passes torrents to load to the TorrentLoadQueue
+     * Monitors a folder for changes, and passes torrents to load to the TorrentLoadQueue.
+     * On Linux inotify is used, so that only the changed files need to be looked at,
+     * elsewhere KDirWatch triggers a rescan of the changed directory.
     */
     class ScanFolder : public QObject
     {
@@ -57,11 +62,23 @@ namespace kt
     public slots:
         void scanDir(const QString& path);
 
+    private slots:
+        void inotifyEvents();
+
+    private:
+        void startWatching();
+        void stopWatching();
+        void addWatch(const QString& dir);
+        void removeWatches(const QString& dir);
+
     private:
         ScanThread* scanner;
         QUrl scan_directory;
         KDirWatch* watch;
         bool recursive;
+        int inotify_fd;
+        QSocketNotifier* notifier;
+        QHash<int, QString> watches;
     };
 }
 #endif
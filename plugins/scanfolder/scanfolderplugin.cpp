@@ -63,6 +63,8 @@ namespace kt
         tlq = new TorrentLoadQueue(getCore(), this);
         scanner = new ScanThread();
         connect(scanner, SIGNAL(found(QList<QUrl>)), tlq, SLOT(add(QList<QUrl>)), Qt::QueuedConnection);
+        connect(tlq, SIGNAL(loaded(QUrl, qint64, QDateTime, QByteArray)),
+                scanner, SLOT(torrentLoaded(QUrl, qint64, QDateTime, QByteArray)), Qt::QueuedConnection);
         pref = new ScanFolderPrefPage(this, 0);
         getGUI()->addPrefPage(pref);
         connect(getCore(), SIGNAL(settingsChanged()), this, SLOT(updateScanFolders()));
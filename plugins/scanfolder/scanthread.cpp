@@ -23,17 +23,30 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QEvent>
-#include <QTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QSet>
+#include <QWaitCondition>
 
 #include <KLocalizedString>
 
+#include <bcodec/bdecoder.h>
+#include <bcodec/bencoder.h>
+#include <bcodec/bnode.h>
+#include <interfaces/functions.h>
+#include <util/error.h>
 #include <util/fileops.h>
+#include <util/log.h>
 
+using namespace bt;
 
 namespace kt
 {
     const int UPDATE_FOLDER_EVENT = QEvent::User + 1;
-    const int RECURSIVE_SCAN_EVENT = QEvent::User + 2;
+
+    /// Time after a change of the index, before it is written to disk
+    const int INDEX_SAVE_DELAY = 5000;
 
     class UpdateFolderEvent : public QEvent
     {
@@ -45,23 +58,129 @@ namespace kt
         {}
     };
 
-    class RecursiveScanEvent : public QEvent
+    namespace
     {
-    public:
-        RecursiveScanEvent(const QUrl& url) : QEvent((QEvent::Type)RECURSIVE_SCAN_EVENT), url(url)
-        {}
+        /**
+         * Walks a directory tree, every directory is listed by a separate task on a thread pool.
+         */
+        class DirectoryWalk
+        {
+        public:
+            struct File
+            {
+                QString path;
+                qint64 size;
+                QDateTime modified;
+                bool marked; // there is a hidden file with the same name, left by older versions
+            };
+
+            DirectoryWalk(QThreadPool* pool, bool recursive, const bool* stop_requested)
+                : pool(pool),
+                  recursive(recursive),
+                  stop_requested(stop_requested),
+                  loaded_localized(i18nc("folder name part", "loaded")),
+                  pending(0)
+            {}
+
+            /// Walk the tree starting at dir, returns when all directories have been listed
+            void run(const QString& dir);
+
+            /// List one directory (called from the thread pool)
+            void list(const QString& dir);
+
+            QStringList dirs;
+            QList<File> files;
+
+        private:
+            QThreadPool* pool;
+            bool recursive;
+            const bool* stop_requested;
+            QString loaded_localized;
+            QMutex mutex;
+            QWaitCondition finished;
+            int pending;
+        };
+
+        class ListTask : public QRunnable
+        {
+        public:
+            ListTask(DirectoryWalk* walk, const QString& dir) : walk(walk), dir(dir)
+            {}
 
-        virtual ~RecursiveScanEvent()
-        {}
+            virtual void run()
+            {
+                walk->list(dir);
+            }
 
-        QUrl url;
-    };
+        private:
+            DirectoryWalk* walk;
+            QString dir;
+        };
+
+        void DirectoryWalk::run(const QString& dir)
+        {
+            QMutexLocker lock(&mutex);
+            pending = 1;
+            pool->start(new ListTask(this, QDir(dir).absolutePath()));
+            while (pending > 0)
+                finished.wait(&mutex);
+        }
+
+        void DirectoryWalk::list(const QString& dir)
+        {
+            QStringList subdirs;
+            QList<File> found;
+            if (!*stop_requested)
+            {
+                QSet<QString> hidden;
+                const QFileInfoList entries = QDir(dir).entryInfoList(QDir::Files | QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot | QDir::Readable);
+                for (const QFileInfo& fi : entries)
+                {
+                    const QString name = fi.fileName();
+                    if (name.startsWith(QLatin1Char('.')))
+                    {
+                        if (!fi.isDir())
+                            hidden.insert(name.mid(1));
+                    }
+                    else if (fi.isDir())
+                    {
+                        if (recursive && !fi.isSymLink() && name != loaded_localized)
+                            subdirs.append(fi.absoluteFilePath());
+                    }
+                    else if (name.endsWith(QLatin1String(".torrent"), Qt::CaseInsensitive))
+                    {
+                        File f = {fi.absoluteFilePath(), fi.size(), fi.lastModified(), false};
+                        found.append(f);
+                    }
+                }
+
+                for (File& f : found)
+                    f.marked = hidden.contains(f.path.mid(f.path.lastIndexOf(QLatin1Char('/')) + 1));
+            }
+
+            QMutexLocker lock(&mutex);
+            dirs.append(dir);
+            files.append(found);
+            for (const QString& subdir : qAsConst(subdirs))
+            {
+                pending++;
+                pool->start(new ListTask(this, subdir));
+            }
+
+            if (--pending == 0)
+                finished.wakeAll();
+        }
+    }
 
     ScanThread::ScanThread()
         : stop_requested(false),
-          recursive(false)
+          recursive(false),
+          index_dirty(false),
+          save_timer(0)
     {
         scan_folders.setAutoDelete(true);
+        // listing directories is mostly waiting on the disk, so a few more threads than cores do no harm
+        pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() * 2, 8));
         moveToThread(this);
     }
 
@@ -76,12 +195,6 @@ namespace kt
         recursive = rec;
     }
 
-
-    void ScanThread::addDirectory(const QUrl& url, bool recursive)
-    {
-        scan(url, recursive);
-    }
-
     void ScanThread::setFolderList(const QStringList& folders)
     {
         QMutexLocker lock(&mutex);
@@ -99,11 +212,6 @@ namespace kt
         {
             updateFolders();
         }
-        else if (ev->type() == RECURSIVE_SCAN_EVENT)
-        {
-            RecursiveScanEvent* rev = (RecursiveScanEvent*)ev;
-            scan(rev->url, true);
-        }
         ev->accept();
     }
 
@@ -149,8 +257,17 @@ namespace kt
 
     void ScanThread::run()
     {
+        loadIndex();
+        save_timer = new QTimer();
+        save_timer->setSingleShot(true);
+        connect(save_timer, SIGNAL(timeout()), this, SLOT(saveIndex()));
+
         updateFolders();
         exec();
+
+        saveIndex();
+        delete save_timer;
+        save_timer = 0;
     }
 
     void ScanThread::stop()
@@ -160,47 +277,206 @@ namespace kt
         wait();
     }
 
-    bool ScanThread::alreadyLoaded(const QDir& d, const QString& torrent)
+    bool ScanThread::alreadyLoaded(const QString& path, qint64 size, const QDateTime& modified) const
     {
-        return d.exists(QLatin1Char('.') + torrent);
+        // a file which has been changed since it was loaded, is a new torrent
+        QHash<QString, IndexEntry>::const_iterator i = index.constFind(path);
+        return i != index.constEnd() && i->size == size && i->modified == modified.toMSecsSinceEpoch();
     }
 
 
-    void ScanThread::scan(const QUrl& dir, bool recursive)
+    QStringList ScanThread::scan(const QString& dir, bool recursive)
     {
         if (stop_requested)
-            return;
+            return QStringList();
 
-        QStringList filters;
-        filters << QStringLiteral("*.torrent");
-        QDir d(dir.toLocalFile());
-        QStringList files = d.entryList(filters, QDir::Readable | QDir::Files);
+        DirectoryWalk walk(&pool, recursive, &stop_requested);
+        walk.run(dir);
 
         QList<QUrl> torrents;
-        foreach (const QString& tor, files)
+        QSet<QString> present;
+        for (const DirectoryWalk::File& f : qAsConst(walk.files))
         {
-            if (!alreadyLoaded(d, tor))
-                torrents.append(QUrl::fromLocalFile(d.absoluteFilePath(tor)));
+            present.insert(f.path);
+            if (f.marked)
+            {
+                // loaded by an older version, remember it in the index from now on
+                if (!index.contains(f.path))
+                {
+                    IndexEntry e = {f.size, f.modified.toMSecsSinceEpoch(), QByteArray()};
+                    index.insert(f.path, e);
+                    indexChanged();
+                }
+            }
+            else if (!alreadyLoaded(f.path, f.size, f.modified))
+            {
+                torrents.append(QUrl::fromLocalFile(f.path));
+            }
         }
 
-        found(torrents);
+        // forget the files which are no longer in the scanned directories
+        QSet<QString> scanned;
+        scanned.reserve(walk.dirs.size());
+        for (const QString& dir : qAsConst(walk.dirs))
+            scanned.insert(dir);
 
-        if (stop_requested)
-            return;
+        QHash<QString, IndexEntry>::iterator i = index.begin();
+        while (i != index.end())
+        {
+            const QString& path = i.key();
+            if (!present.contains(path) && scanned.contains(path.left(path.lastIndexOf(QLatin1Char('/')))))
+            {
+                i = index.erase(i);
+                indexChanged();
+            }
+            else
+                i++;
+        }
+
+        if (!torrents.isEmpty())
+            found(torrents);
 
-        if (recursive)
+        return walk.dirs;
+    }
+
+    void ScanThread::filesChanged(const QStringList& files)
+    {
+        QList<QUrl> torrents;
+        for (const QString& path : files)
         {
-            const QString loaded_localized = i18nc("folder name part", "loaded");
+            QFileInfo fi(path);
+            const QString name = fi.fileName();
+            if (name.startsWith(QLatin1Char('.')) || !name.endsWith(QLatin1String(".torrent"), Qt::CaseInsensitive) || !fi.isFile())
+                continue;
+
+            if (!alreadyLoaded(path, fi.size(), fi.lastModified()))
+                torrents.append(QUrl::fromLocalFile(path));
+        }
+
+        if (!torrents.isEmpty())
+            found(torrents);
+    }
+
+    void ScanThread::filesRemoved(const QStringList& files)
+    {
+        for (const QString& path : files)
+        {
+            if (index.remove(path))
+                indexChanged();
+        }
+    }
 
-            QStringList dirs = d.entryList(QDir::Readable | QDir::Dirs);
-            foreach (const QString& subdir, dirs)
+    void ScanThread::dirsRemoved(const QStringList& dirs)
+    {
+        QHash<QString, IndexEntry>::iterator i = index.begin();
+        while (i != index.end())
+        {
+            bool in_dir = false;
+            for (const QString& dir : dirs)
             {
-                if (subdir != QStringLiteral(".") && subdir != QStringLiteral("..") && subdir != loaded_localized)
+                if (i.key().startsWith(dir + QLatin1Char('/')))
                 {
-                    QCoreApplication::postEvent(this, new RecursiveScanEvent(QUrl::fromLocalFile(d.absoluteFilePath(subdir))));
+                    in_dir = true;
+                    break;
                 }
             }
+
+            if (in_dir)
+            {
+                i = index.erase(i);
+                indexChanged();
+            }
+            else
+                i++;
+        }
+    }
+
+    void ScanThread::torrentLoaded(const QUrl& url, qint64 size, const QDateTime& modified, const QByteArray& info_hash)
+    {
+        IndexEntry e = {size, modified.toMSecsSinceEpoch(), info_hash};
+        index.insert(url.toLocalFile(), e);
+        indexChanged();
+    }
+
+    void ScanThread::indexChanged()
+    {
+        index_dirty = true;
+        if (save_timer && !save_timer->isActive())
+            save_timer->start(INDEX_SAVE_DELAY);
+    }
+
+    void ScanThread::loadIndex()
+    {
+        QString fn = kt::DataDir() + QStringLiteral("scanfolder_index");
+        QFile fptr(fn);
+        if (!fptr.open(QIODevice::ReadOnly))
+            return;
+
+        QByteArray data = fptr.readAll();
+        BDecoder dec(data, false);
+        BNode* node = 0;
+        try
+        {
+            node = dec.decode();
+            if (!node || node->getType() != BNode::LIST)
+                throw bt::Error(QStringLiteral("Toplevel node not a list"));
+
+            BListNode* l = (BListNode*)node;
+            for (Uint32 i = 0; i < l->getNumChildren(); i++)
+            {
+                BDictNode* d = l->getDict(i);
+                if (!d)
+                    continue;
+
+                IndexEntry e;
+                e.size = d->getInt64(QByteArrayLiteral("size"));
+                e.modified = d->getInt64(QByteArrayLiteral("modified"));
+                e.info_hash = d->getByteArray(QByteArrayLiteral("hash"));
+                index.insert(QString::fromUtf8(d->getByteArray(QByteArrayLiteral("path"))), e);
+            }
+        }
+        catch (bt::Error& err)
+        {
+            Out(SYS_SNF | LOG_DEBUG) << "Failed to load " << fn << " : " << err.toString() << endl;
+            index.clear();
+        }
+
+        delete node;
+        index_dirty = false;
+    }
+
+    void ScanThread::saveIndex()
+    {
+        if (!index_dirty)
+            return;
+
+        QByteArray data;
+        BEncoder enc(new BEncoderBufferOutput(data));
+        enc.beginList();
+        for (QHash<QString, IndexEntry>::const_iterator i = index.constBegin(); i != index.constEnd(); i++)
+        {
+            enc.beginDict();
+            enc.write(QByteArrayLiteral("hash"));
+            enc.write(i->info_hash);
+            enc.write(QByteArrayLiteral("modified"));
+            enc.write((bt::Uint64)i->modified);
+            enc.write(QByteArrayLiteral("path"));
+            enc.write(i.key().toUtf8());
+            enc.write(QByteArrayLiteral("size"));
+            enc.write((bt::Uint64)i->size);
+            enc.end();
+        }
+        enc.end();
+
+        // write a new file and rename it over the old one, so a crash can't leave half an index behind
+        QString fn = kt::DataDir() + QStringLiteral("scanfolder_index");
+        QSaveFile fptr(fn);
+        if (!fptr.open(QIODevice::WriteOnly) || fptr.write(data) != data.size() || !fptr.commit())
+        {
+            Out(SYS_SNF | LOG_DEBUG) << "Failed to write file " << fn << " : " << fptr.errorString() << endl;
+            return;
         }
+        index_dirty = false;
     }
 
 }
@@ -21,22 +21,25 @@
 #ifndef KT_SCANTHREAD_H
 #define KT_SCANTHREAD_H
 
+#include <QDateTime>
+#include <QHash>
 #include <QMutex>
 #include <QStringList>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 #include <QUrl>
 
 #include <util/ptrmap.h>
 #include "scanfolder.h"
 
 
-class QDir;
-
 namespace kt
 {
 
     /**
      * Thread which scans directories in the background and looks for torrent files.
+     * Files which have been loaded are remembered in an index, which is kept on disk.
      */
     class ScanThread : public QThread
     {
@@ -52,11 +55,31 @@ namespace kt
         void setRecursive(bool rec);
 
         /**
-         * Add a directory to scan.
-         * @param url Directory
+         * Scan a directory for torrents which have not been loaded yet. The directory tree
+         * is walked in parallel on a thread pool.
+         * @param dir Directory
          * @param recursive Whether or not to scan resursively
+         * @return The directories which have been scanned
+         */
+        QStringList scan(const QString& dir, bool recursive);
+
+        /**
+         * Check files which have been written or moved into a watched directory.
+         * @param files Paths of the files
+         */
+        void filesChanged(const QStringList& files);
+
+        /**
+         * Files have been removed from a watched directory, forget about them.
+         * @param files Paths of the files
          */
-        void addDirectory(const QUrl& url, bool recursive);
+        void filesRemoved(const QStringList& files);
+
+        /**
+         * Directories have been removed from a watched directory, forget about the files in them.
+         * @param dirs Paths of the directories
+         */
+        void dirsRemoved(const QStringList& dirs);
 
         /**
          * Stop the scanning thread.
@@ -69,15 +92,37 @@ namespace kt
          */
         void setFolderList(const QStringList& folders);
 
+    public slots:
+        /**
+         * A torrent file has been loaded and is left in place, add it to the index.
+         * @param url The file
+         * @param size Size of the file when it was loaded
+         * @param modified Modification time of the file when it was loaded
+         * @param info_hash Info hash of the torrent
+         */
+        void torrentLoaded(const QUrl& url, qint64 size, const QDateTime& modified, const QByteArray& info_hash);
+
     protected:
         virtual void run();
 
     private:
-        void scan(const QUrl& dir, bool recursive);
-        bool alreadyLoaded(const QDir& d, const QString& torrent);
+        /// Entry of the index of loaded files
+        struct IndexEntry
+        {
+            qint64 size;
+            qint64 modified; // msecs since epoch
+            QByteArray info_hash;
+        };
+
+        bool alreadyLoaded(const QString& path, qint64 size, const QDateTime& modified) const;
         void updateFolders();
+        void loadIndex();
+        void indexChanged();
         virtual void customEvent(QEvent* ev);
 
+    private slots:
+        void saveIndex();
+
     signals:
         /**
          * Emitted when one or more torrents are found.
@@ -91,6 +136,10 @@ namespace kt
         bool stop_requested;
         bool recursive;
         bt::PtrMap<QString, ScanFolder> scan_folders;
+        QHash<QString, IndexEntry> index;
+        bool index_dirty;
+        QTimer* save_timer;
+        QThreadPool pool;
     };
 
 }
@@ -23,12 +23,15 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QDateTime>
+#include <QRunnable>
+#include <QThread>
 
 #include <KLocalizedString>
 #include <KIO/Job>
 
 #include <bcodec/bnode.h>
 #include <bcodec/bdecoder.h>
+#include <util/sha1hash.h>
 #include <interfaces/coreinterface.h>
 #include <util/functions.h>
 #include <util/fileops.h>
@@ -39,50 +42,126 @@
 
 namespace kt
 {
+    namespace
+    {
+        /// Time before checking again if a file which is not a valid torrent is still being written
+        const int RETRY_INTERVAL = 1000;
+
+        /// Maximum number of torrents handed to the core in one go
+        const int MAX_BATCH_SIZE = 100;
+
+        class ValidateTask : public QRunnable
+        {
+        public:
+            ValidateTask(TorrentLoadQueue* queue, const QUrl& url) : queue(queue), url(url)
+            {}
+
+            virtual void run()
+            {
+                queue->validate(url);
+            }
+
+        private:
+            TorrentLoadQueue* queue;
+            QUrl url;
+        };
+    }
+
     TorrentLoadQueue::TorrentLoadQueue(CoreInterface* core, QObject* parent)
         : QObject(parent),
-          core(core)
+          core(core),
+          validating(0),
+          loading(false)
     {
-        connect(&timer, SIGNAL(timeout()), this, SLOT(loadOne()));
+        connect(&timer, SIGNAL(timeout()), this, SLOT(startValidation()));
         timer.setSingleShot(true);
+        connect(&retry_timer, SIGNAL(timeout()), this, SLOT(retry()));
+        retry_timer.setSingleShot(true);
+
+        // validation is mostly reading files, so a few more threads than cores do no harm
+        pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() * 2, 8));
     }
 
     TorrentLoadQueue::~TorrentLoadQueue()
     {
-
+        pool.clear();
+        pool.waitForDone();
     }
 
     void TorrentLoadQueue::add(const QUrl& url)
     {
+        // files which are already queued or being validated are found again by the next scan
+        if (candidates.contains(url))
+            return;
+
+        Candidate c = {-1, QDateTime()};
+        candidates.insert(url, c);
         to_load.append(url);
         if (!timer.isActive())
-            timer.start(1000);
+            timer.start(0);
     }
 
     void TorrentLoadQueue::add(const QList<QUrl>& urls)
     {
-        to_load.append(urls);
-        if (!timer.isActive())
-            timer.start(1000);
+        for (const QUrl& url : urls)
+            add(url);
     }
 
+    void TorrentLoadQueue::startValidation()
+    {
+        for (const QUrl& url : qAsConst(to_load))
+        {
+            validating++;
+            pool.start(new ValidateTask(this, url));
+        }
+        to_load.clear();
+    }
 
-    bool TorrentLoadQueue::validateTorrent(const QUrl& url, QByteArray& data)
+    void TorrentLoadQueue::validate(const QUrl& url)
     {
-        // try to decode file, if it is syntactically correct, we can try to load it
+        Result r;
+        r.url = url;
+        r.valid = false;
+
+        QFileInfo fi(url.toLocalFile());
+        r.size = fi.exists() ? fi.size() : -1;
+        r.modified = fi.lastModified();
+
         QFile fptr(url.toLocalFile());
-        if (!fptr.open(QIODevice::ReadOnly))
-            return false;
+        if (fptr.open(QIODevice::ReadOnly))
+        {
+            r.data = fptr.readAll();
+            r.valid = validateTorrent(r.data, r.info_hash);
+            if (!r.valid)
+                r.data.clear();
+        }
+
+        QMutexLocker lock(&mutex);
+        results.append(r);
+        // Only wake up the queue for the first result, the others are picked up with it
+        if (results.count() == 1)
+            QMetaObject::invokeMethod(this, "processResults", Qt::QueuedConnection);
+    }
 
+    bool TorrentLoadQueue::validateTorrent(const QByteArray& data, QByteArray& info_hash)
+    {
+        // try to decode file, if it is syntactically correct, we can try to load it
         try
         {
-            data = fptr.readAll();
-
             bt::BDecoder dec(data, false);
             bt::BNode* n = dec.decode();
             if (n)
             {
                 // valid node, so file is complete
+                if (n->getType() == bt::BNode::DICT)
+                {
+                    bt::BDictNode* info = ((bt::BDictNode*)n)->getDict(QByteArrayLiteral("info"));
+                    if (info)
+                    {
+                        bt::SHA1Hash hash = bt::SHA1Hash::generate((const bt::Uint8*)data.constData() + info->getOffset(), info->getLength());
+                        info_hash = QByteArray((const char*)hash.getData(), 20);
+                    }
+                }
                 delete n;
                 return true;
             }
@@ -99,53 +178,101 @@ namespace kt
         }
     }
 
-    void TorrentLoadQueue::loadOne()
+    void TorrentLoadQueue::processResults()
     {
-        if (to_load.isEmpty())
-            return;
-
-        QUrl url = to_load.takeFirst();
-
-        QByteArray data;
-        if (validateTorrent(url, data))
+        QList<Result> done;
         {
-            // Load it
-            load(url, data);
+            QMutexLocker lock(&mutex);
+            done.swap(results);
         }
-        else
+
+        for (const Result& r : qAsConst(done))
         {
+            validating--;
+            if (r.valid)
+            {
+                ready.append(r);
+                continue;
+            }
+
             // Not valid, so two options:
             // - not a torrent
             // - incomplete torrent, still being written
-            // We use the last modified time to determine this
-            if (QFileInfo(url.toLocalFile()).lastModified().secsTo(QDateTime::currentDateTime()) < 2)
+            // As long as the size or modification time keeps changing, it is still being written
+            QHash<QUrl, Candidate>::iterator c = candidates.find(r.url);
+            if (r.size < 0 || c == candidates.end() || (c->size == r.size && c->modified == r.modified))
             {
-                // Still being written, lets try again later
-                to_load.append(url);
+                candidates.remove(r.url);
+            }
+            else
+            {
+                c->size = r.size;
+                c->modified = r.modified;
+                to_retry.append(r.url);
+                if (!retry_timer.isActive())
+                    retry_timer.start(RETRY_INTERVAL);
             }
         }
 
-        if (!to_load.isEmpty())
-            timer.start(1000);
+        // Loading can show dialogs which run an event loop, the outer call will pick up the new torrents
+        if (loading)
+            return;
+
+        // Hand the torrents over when everything is validated, or when there are enough for a batch
+        loading = true;
+        while (!ready.isEmpty() && (validating == 0 || ready.count() >= MAX_BATCH_SIZE))
+        {
+            QList<Result> batch = ready.mid(0, MAX_BATCH_SIZE);
+            ready = ready.mid(batch.count());
+            load(batch);
+        }
+        loading = false;
     }
 
-    void TorrentLoadQueue::load(const QUrl& url, const QByteArray& data)
+    void TorrentLoadQueue::retry()
+    {
+        to_load.append(to_retry);
+        to_retry.clear();
+        startValidation();
+    }
+
+    void TorrentLoadQueue::load(const QList<Result>& batch)
     {
-        bt::Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: loading " << url.toDisplayString() << bt::endl;
         QString group;
         if (ScanFolderPluginSettings::addToGroup())
             group = ScanFolderPluginSettings::group();
 
         if (ScanFolderPluginSettings::openSilently())
-            core->loadSilently(data, url, group, QString());
+        {
+            QList<QPair<QByteArray, QUrl> > torrents;
+            for (const Result& r : batch)
+            {
+                bt::Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: loading " << r.url.toDisplayString() << bt::endl;
+                torrents.append(qMakePair(r.data, r.url));
+            }
+
+            core->loadSilently(torrents, group);
+        }
         else
-            core->load(data, url, group, QString());
+        {
+            // every torrent shows a dialog, so no point in batching
+            for (const Result& r : batch)
+            {
+                bt::Out(SYS_SNF | LOG_NOTICE) << "ScanFolder: loading " << r.url.toDisplayString() << bt::endl;
+                core->load(r.data, r.url, group, QString());
+            }
+        }
 
-        loadingFinished(url);
+        for (const Result& r : batch)
+        {
+            candidates.remove(r.url);
+            loadingFinished(r);
+        }
     }
 
-    void TorrentLoadQueue::loadingFinished(const QUrl& url)
+    void TorrentLoadQueue::loadingFinished(const Result& r)
     {
+        const QUrl& url = r.url;
         QString name = url.fileName();
         QString dirname = QFileInfo(url.toLocalFile()).absolutePath();
         if (!dirname.endsWith(bt::DirSeparator()))
@@ -174,9 +301,8 @@ namespace kt
                            KIO::HideProgressInfo | KIO::Overwrite);
             break;
         case DefaultAction:
-            QFile f(dirname + QLatin1Char('.') + name);
-            f.open(QIODevice::WriteOnly);
-            f.close();
+            // the scanner remembers it in it's index, so it will not be loaded again
+            emit loaded(url, r.size, r.modified, r.info_hash);
             break;
         }
     }
@@ -21,6 +21,10 @@
 #ifndef KT_TORRENTLOADQUEUE_H
 #define KT_TORRENTLOADQUEUE_H
 
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
 #include <QUrl>
 #include <QTimer>
 
@@ -38,8 +42,8 @@ namespace kt
     };
 
     /**
-     * Queue of potential torrents. It will try to load them one by one,
-     * in a sane and none GUI blocking way.
+     * Queue of potential torrents. The files are validated on a thread pool,
+     * and the valid ones are handed to the core in batches.
      */
     class TorrentLoadQueue : public QObject
     {
@@ -54,6 +58,12 @@ namespace kt
         /// Get the loaded torrent action
         LoadedTorrentAction loadedTorrentAction() const {return action;}
 
+        /**
+         * Read and validate a file (called from the thread pool).
+         * @param url The file url
+         */
+        void validate(const QUrl& url);
+
     public slots:
         /**
          * Add a torrent to load.
@@ -65,40 +75,87 @@ namespace kt
          */
         void add(const QList<QUrl>& urls);
 
+    signals:
+        /**
+         * A torrent file has been loaded and is left where it is.
+         * @param url The file
+         * @param size Size of the file
+         * @param modified Modification time of the file
+         * @param info_hash Info hash of the torrent
+         */
+        void loaded(const QUrl& url, qint64 size, const QDateTime& modified, const QByteArray& info_hash);
+
     private:
+        /// Result of validating a file
+        struct Result
+        {
+            QUrl url;
+            QByteArray data;
+            QByteArray info_hash;
+            qint64 size;
+            QDateTime modified;
+            bool valid;
+        };
+
+        /// A file which is queued, being validated or waiting to be retried
+        struct Candidate
+        {
+            qint64 size;
+            QDateTime modified;
+        };
+
         /**
-         * Validate if a file is a torrent.
-         * @param url The file url
-         * @param data The torrent data will be put into this array upon success
+         * Validate if data is a torrent.
+         * @param data The file data
+         * @param info_hash The info hash of the torrent will be put into this array upon success
          * @return true upon success, false otherwise
          */
-        bool validateTorrent(const QUrl& url, QByteArray& data);
+        static bool validateTorrent(const QByteArray& data, QByteArray& info_hash);
 
         /**
-         * Load a torrent
-         * @param url The file url
-         * @param data The torrent data
+         * Load a batch of torrents
+         * @param batch The validated torrents
          */
-        void load(const QUrl& url, const QByteArray& data);
+        void load(const QList<Result>& batch);
 
     private slots:
         /**
-         * Attempt to load one torrent
+         * Start validating all queued files
+         */
+        void startValidation();
+
+        /**
+         * Handle the files which have been validated
          */
-        void loadOne();
+        void processResults();
+
+        /**
+         * Queue the files which were still being written again
+         */
+        void retry();
 
     private:
         /**
          * Loading of a torrent has finished.
-         * @param url The url
+         * @param r The validated torrent
          */
-        void loadingFinished(const QUrl& url);
+        void loadingFinished(const Result& r);
 
     private:
         CoreInterface* core;
         QList<QUrl> to_load;
+        QList<QUrl> to_retry;
+        QHash<QUrl, Candidate> candidates;
+        QList<Result> ready;
+        int validating;
+        bool loading;
         LoadedTorrentAction action;
         QTimer timer;
+        QTimer retry_timer;
+        QThreadPool pool;
+
+        QMutex mutex;
+        QList<Result> results; // protected by mutex, filled by the thread pool
     };
 }
 
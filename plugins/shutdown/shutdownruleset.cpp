@@ -239,15 +239,7 @@ namespace kt
     bt::TorrentInterface* ShutdownRuleSet::torrentForHash(const QByteArray& hash)
     {
         bt::SHA1Hash ih((const bt::Uint8*)hash.data());
-        QueueManager* qman = core->getQueueManager();
-        for (QueueManager::iterator i = qman->begin(); i != qman->end(); i++)
-        {
-            bt::TorrentInterface* t = *i;
-            if (t->getInfoHash() == ih)
-                return t;
-        }
-
-        return 0;
+        return core->getQueueManager()->find(ih);
     }
 
     kt::Action ShutdownRuleSet::currentAction() const
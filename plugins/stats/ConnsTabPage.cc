@@ -242,33 +242,16 @@ namespace kt
 
     void ConnsTabPage::GatherConnStats(Plugin* pPlug)
     {
-        QueueManager* qm_iface = pPlug->getCore()->getQueueManager();
-
-        if (qm_iface == 0)
-        {
-            return;
-        }
+        kt::StatsSnapshot::Ptr snap = pPlug->getCore()->getStatsSnapshot();
 
         uint_least32_t lc, ls, sc, ss, tc, rtc;
 
-        lc = ls = sc = ss = tc = rtc = 0;
-
-        for (QList< bt::TorrentInterface*>::iterator it = qm_iface->begin(); it != qm_iface->end(); it++)
-        {
-            const bt::TorrentStats& tstat = (*it)->getStats();
-
-            lc += tstat.leechers_connected_to;
-            ls += tstat.leechers_total;
-            sc += tstat.seeders_connected_to;
-            ss += tstat.seeders_total;
-
-            tc++;
-
-            if (tstat.running)
-            {
-                rtc++;
-            }
-        }
+        lc = snap->leechers_connected;
+        ls = snap->leechers_total;
+        sc = snap->seeders_connected;
+        ss = snap->seeders_total;
+        tc = snap->torrents.count();
+        rtc = snap->num_running;
 
         uint8_t s1, s2;
 
@@ -140,50 +140,17 @@ namespace kt
 
     void SpdTabPage::gatherPeersSpeed(Plugin* pPlug)
     {
-        kt::QueueManager* qm_iface = pPlug->getCore()->getQueueManager();
-
-        if (qm_iface == 0)
-        {
-            return;
-        }
+        kt::StatsSnapshot::Ptr snap = pPlug->getCore()->getStatsSnapshot(true);
 
         uint_least64_t l_up_spd, l_dn_spd, s_dn_spd;
 
         uint_least32_t l_cnt, s_cnt;
 
-        l_up_spd = l_dn_spd = s_dn_spd = l_cnt = s_cnt = 0;
-
-        for (QList< bt::TorrentInterface*>::iterator it = qm_iface->begin(); it != qm_iface->end(); it++)
-        {
-            bt::TorrentControl* tctl = dynamic_cast<bt::TorrentControl*>(*it);
-
-            if (!tctl)
-            {
-                continue;
-            }
-
-            const bt::PeerManager* p_mgr = tctl->getPeerMgr();
-
-            QList<bt::Peer::Ptr> ppl = p_mgr->getPeers();
-
-            foreach (bt::Peer::Ptr peer, ppl)
-            {
-                const bt::PeerInterface::Stats p_stats = peer->getStats();
-
-                if (p_stats.perc_of_file >= 100)
-                {
-                    s_dn_spd += p_stats.download_rate;
-                    s_cnt++;
-
-                }
-                else
-                {
-                    l_dn_spd += p_stats.download_rate;
-                    l_up_spd += p_stats.upload_rate;
-                    l_cnt++;
-                }
-            }
-        }
+        l_up_spd = snap->peers.leecher_upload_rate;
+        l_dn_spd = snap->peers.leecher_download_rate;
+        s_dn_spd = snap->peers.seeder_download_rate;
+        l_cnt = snap->peers.leechers;
+        s_cnt = snap->peers.seeders;
 
         if (!l_cnt)
         {
@@ -54,6 +54,7 @@ namespace kt
         exclusion_all_must_match = false;
         exclusion_reg_exp = false;
         no_duplicate_se_matches = true;
+        compiled = false;
     }
 
     Filter::Filter(const QString& name) : name(name)
@@ -70,6 +71,7 @@ namespace kt
         exclusion_all_must_match = false;
         exclusion_reg_exp = false;
         no_duplicate_se_matches = true;
+        compiled = false;
     }
 
 
@@ -77,28 +79,51 @@ namespace kt
     {
     }
 
-    bool Filter::getSeasonAndEpisode(const QString& title, int& season, int& episode)
+    static QList<QRegularExpression> SeasonAndEpisodeFormats()
     {
+        // In order of preference
         QStringList se_formats;
         se_formats << QStringLiteral("(\\d+)x(\\d+)")
                    << QStringLiteral("S(\\d+)E(\\d+)")
                    << QStringLiteral("(\\d+)\\.(\\d+)")
                    << QStringLiteral("S(\\d+)\\.E(\\d+)");
 
-        foreach (const QString& format, se_formats)
+        QList<QRegularExpression> formats;
+        for (const QString& format : qAsConst(se_formats))
+        {
+            QRegularExpression exp(format, QRegularExpression::CaseInsensitiveOption);
+            exp.optimize();
+            formats.append(exp);
+        }
+        return formats;
+    }
+
+    bool Filter::getSeasonAndEpisode(const QString& title, int& season, int& episode)
+    {
+        static const QList<QRegularExpression> se_formats = SeasonAndEpisodeFormats();
+
+        // All formats need at least two digits, most titles without a season and episode don't have them
+        int digits = 0;
+        for (const QChar& c : title)
+        {
+            if (c.isDigit() && ++digits == 2)
+                break;
+        }
+
+        if (digits < 2)
+            return false;
+
+        for (const QRegularExpression& exp : se_formats)
         {
-            QRegExp exp(format, Qt::CaseInsensitive);
-            int pos = exp.indexIn(title);
-            if (pos > -1)
+            QRegularExpressionMatch m = exp.match(title);
+            if (m.hasMatch())
             {
-                QString s = exp.cap(1); // Season
-                QString e = exp.cap(2);  // Episode
                 bool ok = false;
-                season = s.toInt(&ok);
+                season = m.capturedRef(1).toInt(&ok);
                 if (!ok)
                     continue;
 
-                episode = e.toInt(&ok);
+                episode = m.capturedRef(2).toInt(&ok);
                 if (!ok)
                     continue;
 
@@ -109,65 +134,172 @@ namespace kt
         return false;
     }
 
-    bool Filter::match(const QString& title, QRegExp& exp)
+    FilterTitle::FilterTitle(const QString& title) : title(title), se_parsed(false), se_found(false), season(0), episode(0)
     {
-        int pos = 0;
-        return ((pos = exp.indexIn(title, pos)) != -1);
     }
 
-    bool Filter::match(Syndication::ItemPtr item)
+    bool FilterTitle::seasonAndEpisode(int& s, int& e) const
     {
-        bool found_match = false;
-        foreach (const QRegExp& exp, word_matches)
+        if (!se_parsed)
+        {
+            se_found = Filter::getSeasonAndEpisode(title, season, episode);
+            se_parsed = true;
+        }
+
+        s = season;
+        e = episode;
+        return se_found;
+    }
+
+    /// Convert a QRegExp::Wildcard pattern into a QRegularExpression pattern
+    static QString WildcardToRegularExpression(const QString& wildcard)
+    {
+        QString rx;
+        int len = wildcard.length();
+        for (int i = 0; i < len; i++)
         {
-            QRegExp tmp = exp;
-            tmp.setCaseSensitivity(case_sensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-            tmp.setPatternSyntax(use_regular_expressions ? QRegExp::RegExp : QRegExp::Wildcard);
-            if (all_word_matches_must_match)
+            QChar c = wildcard.at(i);
+            if (c == QLatin1Char('*'))
             {
-                if (!match(item->title(), tmp))
-                    return false;
-                else
-                    found_match = true;
+                rx += QStringLiteral(".*");
             }
-            else if (match(item->title(), tmp))
+            else if (c == QLatin1Char('?'))
             {
-                found_match = true;
-                break;
+                rx += QLatin1Char('.');
+            }
+            else if (c == QLatin1Char('['))
+            {
+                // Find the end of the set, a ] directly after the [ or [! is part of the set
+                int j = i + 1;
+                if (j < len && (wildcard.at(j) == QLatin1Char('!') || wildcard.at(j) == QLatin1Char('^')))
+                    j++;
+                if (j < len && wildcard.at(j) == QLatin1Char(']'))
+                    j++;
+                while (j < len && wildcard.at(j) != QLatin1Char(']'))
+                    j++;
+
+                // QRegExp turns an unclosed set into an invalid expression, which never matches
+                if (j == len)
+                    return QStringLiteral("(?!)");
+
+                QString set = wildcard.mid(i + 1, j - i - 1);
+                set.replace(QLatin1Char('\\'), QStringLiteral("\\\\"));
+                set.replace(QLatin1Char('['), QStringLiteral("\\["));
+                if (set.startsWith(QLatin1Char('!')))
+                    set[0] = QLatin1Char('^');
+                else if (set.startsWith(QLatin1Char('^')))
+                    set.prepend(QLatin1Char('\\'));
+                rx += QLatin1Char('[') + set + QLatin1Char(']');
+                i = j;
+            }
+            else
+            {
+                rx += QRegularExpression::escape(QString(c));
             }
         }
 
-        if (!found_match)
-            return false;
+        return rx;
+    }
 
-        found_match = false;
-        foreach (const QRegExp& exp, exclusion_patterns)
+    /**
+     * Compile a list of patterns, if combine is true the valid patterns
+     * are combined in a single expression which matches if any of them matches.
+     */
+    static QList<QRegularExpression> CompilePatterns(const QList<QRegExp>& patterns, bool reg_exp, bool case_sensitive, bool combine)
+    {
+        QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption;
+        if (!case_sensitive)
+            options |= QRegularExpression::CaseInsensitiveOption;
+        // QRegExp's . also matches newlines
+        options |= QRegularExpression::DotMatchesEverythingOption;
+
+        static const QRegularExpression back_reference(QStringLiteral("\\\\\\d"));
+
+        QList<QRegularExpression> exps;
+        QStringList sources;
+        for (const QRegExp& pattern : patterns)
         {
-            QRegExp tmp = exp;
-            tmp.setCaseSensitivity(exclusion_case_sensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-            tmp.setPatternSyntax(exclusion_reg_exp ? QRegExp::RegExp : QRegExp::Wildcard);
-            if (exclusion_all_must_match)
+            QString source = reg_exp ? pattern.pattern() : WildcardToRegularExpression(pattern.pattern());
+            QRegularExpression exp(source, options);
+            exps.append(exp);
+            // An invalid pattern never matches, so it can be left out of a combined expression,
+            // back references would refer to the wrong groups once combined
+            if (exp.isValid())
             {
-                if (!match(item->title(), tmp))
-                {
-                    found_match = false;
-                    break;
-                }
-                else
-                    found_match = true;
+                sources.append(source);
+                if (reg_exp && source.contains(back_reference))
+                    combine = false;
             }
-            else if (match(item->title(), tmp))
+        }
+
+        if (combine && exps.count() > 1)
+        {
+            exps.clear();
+            if (!sources.isEmpty())
+                exps.append(QRegularExpression(QStringLiteral("(?:") + sources.join(QStringLiteral(")|(?:")) + QStringLiteral(")"), options));
+        }
+
+        for (QRegularExpression& exp : exps)
+            exp.optimize();
+
+        return exps;
+    }
+
+    static bool MatchAll(const QList<QRegularExpression>& exps, const QString& title)
+    {
+        for (const QRegularExpression& exp : exps)
+        {
+            if (!exp.match(title).hasMatch())
                 return false;
         }
+        return true;
+    }
+
+    static bool MatchAny(const QList<QRegularExpression>& exps, const QString& title)
+    {
+        for (const QRegularExpression& exp : exps)
+        {
+            if (exp.match(title).hasMatch())
+                return true;
+        }
+        return false;
+    }
+
+    void Filter::compile()
+    {
+        word_exps = CompilePatterns(word_matches, use_regular_expressions, case_sensitive, !all_word_matches_must_match);
+        exclusion_exps = CompilePatterns(exclusion_patterns, exclusion_reg_exp, exclusion_case_sensitive, !exclusion_all_must_match);
+        compiled = true;
+    }
+
+    bool Filter::match(Syndication::ItemPtr item)
+    {
+        return match(FilterTitle(item->title()));
+    }
+
+    bool Filter::match(const FilterTitle& title)
+    {
+        if (!compiled)
+            compile();
+
+        const QString& text = title.text();
+        if (word_matches.isEmpty())
+            return false;
 
-        if (found_match)
+        if (all_word_matches_must_match ? !MatchAll(word_exps, text) : !MatchAny(word_exps, text))
             return false;
 
+        if (!exclusion_exps.isEmpty())
+        {
+            if (exclusion_all_must_match ? MatchAll(exclusion_exps, text) : MatchAny(exclusion_exps, text))
+                return false;
+        }
+
         if (use_season_and_episode_matching)
         {
             int season = 0;
             int episode = 0;
-            if (!getSeasonAndEpisode(item->title(), season, episode))
+            if (!title.seasonAndEpisode(season, episode))
                 return false;
 
             bool found = false;
@@ -212,21 +344,25 @@ namespace kt
     void Filter::addWordMatch(const QRegExp& exp)
     {
         word_matches.append(exp);
+        compiled = false;
     }
 
     void Filter::removeWordMatch(const QRegExp& exp)
     {
         word_matches.removeAll(exp);
+        compiled = false;
     }
 
     void Filter::addExclusionPattern(const QRegExp& exp)
     {
         exclusion_patterns.append(exp);
+        compiled = false;
     }
 
     void Filter::removeExclusionPattern(const QRegExp& exp)
     {
         exclusion_patterns.removeAll(exp);
+        compiled = false;
     }
 
     bool Filter::stringToRange(const QString& s, Range& r)
@@ -349,6 +485,7 @@ namespace kt
 
     bool Filter::load(bt::BDictNode* dict)
     {
+        compiled = false;
         QTextCodec* codec = QTextCodec::codecForName("UTF-8");
         BValueNode* vn = dict->getValue("name");
         if (!vn)
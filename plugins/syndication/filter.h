@@ -24,6 +24,7 @@
 
 #include <QList>
 #include <QRegExp>
+#include <QRegularExpression>
 #include <Syndication/Item>
 
 namespace bt
@@ -34,6 +35,33 @@ namespace bt
 
 namespace kt
 {
+    /**
+        Title of a feed item, prepared for matching against a number of filters.
+        The season and episode are only extracted once, the first time a filter asks for them.
+    */
+    class FilterTitle
+    {
+    public:
+        explicit FilterTitle(const QString& title);
+
+        /// Get the title
+        const QString& text() const {return title;}
+
+        /**
+         * Get the season and episode of the title
+         * @param season Set to the season
+         * @param episode Set to the episode
+         * @return true if the title contains a season and episode
+         */
+        bool seasonAndEpisode(int& season, int& episode) const;
+
+    private:
+        QString title;
+        mutable bool se_parsed;
+        mutable bool se_found;
+        mutable int season;
+        mutable int episode;
+    };
 
 
     /**
@@ -68,6 +96,13 @@ namespace kt
          */
         bool match(Syndication::ItemPtr item);
 
+        /**
+         * Check if a title matches the filter, use this when matching one title against a lot of filters
+         * @param title The title
+         * @return true If a match is found, false otherwise
+         */
+        bool match(const FilterTitle& title);
+
         /// Add a word match
         void addWordMatch(const QRegExp& exp);
 
@@ -87,10 +122,10 @@ namespace kt
         QList<QRegExp> exclusionPatterns() const {return exclusion_patterns;}
 
         /// Clear the list of word matches
-        void clearWordMatches() {word_matches.clear();}
+        void clearWordMatches() {word_matches.clear(); compiled = false;}
 
         /// Clear the list of word matches
-        void clearExclusionPatterns() {exclusion_patterns.clear();}
+        void clearExclusionPatterns() {exclusion_patterns.clear(); compiled = false;}
 
         /// Is season and episode matching enabled
         bool useSeasonAndEpisodeMatching() const {return use_season_and_episode_matching;}
@@ -164,25 +199,25 @@ namespace kt
         bool caseSensitive() const {return case_sensitive;}
 
         /// Set case sensitivity of word matches
-        void setCaseSensitive(bool on) {case_sensitive = on;}
+        void setCaseSensitive(bool on) {case_sensitive = on; compiled = false;}
 
         /// Return whether or not all word matches must match
         bool allWordMatchesMustMatch() const {return all_word_matches_must_match;}
 
         /// Set whether or not all word matches must match
-        void setAllWordMatchesMustMatch(bool on) {all_word_matches_must_match = on;}
+        void setAllWordMatchesMustMatch(bool on) {all_word_matches_must_match = on; compiled = false;}
 
         /// Are the word matches case sensitive
         bool exclusionCaseSensitive() const {return exclusion_case_sensitive;}
 
         /// Set case sensitivity of word matches
-        void setExclusionCaseSensitive(bool on) {exclusion_case_sensitive = on;}
+        void setExclusionCaseSensitive(bool on) {exclusion_case_sensitive = on; compiled = false;}
 
         /// Return whether or not all word matches must match
         bool exclusionAllMustMatch() const {return exclusion_all_must_match;}
 
         /// Set whether or not all word matches must match
-        void setExclusionAllMustMatch(bool on) {exclusion_all_must_match = on;}
+        void setExclusionAllMustMatch(bool on) {exclusion_all_must_match = on; compiled = false;}
 
         /// Save the filter
         void save(bt::BEncoder& enc);
@@ -194,13 +229,13 @@ namespace kt
         bool useRegularExpressions() const {return use_regular_expressions;}
 
         /// Enable or disable regular expressions
-        void setUseRegularExpressions(bool on) {use_regular_expressions = on;}
+        void setUseRegularExpressions(bool on) {use_regular_expressions = on; compiled = false;}
 
         /// Whether or not the string matches are regular expressions
         bool exclusionUseRegularExpressions() const {return exclusion_reg_exp;}
 
         /// Enable or disable regular expressions
-        void setExclusionUseRegularExpressions(bool on) {exclusion_reg_exp = on;}
+        void setExclusionUseRegularExpressions(bool on) {exclusion_reg_exp = on; compiled = false;}
 
         /// Is a string a valid seasons or episode string
         static bool validSeasonOrEpisodeString(const QString& s);
@@ -228,7 +263,7 @@ namespace kt
         static bool parseNumbersString(const QString& s, QList<Range> & numbers);
         static bool stringToRange(const QString& s, Range& r);
 
-        bool match(const QString& title, QRegExp& exp);
+        void compile();
 
     private:
         QString id;
@@ -254,6 +289,11 @@ namespace kt
         bool exclusion_all_must_match;
         bool exclusion_reg_exp;
 
+        // Compiled versions of word_matches and exclusion_patterns, rebuilt when they or their options change
+        bool compiled;
+        QList<QRegularExpression> word_exps;
+        QList<QRegularExpression> exclusion_exps;
+
         QList<MatchedSeasonAndEpisode> se_matches;
     };
 
@@ -316,16 +316,16 @@ namespace kt
         updated();
     }
 
-    bool Feed::needToDownload(Syndication::ItemPtr item, Filter* filter)
+    bool Feed::needToDownload(const FilterTitle& title, Filter* filter)
     {
-        bool m = filter->match(item);
+        bool m = filter->match(title);
         if ((m && filter->downloadMatching()) || (!m && filter->downloadNonMatching()))
         {
             if (filter->useSeasonAndEpisodeMatching() && filter->noDuplicateSeasonAndEpisodeMatches())
             {
                 int s = 0;
                 int e = 0;
-                Filter::getSeasonAndEpisode(item->title(), s, e);
+                title.seasonAndEpisode(s, e);
                 if (!downloaded_se_items.contains(filter))
                 {
                     downloaded_se_items[filter].append(SeasonEpisodeItem(s, e));
@@ -354,20 +354,26 @@ namespace kt
             return;
 
         Out(SYS_SYN | LOG_NOTICE) << "Running filters on " << feed->title() << endl;
-        foreach (Filter* f, filters)
-        {
+        for (Filter* f : qAsConst(filters))
             f->startMatching();
-            const QList<Syndication::ItemPtr> items = feed->items();
-            for (Syndication::ItemPtr item : items)
-            {
-                // Skip already loaded items
-                if (loaded.contains(item->id()))
-                    continue;
 
-                if (needToDownload(item, f))
+        // Prepare each title once and run it through all filters, the first filter
+        // which wants the item downloads it
+        const QList<Syndication::ItemPtr> items = feed->items();
+        for (Syndication::ItemPtr item : items)
+        {
+            // Skip already loaded items
+            if (loaded.contains(item->id()))
+                continue;
+
+            FilterTitle title(item->title());
+            for (Filter* f : qAsConst(filters))
+            {
+                if (needToDownload(title, f))
                 {
                     Out(SYS_SYN | LOG_NOTICE) << "Downloading item " << item->title() << " (filter: " << f->filterName() << ")" << endl;
                     downloadItem(item, f->group(), f->downloadLocation(), f->moveOnCompletionLocation(), f->openSilently());
+                    break;
                 }
             }
         }
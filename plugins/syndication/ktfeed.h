@@ -36,6 +36,7 @@ namespace kt
 {
     class Filter;
     class FilterList;
+    class FilterTitle;
 
     struct SeasonEpisodeItem
     {
@@ -166,7 +167,7 @@ namespace kt
         void updated();
 
     private:
-        bool needToDownload(Syndication::ItemPtr item, Filter* filter);
+        bool needToDownload(const FilterTitle& title, Filter* filter);
         void checkLoaded();
         void loadFromDisk();
         void parseUrl(const QString& feed_url);
@@ -0,0 +1,514 @@
+/***************************************************************************
+ *   Copyright (C) 2012 by                                                 *
+ *   Joris Guisson <joris.guisson@gmail.com>                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include <QtTest>
+#include <QFile>
+#include <QTextStream>
+#include <random>
+#include <util/log.h>
+#include "../filter.h"
+
+namespace
+{
+    const int NUM_FILTERS = 500;
+    const int NUM_TITLES = 2000;
+
+    /// Random number in [0, max)
+    int bounded(std::mt19937& rnd, int max)
+    {
+        return std::uniform_int_distribution<int>(0, max - 1)(rnd);
+    }
+
+    const char* shows[] =
+    {
+        "The Big Bang Theory", "Doctor Who", "Game of Thrones", "The Walking Dead", "Breaking Bad",
+        "Top Gear", "Mythbusters", "How I Met Your Mother", "Modern Family", "Sherlock",
+        "The Simpsons", "Family Guy", "South Park", "Dexter", "House", "Lost", "Fringe",
+        "Castle", "Bones", "The Office", "Parks and Recreation", "Community", "Archer",
+        "Futurama", "Supernatural", "Grey's Anatomy", "NCIS", "The Good Wife", "Homeland",
+        "Mad Men", "Boardwalk Empire", "True Blood", "Weeds", "Californication", "Glee",
+        "Chuck", "Heroes", "Eureka", "Warehouse 13", "Stargate Universe"
+    };
+
+    const char* qualities[] = {"HDTV", "720p.HDTV", "1080p.WEB-DL", "PDTV", "WEBRip", "BluRay.1080p"};
+    const char* groups[] = {"LOL", "DIMENSION", "KILLERS", "ASAP", "FQM", "2HD", "IMMERSE", "EVOLVE"};
+}
+
+class FilterTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QString randomItem(std::mt19937& rnd, const char** list, int count)
+    {
+        return QString::fromLatin1(list[bounded(rnd, count)]);
+    }
+
+    // A feed corpus can be passed in the KT_FEED_CORPUS environment variable, one title per line,
+    // otherwise titles in the formats commonly found in feeds are generated
+    QStringList corpus()
+    {
+        QStringList titles;
+        QByteArray corpus_file = qgetenv("KT_FEED_CORPUS");
+        if (!corpus_file.isEmpty())
+        {
+            QFile fptr(QString::fromLocal8Bit(corpus_file));
+            if (fptr.open(QIODevice::ReadOnly))
+            {
+                QTextStream in(&fptr);
+                while (!in.atEnd())
+                {
+                    QString line = in.readLine().trimmed();
+                    if (!line.isEmpty())
+                        titles.append(line);
+                }
+                return titles;
+            }
+        }
+
+        std::mt19937 rnd(42);
+        const int num_shows = sizeof(shows) / sizeof(shows[0]);
+        const int num_qualities = sizeof(qualities) / sizeof(qualities[0]);
+        const int num_groups = sizeof(groups) / sizeof(groups[0]);
+        for (int i = 0; i < NUM_TITLES; i++)
+        {
+            QString show = randomItem(rnd, shows, num_shows);
+            int season = bounded(rnd, 12) + 1;
+            int episode = bounded(rnd, 24) + 1;
+            switch (bounded(rnd, 4))
+            {
+            case 0:
+                titles.append(QStringLiteral("%1.S%2E%3.%4.x264-%5")
+                              .arg(QString(show).replace(QLatin1Char(' '), QLatin1Char('.')))
+                              .arg(season, 2, 10, QLatin1Char('0'))
+                              .arg(episode, 2, 10, QLatin1Char('0'))
+                              .arg(randomItem(rnd, qualities, num_qualities))
+                              .arg(randomItem(rnd, groups, num_groups)));
+                break;
+            case 1:
+                titles.append(QStringLiteral("%1 %2x%3 [%4]")
+                              .arg(show).arg(season).arg(episode, 2, 10, QLatin1Char('0'))
+                              .arg(randomItem(rnd, qualities, num_qualities)));
+                break;
+            case 2:
+                titles.append(QStringLiteral("[%1] %2 - %3 (%4)")
+                              .arg(randomItem(rnd, groups, num_groups)).arg(show).arg(episode)
+                              .arg(randomItem(rnd, qualities, num_qualities)));
+                break;
+            default:
+                titles.append(QStringLiteral("%1 Season %2 Complete").arg(show).arg(season));
+                break;
+            }
+        }
+        return titles;
+    }
+
+    QList<kt::Filter*> filters()
+    {
+        std::mt19937 rnd(7);
+        QList<kt::Filter*> ret;
+        const int num_shows = sizeof(shows) / sizeof(shows[0]);
+        const int num_qualities = sizeof(qualities) / sizeof(qualities[0]);
+        for (int i = 0; i < NUM_FILTERS; i++)
+        {
+            kt::Filter* f = new kt::Filter(QStringLiteral("filter%1").arg(i));
+            QStringList words = randomItem(rnd, shows, num_shows).split(QLatin1Char(' '));
+            if (i % 3 == 0)
+            {
+                f->setUseRegularExpressions(true);
+                f->addWordMatch(QRegExp(words.join(QStringLiteral("[ ._]"))));
+            }
+            else if (i % 3 == 1)
+            {
+                f->addWordMatch(QRegExp(QStringLiteral("*%1*").arg(words.join(QStringLiteral("?")))));
+                f->addWordMatch(QRegExp(QStringLiteral("*%1*").arg(randomItem(rnd, shows, num_shows))));
+            }
+            else
+            {
+                f->setAllWordMatchesMustMatch(true);
+                for (const QString& w : qAsConst(words))
+                    f->addWordMatch(QRegExp(QStringLiteral("*%1*").arg(w)));
+            }
+
+            if (i % 2 == 0)
+                f->addExclusionPattern(QRegExp(QStringLiteral("*%1*").arg(randomItem(rnd, qualities, num_qualities))));
+
+            if (i % 4 == 0)
+            {
+                f->setSeasonAndEpisodeMatching(true);
+                f->setSeasons(QStringLiteral("1-6"));
+                f->setEpisodes(QStringLiteral("1-12,20"));
+            }
+            ret.append(f);
+        }
+        return ret;
+    }
+
+    // The way patterns used to be matched, a QRegExp per pattern set up for each title
+    static bool referenceMatch(const QString& title, const QList<QRegExp>& patterns, bool reg_exp, bool case_sensitive, bool all)
+    {
+        bool found = false;
+        for (const QRegExp& exp : patterns)
+        {
+            QRegExp tmp = exp;
+            tmp.setCaseSensitivity(case_sensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+            tmp.setPatternSyntax(reg_exp ? QRegExp::RegExp : QRegExp::Wildcard);
+            if (tmp.indexIn(title) != -1)
+            {
+                found = true;
+                if (!all)
+                    break;
+            }
+            else if (all)
+            {
+                return false;
+            }
+        }
+        return found;
+    }
+
+    static bool referenceMatch(kt::Filter* f, const QString& title)
+    {
+        if (!referenceMatch(title, f->wordMatches(), f->useRegularExpressions(), f->caseSensitive(), f->allWordMatchesMustMatch()))
+            return false;
+
+        return !referenceMatch(title, f->exclusionPatterns(), f->exclusionUseRegularExpressions(), f->exclusionCaseSensitive(), f->exclusionAllMustMatch());
+    }
+
+    static bool referenceSeasonAndEpisode(const QString& title, int& season, int& episode)
+    {
+        QStringList se_formats;
+        se_formats << QStringLiteral("(\\d+)x(\\d+)")
+                   << QStringLiteral("S(\\d+)E(\\d+)")
+                   << QStringLiteral("(\\d+)\\.(\\d+)")
+                   << QStringLiteral("S(\\d+)\\.E(\\d+)");
+
+        for (const QString& format : qAsConst(se_formats))
+        {
+            QRegExp exp(format, Qt::CaseInsensitive);
+            if (exp.indexIn(title) > -1)
+            {
+                bool ok = false;
+                season = exp.cap(1).toInt(&ok);
+                if (!ok)
+                    continue;
+
+                episode = exp.cap(2).toInt(&ok);
+                if (!ok)
+                    continue;
+
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool referenceInRanges(int value, const QString& ranges)
+    {
+        const QStringList parts = ranges.split(QLatin1Char(','));
+        for (const QString& part : parts)
+        {
+            int start = part.section(QLatin1Char('-'), 0, 0).toInt();
+            int end = part.contains(QLatin1Char('-')) ? part.section(QLatin1Char('-'), 1, 1).toInt() : start;
+            if (value >= start && value <= end)
+                return true;
+        }
+        return false;
+    }
+
+    // The complete old matching, including the season and episode check and the duplicate check
+    static bool referenceMatch(kt::Filter* f, const QString& title, QSet<QPair<int, int> >& se_matches)
+    {
+        if (!referenceMatch(f, title))
+            return false;
+
+        if (!f->useSeasonAndEpisodeMatching())
+            return true;
+
+        int season = 0, episode = 0;
+        if (!referenceSeasonAndEpisode(title, season, episode))
+            return false;
+
+        if (!referenceInRanges(season, f->seasonsToString()) || !referenceInRanges(episode, f->episodesToString()))
+            return false;
+
+        if (f->noDuplicateSeasonAndEpisodeMatches())
+        {
+            QPair<int, int> se(season, episode);
+            if (se_matches.contains(se))
+                return false;
+
+            se_matches.insert(se);
+        }
+        return true;
+    }
+
+    // Number of matches of all filters over all titles with the compiled filters, one title at a time
+    static int compiledHits(const QList<kt::Filter*>& fl, const QStringList& titles)
+    {
+        for (kt::Filter* f : fl)
+            f->startMatching();
+
+        int hits = 0;
+        for (const QString& t : titles)
+        {
+            kt::FilterTitle title(t);
+            for (kt::Filter* f : fl)
+                hits += f->match(title) ? 1 : 0;
+        }
+        return hits;
+    }
+
+    // The same with the old matching
+    static int referenceHits(const QList<kt::Filter*>& fl, const QStringList& titles)
+    {
+        QVector<QSet<QPair<int, int> > > se_matches(fl.count());
+        int hits = 0;
+        for (const QString& title : titles)
+        {
+            for (int i = 0; i < fl.count(); i++)
+                hits += referenceMatch(fl.at(i), title, se_matches[i]) ? 1 : 0;
+        }
+        return hits;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        bt::InitLog(QStringLiteral("filtertest.log"), false, true);
+    }
+
+    void cleanupTestCase()
+    {
+    }
+
+    void testPatterns()
+    {
+        QStringList titles;
+        titles << QStringLiteral("The.Big.Bang.Theory.S05E12.720p.HDTV.x264-LOL")
+               << QStringLiteral("the big bang theory 5x12")
+               << QStringLiteral("Doctor Who [2005] 7x01")
+               << QStringLiteral("Star*Trek? Enterprise")
+               << QStringLiteral("Back\\slash Show 1.2")
+               << QStringLiteral("");
+
+        QStringList patterns;
+        patterns << QStringLiteral("*big*bang*")
+                 << QStringLiteral("*Big Bang*")
+                 << QStringLiteral("the?big")
+                 << QStringLiteral("*[2005]*")
+                 << QStringLiteral("*[!a-z]x01")
+                 << QStringLiteral("*[0-9]x*")
+                 << QStringLiteral("*Star*Trek*")
+                 << QStringLiteral("*\\slash*")
+                 << QStringLiteral("*(*")
+                 << QStringLiteral("[unclosed")
+                 << QStringLiteral("");
+
+        QStringList reg_exps;
+        reg_exps << QStringLiteral("big.bang")
+                 << QStringLiteral("^Doctor\\s+Who")
+                 << QStringLiteral("S\\d+E\\d+")
+                 << QStringLiteral("(a)\\1")
+                 << QStringLiteral("invalid(")
+                 << QStringLiteral("(?:Star|Trek)\\*");
+
+        for (int options = 0; options < 8; options++)
+        {
+            bool case_sensitive = options & 1;
+            bool all = options & 2;
+            bool exclusion = options & 4;
+
+            // Single patterns and pairs of patterns
+            for (int i = 0; i < patterns.count() + reg_exps.count(); i++)
+            {
+                for (int j = i; j < patterns.count() + reg_exps.count(); j++)
+                {
+                    bool reg_exp = i >= patterns.count();
+                    if (reg_exp != (j >= patterns.count()))
+                        continue;
+
+                    const QStringList& list = reg_exp ? reg_exps : patterns;
+                    int offset = reg_exp ? patterns.count() : 0;
+
+                    kt::Filter f;
+                    f.setUseRegularExpressions(reg_exp);
+                    f.setCaseSensitive(case_sensitive);
+                    f.setAllWordMatchesMustMatch(all);
+                    if (exclusion)
+                    {
+                        f.addWordMatch(QRegExp(QStringLiteral("*")));
+                        f.setExclusionUseRegularExpressions(reg_exp);
+                        f.setExclusionCaseSensitive(case_sensitive);
+                        f.setExclusionAllMustMatch(all);
+                        f.addExclusionPattern(QRegExp(list.at(i - offset)));
+                        if (j != i)
+                            f.addExclusionPattern(QRegExp(list.at(j - offset)));
+                    }
+                    else
+                    {
+                        f.addWordMatch(QRegExp(list.at(i - offset)));
+                        if (j != i)
+                            f.addWordMatch(QRegExp(list.at(j - offset)));
+                    }
+
+                    for (const QString& title : qAsConst(titles))
+                    {
+                        bool expected = referenceMatch(&f, title);
+                        if (f.match(kt::FilterTitle(title)) != expected)
+                        {
+                            QString msg = QStringLiteral("patterns %1 and %2, options %3, title %4")
+                                          .arg(list.at(i - offset), list.at(j - offset)).arg(options).arg(title);
+                            QFAIL(msg.toLocal8Bit().constData());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void testRecompile()
+    {
+        kt::Filter f;
+        f.addWordMatch(QRegExp(QStringLiteral("*Sherlock*")));
+        QVERIFY(f.match(kt::FilterTitle(QStringLiteral("sherlock 2x01"))));
+
+        f.setCaseSensitive(true);
+        QVERIFY(!f.match(kt::FilterTitle(QStringLiteral("sherlock 2x01"))));
+
+        f.addExclusionPattern(QRegExp(QStringLiteral("*2x*")));
+        QVERIFY(!f.match(kt::FilterTitle(QStringLiteral("Sherlock 2x01"))));
+        QVERIFY(f.match(kt::FilterTitle(QStringLiteral("Sherlock 3x01"))));
+
+        f.clearExclusionPatterns();
+        QVERIFY(f.match(kt::FilterTitle(QStringLiteral("Sherlock 2x01"))));
+
+        f.clearWordMatches();
+        QVERIFY(!f.match(kt::FilterTitle(QStringLiteral("Sherlock 2x01"))));
+    }
+
+    void testSeasonAndEpisode()
+    {
+        QStringList titles = corpus();
+        titles << QStringLiteral("Show 2.0 S01E05")
+               << QStringLiteral("Show 1.2x3")
+               << QStringLiteral("Show S01.E02")
+               << QStringLiteral("Show s3e4")
+               << QStringLiteral("Show 99999999999x1 2x3")
+               << QStringLiteral("Show 1")
+               << QStringLiteral("No numbers");
+
+        for (const QString& title : qAsConst(titles))
+        {
+            int season = 0, episode = 0;
+            int ref_season = 0, ref_episode = 0;
+            bool found = kt::Filter::getSeasonAndEpisode(title, season, episode);
+            QCOMPARE(found, referenceSeasonAndEpisode(title, ref_season, ref_episode));
+            if (found)
+            {
+                QCOMPARE(season, ref_season);
+                QCOMPARE(episode, ref_episode);
+            }
+        }
+    }
+
+    void testCorpus()
+    {
+        const QStringList titles = corpus();
+        const QList<kt::Filter*> fl = filters();
+        int hits = 0;
+        int se_hits = 0;
+        for (kt::Filter* f : fl)
+        {
+            // match every title against the compiled filter and the old matching, in the same order,
+            // so the duplicate season and episode checks see the same history
+            QSet<QPair<int, int> > se_matches;
+            f->startMatching();
+            for (const QString& title : titles)
+            {
+                bool expected = referenceMatch(f, title, se_matches);
+                if (f->match(kt::FilterTitle(title)) != expected)
+                {
+                    QString msg = QStringLiteral("filter %1, title %2").arg(f->filterName(), title);
+                    QFAIL(msg.toLocal8Bit().constData());
+                }
+
+                if (expected)
+                {
+                    hits++;
+                    if (f->useSeasonAndEpisodeMatching())
+                        se_hits++;
+                }
+            }
+
+            // a new round of matching forgets the season and episode matches
+            if (f->useSeasonAndEpisodeMatching() && !se_matches.isEmpty())
+            {
+                se_matches.clear();
+                f->startMatching();
+                for (const QString& title : titles)
+                    QCOMPARE(f->match(kt::FilterTitle(title)), referenceMatch(f, title, se_matches));
+            }
+        }
+
+        // the generated corpus has to exercise both outcomes of each kind of filter
+        if (qgetenv("KT_FEED_CORPUS").isEmpty())
+        {
+            QVERIFY(hits > 0);
+            QVERIFY(hits < titles.count() * fl.count());
+            QVERIFY(se_hits > 0);
+        }
+        qDeleteAll(fl);
+    }
+
+    // The benchmarks use the KT_FEED_CORPUS titles when given, testCorpus checks that both give the same results
+    void benchmarkMatch()
+    {
+        const QStringList titles = corpus();
+        const QList<kt::Filter*> fl = filters();
+        const int expected = referenceHits(fl, titles);
+
+        int hits = 0;
+        QBENCHMARK
+        {
+            hits = compiledHits(fl, titles);
+        }
+        QCOMPARE(hits, expected);
+        qDeleteAll(fl);
+    }
+
+    void benchmarkReferenceMatch()
+    {
+        const QStringList titles = corpus();
+        const QList<kt::Filter*> fl = filters();
+        const int expected = compiledHits(fl, titles);
+
+        int hits = 0;
+        QBENCHMARK
+        {
+            hits = referenceHits(fl, titles);
+        }
+        QCOMPARE(hits, expected);
+        qDeleteAll(fl);
+    }
+};
+
+QTEST_MAIN(FilterTest)
+
+#include "filtertest.moc"
@@ -161,14 +161,11 @@ namespace kt
         }
         else if (cmd == "remove")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(arg.toInt());
+            if (tc)
             {
-                if (arg.toInt() == k)
-                {
-                    core->remove((*i), false);
-                    return true;
-                }
+                core->remove(tc, false);
+                return true;
             }
         }
         else if (cmd == "stopall" && !arg.isEmpty())
@@ -183,26 +180,20 @@ namespace kt
         }
         else if (cmd == "stop")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(arg.toInt());
+            if (tc)
             {
-                if (arg.toInt() == k)
-                {
-                    core->stop(*i);
-                    return true;
-                }
+                core->stop(tc);
+                return true;
             }
         }
         else if (cmd == "start")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(arg.toInt());
+            if (tc)
             {
-                if (arg.toInt() == k)
-                {
-                    core->start(*i);
-                    return true;
-                }
+                core->start(tc);
+                return true;
             }
         }
         else if (cmd.startsWith("file_"))
@@ -291,54 +282,42 @@ namespace kt
 
         if (cmd == "file_lp")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(torrent_num.toInt());
+            if (tc)
             {
-                if (torrent_num.toInt() == k)
-                {
-                    TorrentFileInterface& file = (*i)->getTorrentFile(file_num.toInt());
-                    file.setPriority(LAST_PRIORITY);
-                    return true;
-                }
+                TorrentFileInterface& file = tc->getTorrentFile(file_num.toInt());
+                file.setPriority(LAST_PRIORITY);
+                return true;
             }
         }
         else if (cmd == "file_np")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(torrent_num.toInt());
+            if (tc)
             {
-                if (torrent_num.toInt() == k)
-                {
-                    TorrentFileInterface& file = (*i)->getTorrentFile(file_num.toInt());
-                    file.setPriority(NORMAL_PRIORITY);
-                    return true;
-                }
+                TorrentFileInterface& file = tc->getTorrentFile(file_num.toInt());
+                file.setPriority(NORMAL_PRIORITY);
+                return true;
             }
         }
         else if (cmd == "file_hp")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(torrent_num.toInt());
+            if (tc)
             {
-                if (torrent_num.toInt() == k)
-                {
-                    TorrentFileInterface& file = (*i)->getTorrentFile(file_num.toInt());
-                    file.setPriority(FIRST_PRIORITY);
-                    return true;
-                }
+                TorrentFileInterface& file = tc->getTorrentFile(file_num.toInt());
+                file.setPriority(FIRST_PRIORITY);
+                return true;
             }
         }
         else if (cmd == "file_stop")
         {
-            QList<TorrentInterface*>::iterator i = core->getQueueManager()->begin();
-            for (int k = 0; i != core->getQueueManager()->end(); i++, k++)
+            TorrentInterface* tc = core->getQueueManager()->getTorrent(torrent_num.toInt());
+            if (tc)
             {
-                if (torrent_num.toInt() == k)
-                {
-                    TorrentFileInterface& file = (*i)->getTorrentFile(file_num.toInt());
-                    file.setPriority(ONLY_SEED_PRIORITY);
-                    return true;
-                }
+                TorrentFileInterface& file = tc->getTorrentFile(file_num.toInt());
+                file.setPriority(ONLY_SEED_PRIORITY);
+                return true;
             }
         }
 
@@ -18,15 +18,24 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
  ***************************************************************************/
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <QtGlobal>
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#endif
+
 #include <QSocketNotifier>
 #include <qhttp.h>
 
 #include <util/log.h>
-#include <util/mmapfile.h>
 #include <klocalizedstring.h>
 #include "httpserver.h"
 #include "httpclienthandler.h"
 #include "httpresponseheader.h"
+#include "staticfile.h"
 
 
 using namespace bt;
@@ -48,11 +57,14 @@ namespace kt
         data.reserve(1024);
         output_buffer.reserve(4096);
         written = 0;
+        file_fd = -1;
+        file_offset = file_end = 0;
     }
 
 
     HttpClientHandler::~HttpClientHandler()
     {
+        finishFile();
         delete client;
     }
 
@@ -151,34 +163,148 @@ namespace kt
     bool HttpClientHandler::sendFile(HttpResponseHeader& hdr, const QString& full_path)
     {
         //  Out(SYS_WEB|LOG_DEBUG) << "Sending file " << full_path << endl;
+        StaticFile* f = srv->staticFile(full_path);
+        if (!f)
+            return false;
+
+        sendFile(hdr, f, false);
+        return true;
+    }
+
+    void HttpClientHandler::sendFile(HttpResponseHeader& hdr, StaticFile* f, bool gzip)
+    {
         setResponseHeaders(hdr);
-        // first look in cache
-        MMapFile* c = srv->cacheLookup(full_path);
+        QByteArray head = hdr.toByteArray(f->headerFields(gzip));
+        const QByteArray& contents = f->contents(gzip);
+        bool idle = output_buffer.isEmpty() && file_fd < 0;
+        Uint64 size = f->size(gzip);
 
-        if (!c)
+        if (!idle || (size > 0 && contents.isEmpty() && !sendFileSupported()))
         {
-            // not in cache so load it
-            c = new MMapFile();
-            if (!c->open(full_path, QIODevice::ReadOnly))
+            // Something else is still being sent (or there is no sendfile), so this goes into the buffer
+            queueOutput(head);
+            if (!contents.isEmpty() || size == 0)
             {
-                delete c;
-                Out(SYS_WEB | LOG_DEBUG) << "Failed to open file " << full_path << endl;
-                return false;
+                queueOutput(contents);
             }
-            srv->insertIntoCache(full_path, c);
+            else
+            {
+                QByteArray tmp(size, 0);
+                if (pread(f->descriptor(gzip), tmp.data(), size, 0) != (ssize_t)size)
+                {
+                    Out(SYS_WEB | LOG_DEBUG) << "Failed to read file" << endl;
+                    closed();
+                    return;
+                }
+                queueOutput(tmp);
+            }
+
+            if (idle)
+                sendOutputBuffer();
         }
+        else if (!contents.isEmpty() || size == 0)
+        {
+            // Small file in memory, send header and contents with one call
+            struct iovec iov[2];
+            iov[0].iov_base = (void*)head.constData();
+            iov[0].iov_len = head.size();
+            iov[1].iov_base = (void*)contents.constData();
+            iov[1].iov_len = contents.size();
+            ssize_t r = ::writev(client->fd(), iov, 2);
+            if (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                closed();
+                return;
+            }
 
-        //  Out(SYS_WEB|LOG_DEBUG) << "HTTP header : " << endl;
-        //  Out(SYS_WEB|LOG_DEBUG) << hdr.toString() << endl;
+            // queue what was not sent
+            Uint64 sent = r < 0 ? 0 : r;
+            if (sent < (Uint64)head.size())
+            {
+                output_buffer.append(head.constData() + sent, head.size() - sent);
+                output_buffer.append(contents);
+            }
+            else
+            {
+                sent -= head.size();
+                output_buffer.append(contents.constData() + sent, contents.size() - sent);
+            }
+
+            if (output_buffer.isEmpty())
+                sendOutputBuffer(); // all sent, finish the response
+            else
+                write_notifier->setEnabled(true); // socket is full, send the rest later
+        }
+        else
+        {
+            // Large file, the header is sent first and the rest straight from the descriptor.
+            // That belongs to the cache, which might close it before we are done, so use a copy.
+            file_fd = ::fcntl(f->descriptor(gzip), F_DUPFD_CLOEXEC, 0);
+            if (file_fd < 0)
+            {
+                Out(SYS_WEB | LOG_DEBUG) << "Failed to duplicate file descriptor" << endl;
+                closed();
+                return;
+            }
 
-        QByteArray data((const char*)c->getDataPointer(), c->getSize());
-        hdr.setValue("Content-Length", QString::number(data.size()));
-        output_buffer.append(hdr.toString().toUtf8());
-        output_buffer.append(data);
+            output_buffer.append(head);
+            file_offset = 0;
+            file_end = size;
+            sendOutputBuffer();
+        }
+    }
 
-        sendOutputBuffer();
-        //  Out(SYS_WEB|LOG_DEBUG) << "Finished sending " << full_path << " (" << written << " bytes)" << endl;
+    bool HttpClientHandler::sendFileSupported()
+    {
+#ifdef Q_OS_LINUX
         return true;
+#else
+        return false;
+#endif
+    }
+
+    bool HttpClientHandler::sendFileData()
+    {
+#ifdef Q_OS_LINUX
+        while (file_offset < file_end)
+        {
+            off_t off = file_offset;
+            ssize_t r = ::sendfile(client->fd(), file_fd, &off, file_end - file_offset);
+            if (r < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return false;
+
+                return true;
+            }
+            else if (r == 0)
+                return false; // file got truncated
+
+            file_offset = off;
+        }
+
+        finishFile();
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void HttpClientHandler::finishFile()
+    {
+        if (file_fd >= 0)
+            ::close(file_fd);
+
+        file_fd = -1;
+        file_offset = file_end = 0;
+    }
+
+    void HttpClientHandler::queueOutput(const QByteArray& data)
+    {
+        if (file_fd >= 0)
+            pending_output.append(data);
+        else
+            output_buffer.append(data);
     }
 
 #define HTTP_404_ERROR "<html><head><title>404 Not Found</title></head><body>The requested file %1 was not found !</body></html>"
@@ -192,8 +318,8 @@ namespace kt
         QString data = QString(HTTP_404_ERROR).arg(path);
         hdr.setValue("Content-Length", QString::number(data.length()));
 
-        output_buffer.append(hdr.toString().toUtf8());
-        output_buffer.append(data.toUtf8());
+        queueOutput(hdr.toByteArray());
+        queueOutput(data.toUtf8());
         sendOutputBuffer();
     }
 
@@ -205,8 +331,8 @@ namespace kt
         QString data = QString(HTTP_500_ERROR).arg(err);
         hdr.setValue("Content-Length", QString::number(data.length()));
 
-        output_buffer.append(hdr.toString().toUtf8());
-        output_buffer.append(data.toUtf8());
+        queueOutput(hdr.toByteArray());
+        queueOutput(data.toUtf8());
         sendOutputBuffer();
     }
 
@@ -214,7 +340,7 @@ namespace kt
     {
         setResponseHeaders(hdr);
         //  Out(SYS_WEB|LOG_DEBUG) << "Sending response " << hdr.toString() << endl;
-        output_buffer.append(hdr.toString().toUtf8());
+        queueOutput(hdr.toByteArray());
         sendOutputBuffer();
     }
 
@@ -222,41 +348,67 @@ namespace kt
     {
         setResponseHeaders(hdr);
         hdr.setValue("Content-Length", QString::number(data.length()));
-        output_buffer.append(hdr.toString().toUtf8());
-        output_buffer.append(data);
+        queueOutput(hdr.toByteArray());
+        queueOutput(data);
         sendOutputBuffer();
     }
 
     void HttpClientHandler::sendOutputBuffer(int)
     {
-        int r = client->send((const Uint8*)output_buffer.data() + written, output_buffer.size() - written);
-        //Out(SYS_WEB|LOG_DEBUG) << "sendOutputBuffer : " << r << " " << written << " " << output_buffer.size() << endl;
-        if (r <= 0)
-        {
-            // error happened, close the connection
-            closed();
-        }
-        else
+        while (true)
         {
-            written += r;
-            if (written == (Uint32)output_buffer.size())
+            if (written < (Uint32)output_buffer.size())
             {
-                // everything sent
-                output_buffer.resize(0);
-                write_notifier->setEnabled(false);
-                written = 0;
-                if (shouldClose())
+                int r = client->send((const Uint8*)output_buffer.data() + written, output_buffer.size() - written);
+                //Out(SYS_WEB|LOG_DEBUG) << "sendOutputBuffer : " << r << " " << written << " " << output_buffer.size() << endl;
+                if (r <= 0)
                 {
-                    Out(SYS_WEB | LOG_DEBUG) << "closing HttpClientHandler" << endl;
-                    client->close();
+                    // error happened, close the connection
                     closed();
+                    return;
+                }
+
+                written += r;
+                if (written < (Uint32)output_buffer.size())
+                {
+                    // enable write_notifier, so we can send the rest later
+                    write_notifier->setEnabled(true);
+                    return;
                 }
             }
-            else
+
+            output_buffer.resize(0);
+            written = 0;
+            if (file_fd < 0)
+                break;
+
+            if (!sendFileData())
+            {
+                finishFile();
+                closed();
+                return;
+            }
+            else if (file_fd >= 0)
             {
-                // enable write_notifier, so we can send the rest later
+                // not everything could be sent, continue later
                 write_notifier->setEnabled(true);
+                return;
             }
+
+            // file done, now send what was queued behind it
+            if (pending_output.isEmpty())
+                break;
+
+            output_buffer.swap(pending_output);
+        }
+
+        // everything sent
+        write_notifier->setEnabled(false);
+        if (shouldClose())
+        {
+            Out(SYS_WEB | LOG_DEBUG) << "closing HttpClientHandler" << endl;
+            client->close();
+            closed();
         }
     }
 
@@ -31,6 +31,7 @@ class QSocketNotifier;
 namespace kt
 {
     class HttpServer;
+    class StaticFile;
 
     /**
         @author Joris Guisson <joris.guisson@gmail.com>
@@ -49,6 +50,7 @@ namespace kt
 
 
         bool sendFile(HttpResponseHeader& hdr, const QString& full_path);
+        void sendFile(HttpResponseHeader& hdr, StaticFile* file, bool gzip);
         void sendResponse(HttpResponseHeader& hdr);
         void send404(HttpResponseHeader& hdr, const QString& path);
         void send500(HttpResponseHeader& hdr, const QString& error);
@@ -58,6 +60,10 @@ namespace kt
     private:
         void handleRequest(int header_len);
         void setResponseHeaders(HttpResponseHeader& hdr);
+        void queueOutput(const QByteArray& data);
+        bool sendFileData();
+        static bool sendFileSupported();
+        void finishFile();
 
     private slots:
         void readyToRead(int);
@@ -78,6 +84,11 @@ namespace kt
         HttpResponseHeader php_response_hdr;
         QByteArray output_buffer;
         bt::Uint32 written;
+        // file which is being sent after output_buffer, output of later responses waits in pending_output
+        int file_fd;
+        bt::Uint64 file_offset;
+        bt::Uint64 file_end;
+        QByteArray pending_output;
     };
 
 }
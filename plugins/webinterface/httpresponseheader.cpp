@@ -76,6 +76,24 @@ namespace kt
         return str;
     }
 
+    QByteArray HttpResponseHeader::toByteArray(const QByteArray& extra_fields) const
+    {
+        QByteArray ret;
+        ret.reserve(256 + extra_fields.size());
+        ret += "HTTP/" + QByteArray::number(major_version) + "." + QByteArray::number(minor_version) + " ";
+        ret += QByteArray::number(response_code) + " " + ResponseCodeToString(response_code).toLatin1() + "\r\n";
+
+        QMap<QString, QString>::const_iterator itr = fields.begin();
+        while (itr != fields.end())
+        {
+            ret += itr.key().toLatin1() + ": " + itr.value().toUtf8() + "\r\n";
+            itr++;
+        }
+        ret += extra_fields;
+        ret += "\r\n";
+        return ret;
+    }
+
 
 
 }
@@ -21,6 +21,7 @@
 #ifndef KTHTTPRESPONSEHEADER_H
 #define KTHTTPRESPONSEHEADER_H
 
+#include <QByteArray>
 #include <QMap>
 #include <QString>
 
@@ -46,6 +47,13 @@ namespace kt
         void setValue(const QString& key, const QString& value);
 
         QString toString() const;
+
+        /**
+         * Serialise the header, with some extra preformatted fields.
+         * @param extra_fields Fields to add, each terminated by \r\n
+         * @return The header
+         */
+        QByteArray toByteArray(const QByteArray& extra_fields = QByteArray()) const;
     };
 
 
@@ -43,14 +43,15 @@
 #include <util/log.h>
 #include <util/fileops.h>
 #include <util/functions.h>
-#include <util/mmapfile.h>
 #include <util/sha1hash.h>
 #include "ktversion.h"
 #include "httpserver.h"
 #include "httpclienthandler.h"
 #include "httpresponseheader.h"
+#include "staticfile.h"
 #include "webinterfacepluginsettings.h"
 #include "torrentlistgenerator.h"
+#include "torrentjsongenerator.h"
 #include "challengegenerator.h"
 #include "loginhandler.h"
 #include "logouthandler.h"
@@ -70,11 +71,12 @@ namespace kt
     QString DataDir();
 
 
-    HttpServer::HttpServer(CoreInterface* core, bt::Uint16 port) : core(core), cache(10), port(port)
+    HttpServer::HttpServer(CoreInterface* core, bt::Uint16 port) : core(core), cache(50), port(port)
     {
         qsrand(time(0));
         content_generators.setAutoDelete(true);
         addContentGenerator(new TorrentListGenerator(core, this));
+        addContentGenerator(new TorrentJsonGenerator(core, this));
         addContentGenerator(new ChallengeGenerator(this));
         addContentGenerator(new LoginHandler(this));
         addContentGenerator(new LogoutHandler(this));
@@ -430,35 +432,48 @@ namespace kt
 
     void HttpServer::handleNormalFile(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr, const QString& path)
     {
-        QFileInfo fi(path);
-        QString ext = fi.suffix();
+        StaticFile* f = staticFile(path);
+        if (!f)
+        {
+            HttpResponseHeader nhdr(404, hdr.majorVersion(), hdr.minorVersion());
+            setDefaultResponseHeaders(nhdr, QStringLiteral("text/html"), false);
+            hdlr->send404(nhdr, path);
+            return;
+        }
+
+        bool gzip = f->hasGzipVariant() && hdr.hasKey(QStringLiteral("Accept-Encoding")) && hdr.value(QStringLiteral("Accept-Encoding")).contains(QLatin1String("gzip"));
 
-        if (hdr.hasKey("If-Modified-Since"))
+        // If-None-Match takes precedence over If-Modified-Since
+        bool not_modified = false;
+        if (hdr.hasKey(QStringLiteral("If-None-Match")))
         {
-            QDateTime dt = parseDate(hdr.value("If-Modified-Since"));
-            if (dt.isValid() && dt < fi.lastModified())
-            {
-                HttpResponseHeader rhdr(304, hdr.majorVersion(), hdr.minorVersion());
-                setDefaultResponseHeaders(rhdr, "text/html", true);
-                rhdr.setValue("Cache-Control", "max-age=0");
-                rhdr.setValue("Last-Modified", DateTimeToString(fi.lastModified(), false));
-                rhdr.setValue("Expires", DateTimeToString(QDateTime::currentDateTime().toUTC().addSecs(3600), false));
-                hdlr->sendResponse(rhdr);
-                return;
-            }
+            not_modified = f->matches(hdr.value(QStringLiteral("If-None-Match")), gzip);
+        }
+        else if (hdr.hasKey(QStringLiteral("If-Modified-Since")))
+        {
+            // parseDate returns the UTC time, without marking it as such
+            QDateTime dt = parseDate(hdr.value(QStringLiteral("If-Modified-Since")));
+            not_modified = dt.isValid() && QDateTime(dt.date(), dt.time(), Qt::UTC) >= f->lastModified().toUTC();
         }
 
-        HttpResponseHeader rhdr(200, hdr.majorVersion(), hdr.minorVersion());
-        setDefaultResponseHeaders(rhdr, ExtensionToContentType(ext), true);
-        rhdr.setValue("Last-Modified", DateTimeToString(fi.lastModified(), false));
-        rhdr.setValue("Expires", DateTimeToString(QDateTime::currentDateTime().toUTC().addSecs(3600), false));
-        rhdr.setValue("Cache-Control", "private");
-        if (!hdlr->sendFile(rhdr, path))
+        QString expires = DateTimeToString(QDateTime::currentDateTime().toUTC().addSecs(3600), false);
+        if (not_modified)
         {
-            HttpResponseHeader nhdr(404, hdr.majorVersion(), hdr.minorVersion());
-            setDefaultResponseHeaders(nhdr, "text/html", false);
-            hdlr->send404(nhdr, path);
+            HttpResponseHeader rhdr(304, hdr.majorVersion(), hdr.minorVersion());
+            setDefaultResponseHeaders(rhdr, QString(), true);
+            rhdr.setValue(QStringLiteral("Cache-Control"), QStringLiteral("max-age=0"));
+            rhdr.setValue(QStringLiteral("Last-Modified"), DateTimeToString(f->lastModified().toUTC(), false));
+            rhdr.setValue(QStringLiteral("ETag"), QString::fromLatin1(f->eTag(gzip)));
+            rhdr.setValue(QStringLiteral("Expires"), expires);
+            hdlr->sendResponse(rhdr);
+            return;
         }
+
+        HttpResponseHeader rhdr(200, hdr.majorVersion(), hdr.minorVersion());
+        setDefaultResponseHeaders(rhdr, ExtensionToContentType(QFileInfo(path).suffix()), true);
+        rhdr.setValue(QStringLiteral("Expires"), expires);
+        rhdr.setValue(QStringLiteral("Cache-Control"), QStringLiteral("private"));
+        hdlr->sendFile(rhdr, f, gzip);
     }
 
     void HttpServer::handlePost(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr, const QByteArray& data)
@@ -568,14 +583,41 @@ namespace kt
             return QDateTime();
     }
 
-    bt::MMapFile* HttpServer::cacheLookup(const QString& name)
+    StaticFile* HttpServer::staticFile(const QString& path)
     {
-        return cache.object(name);
-    }
+        StaticFile* f = cache.object(path);
+        if (f && !f->isStale())
+            return f;
 
-    void HttpServer::insertIntoCache(const QString& name, bt::MMapFile* file)
-    {
-        cache.insert(name, file);
+        f = new StaticFile();
+        if (!f->open(path))
+        {
+            delete f;
+            cache.remove(path);
+            Out(SYS_WEB | LOG_DEBUG) << "Failed to open file " << path << endl;
+            return 0;
+        }
+
+        // Serialise the fields which only depend on the file once
+        for (int i = 0; i < 2; i++)
+        {
+            bool gzip = i == 1;
+            if (gzip && !f->hasGzipVariant())
+                break;
+
+            QByteArray fields;
+            fields += "Content-Length: " + QByteArray::number(f->size(gzip)) + "\r\n";
+            fields += "Last-Modified: " + DateTimeToString(f->lastModified().toUTC(), false).toLatin1() + "\r\n";
+            fields += "ETag: " + f->eTag(gzip) + "\r\n";
+            if (f->hasGzipVariant())
+                fields += "Vary: Accept-Encoding\r\n";
+            if (gzip)
+                fields += "Content-Encoding: gzip\r\n";
+            f->setHeaderFields(gzip, fields);
+        }
+
+        cache.insert(path, f);
+        return f;
     }
 
     static char RandomLetterOrNumber()
@@ -29,11 +29,6 @@
 
 class QSocketNotifier;
 
-namespace bt
-{
-    class MMapFile;
-}
-
 namespace kt
 {
     class CoreInterface;
@@ -58,6 +53,7 @@ namespace kt
 
     class HttpClientHandler;
     class HttpResponseHeader;
+    class StaticFile;
 
 
 
@@ -74,8 +70,7 @@ namespace kt
         void handleGet(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr);
         void handlePost(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr, const QByteArray& data);
         void handleUnsupportedMethod(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr);
-        bt::MMapFile* cacheLookup(const QString& name);
-        void insertIntoCache(const QString& name, bt::MMapFile* file);
+        StaticFile* staticFile(const QString& path);
         QString challengeString();
         void addContentGenerator(WebContentGenerator* g);
         void setDefaultResponseHeaders(HttpResponseHeader& hdr, const QString& content_type, bool with_session_info);
@@ -101,7 +96,7 @@ namespace kt
         int sessionTTL;
         Session session;
         CoreInterface* core;
-        QCache<QString, bt::MMapFile> cache;
+        QCache<QString, StaticFile> cache;
         bt::Uint16 port;
         QStringList skin_list;
         QString challenge;
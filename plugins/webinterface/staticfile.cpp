@@ -0,0 +1,120 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QFile>
+#include <QStringList>
+
+#include "staticfile.h"
+
+using namespace bt;
+
+namespace kt
+{
+    /// Files up to this size are also kept in memory
+    const Uint64 MAX_CACHED_CONTENTS = 64 * 1024;
+
+    StaticFile::StaticFile() : fd(-1), gz_fd(-1), file_size(0), gz_size(0), mtime(0)
+    {
+    }
+
+    StaticFile::~StaticFile()
+    {
+        if (fd >= 0)
+            ::close(fd);
+        if (gz_fd >= 0)
+            ::close(gz_fd);
+    }
+
+    bool StaticFile::openVariant(const QByteArray& p, int& vfd, Uint64& vsize, QByteArray& vdata)
+    {
+        vfd = ::open(p.constData(), O_RDONLY | O_CLOEXEC);
+        if (vfd < 0)
+            return false;
+
+        struct stat sb;
+        if (fstat(vfd, &sb) < 0)
+        {
+            ::close(vfd);
+            vfd = -1;
+            return false;
+        }
+
+        vsize = sb.st_size;
+        if (vsize <= MAX_CACHED_CONTENTS)
+        {
+            vdata.resize(vsize);
+            if (vsize > 0 && pread(vfd, vdata.data(), vsize, 0) != (ssize_t)vsize)
+                vdata.clear();
+        }
+        return true;
+    }
+
+    bool StaticFile::open(const QString& p)
+    {
+        path = p;
+        QByteArray enc = QFile::encodeName(p);
+        if (!openVariant(enc, fd, file_size, data[0]))
+            return false;
+
+        struct stat sb;
+        fstat(fd, &sb);
+        mtime = sb.st_mtime;
+        last_modified = QDateTime::fromTime_t(sb.st_mtime);
+        etag = "\"" + QByteArray::number(file_size, 16) + "-" + QByteArray::number(mtime, 16) + "\"";
+
+        // only use a gzip variant which is at least as new as the file itself
+        struct stat gz_sb;
+        QByteArray gz_path = enc + ".gz";
+        if (stat(gz_path.constData(), &gz_sb) == 0 && gz_sb.st_mtime >= sb.st_mtime)
+        {
+            if (openVariant(gz_path, gz_fd, gz_size, data[1]))
+                gz_etag = "\"" + QByteArray::number(file_size, 16) + "-" + QByteArray::number(mtime, 16) + "-gz\"";
+        }
+
+        return true;
+    }
+
+    bool StaticFile::isStale() const
+    {
+        struct stat sb;
+        if (stat(QFile::encodeName(path).constData(), &sb) < 0)
+            return true;
+
+        return (Uint64)sb.st_size != file_size || sb.st_mtime != mtime;
+    }
+
+    bool StaticFile::matches(const QString& if_none_match, bool gzip) const
+    {
+        const QString tag = QString::fromLatin1(gzip ? gz_etag : etag);
+        QStringList tags = if_none_match.split(QLatin1Char(','));
+        foreach (const QString& t, tags)
+        {
+            QString tt = t.trimmed();
+            if (tt == QLatin1String("*") || tt == tag || (tt.startsWith(QLatin1String("W/")) && tt.mid(2) == tag))
+                return true;
+        }
+        return false;
+    }
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+
+#ifndef KTSTATICFILE_H
+#define KTSTATICFILE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include <util/constants.h>
+
+namespace kt
+{
+
+    /**
+     * Cache entry for a file served by the web interface.
+     * It keeps an open descriptor to send the file from, a precompressed variant (the same path with .gz appended)
+     * when there is an up to date one, the ETag, and the header fields which only depend on the file.
+     * Small files are also kept in memory, so they can be sent together with the header in one call.
+     */
+    class StaticFile
+    {
+    public:
+        StaticFile();
+        ~StaticFile();
+
+        /**
+         * Open a file and its gzip variant.
+         * @param path Path of the file
+         * @return true upon success
+         */
+        bool open(const QString& path);
+
+        /// Whether the file has changed on disk since it was opened
+        bool isStale() const;
+
+        /// Whether there is a gzip variant
+        bool hasGzipVariant() const {return gz_fd >= 0;}
+
+        /// Get the descriptor to send from
+        int descriptor(bool gzip) const {return gzip ? gz_fd : fd;}
+
+        /// Get the size of the file
+        bt::Uint64 size(bool gzip) const {return gzip ? gz_size : file_size;}
+
+        /// Get the contents, empty if the file is too large to be kept in memory
+        const QByteArray& contents(bool gzip) const {return data[gzip ? 1 : 0];}
+
+        /// Get the ETag
+        QByteArray eTag(bool gzip) const {return gzip ? gz_etag : etag;}
+
+        /// Get the last modification time
+        const QDateTime& lastModified() const {return last_modified;}
+
+        /// Get the cached header fields (each terminated by \r\n)
+        const QByteArray& headerFields(bool gzip) const {return fields[gzip ? 1 : 0];}
+
+        /// Set the cached header fields
+        void setHeaderFields(bool gzip, const QByteArray& f) {fields[gzip ? 1 : 0] = f;}
+
+        /**
+         * Check an If-None-Match header value against our ETag.
+         * @param if_none_match The header value
+         * @param gzip Which variant will be sent
+         * @return true if the client has the current version
+         */
+        bool matches(const QString& if_none_match, bool gzip) const;
+
+    private:
+        bool openVariant(const QByteArray& path, int& vfd, bt::Uint64& vsize, QByteArray& vdata);
+
+    private:
+        QString path;
+        int fd;
+        int gz_fd;
+        bt::Uint64 file_size;
+        bt::Uint64 gz_size;
+        bt::Int64 mtime;
+        QDateTime last_modified;
+        QByteArray etag;
+        QByteArray gz_etag;
+        QByteArray data[2];
+        QByteArray fields[2];
+    };
+
+}
+
+#endif
@@ -100,17 +100,6 @@ namespace kt
         if (!tmp.isEmpty())
             tor = tmp.toInt();
 
-        int cnt = 0;
-        kt::QueueManager* qman = core->getQueueManager();
-        kt::QueueManager::iterator i = qman->begin();
-        while (i != qman->end())
-        {
-            if (cnt == tor)
-                return *i;
-            cnt++;
-            i++;
-        }
-
-        return 0;
+        return core->getQueueManager()->getTorrent(tor);
     }
 }
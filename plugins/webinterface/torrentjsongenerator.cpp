@@ -0,0 +1,334 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+#include <QUrl>
+#include <QUrlQuery>
+
+#include <util/functions.h>
+#include <interfaces/coreinterface.h>
+#include <interfaces/torrentinterface.h>
+#include "httpserver.h"
+#include "torrentjsongenerator.h"
+#include "httpresponseheader.h"
+#include "httpclienthandler.h"
+
+using namespace bt;
+
+namespace kt
+{
+    /// Maximum number of removals remembered for making deltas
+    const int MAX_REMOVED = 1000;
+
+    /// Maximum time a long poll request is held in seconds
+    const int MAX_WAIT = 60;
+
+    static void WriteString(QByteArray& out, const QString& str)
+    {
+        static const char hex[] = "0123456789abcdef";
+        QByteArray utf8 = str.toUtf8();
+        out.append('"');
+        for (int i = 0; i < utf8.size(); i++)
+        {
+            unsigned char c = utf8[i];
+            switch (c)
+            {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20)
+                {
+                    out.append("\\u00");
+                    out.append(hex[c >> 4]);
+                    out.append(hex[c & 0xF]);
+                }
+                else
+                    out.append((char)c);
+                break;
+            }
+        }
+        out.append('"');
+    }
+
+    static void WriteField(QByteArray& out, const char* name, Uint64 value)
+    {
+        out.append(",\"");
+        out.append(name);
+        out.append("\":");
+        out.append(QByteArray::number(value));
+    }
+
+    static QByteArray ToJson(const QByteArray& hash, bt::TorrentInterface* ti, const bt::TorrentStats& s)
+    {
+        QByteArray out;
+        out.reserve(512);
+        out.append("{\"info_hash\":\"");
+        out.append(hash);
+        out.append("\",\"name\":");
+        WriteString(out, ti->getDisplayName());
+        WriteField(out, "status", s.status);
+        WriteField(out, "running", s.running ? 1 : 0);
+        WriteField(out, "bytes_downloaded", s.bytes_downloaded);
+        WriteField(out, "bytes_uploaded", s.bytes_uploaded);
+        WriteField(out, "total_bytes", s.total_bytes);
+        WriteField(out, "total_bytes_to_download", s.total_bytes_to_download);
+        WriteField(out, "bytes_left", s.bytes_left);
+        WriteField(out, "download_rate", s.download_rate);
+        WriteField(out, "upload_rate", s.upload_rate);
+        WriteField(out, "num_peers", s.num_peers);
+        WriteField(out, "seeders", s.seeders_connected_to);
+        WriteField(out, "seeders_total", s.seeders_total);
+        WriteField(out, "leechers", s.leechers_connected_to);
+        WriteField(out, "leechers_total", s.leechers_total);
+        WriteField(out, "num_files", ti->getNumFiles());
+        out.append(",\"percentage\":");
+        out.append(QByteArray::number(Percentage(s), 'f', 2));
+        out.append('}');
+        return out;
+    }
+
+    TorrentJsonGenerator::TorrentJsonGenerator(CoreInterface* core, HttpServer* server)
+        : WebContentGenerator(server, "/data/torrents.json", LOGIN_REQUIRED),
+          core(core),
+          version(1),
+          snapshot_version(0),
+          oldest_delta(1)
+    {
+        timer.setSingleShot(true);
+        connect(&timer, SIGNAL(timeout()), this, SLOT(checkWaitingClients()));
+        connect(core, SIGNAL(statsUpdated()), this, SLOT(checkWaitingClients()));
+        connect(core, SIGNAL(torrentAdded(bt::TorrentInterface*)), this, SLOT(torrentListChanged()));
+        connect(core, SIGNAL(torrentRemoved(bt::TorrentInterface*)), this, SLOT(torrentListChanged()));
+    }
+
+
+    TorrentJsonGenerator::~TorrentJsonGenerator()
+    {
+    }
+
+    void TorrentJsonGenerator::refresh()
+    {
+        kt::StatsSnapshot::Ptr snap = core->getStatsSnapshot();
+        if (snap->version == snapshot_version && snapshot_version != 0)
+            return;
+
+        snapshot_version = snap->version;
+        Uint64 next = version + 1;
+        bool changed = false;
+
+        QVector<bt::SHA1Hash> new_order;
+        new_order.reserve(snap->torrents.size());
+        QVector<kt::TorrentSnapshot>::const_iterator i = snap->torrents.begin();
+        while (i != snap->torrents.end())
+        {
+            const bt::SHA1Hash& ih = i->tc->getInfoHash();
+            QHash<bt::SHA1Hash, Entry>::iterator e = entries.find(ih);
+            if (e == entries.end())
+            {
+                Entry entry;
+                entry.hash = ih.toString().toLatin1();
+                entry.json = ToJson(entry.hash, i->tc, i->stats);
+                entry.changed = next;
+                entry.seen = snapshot_version;
+                entries.insert(ih, entry);
+                changed = true;
+            }
+            else
+            {
+                QByteArray json = ToJson(e->hash, i->tc, i->stats);
+                if (json != e->json)
+                {
+                    e->json = json;
+                    e->changed = next;
+                    changed = true;
+                }
+                e->seen = snapshot_version;
+            }
+            new_order.append(ih);
+            i++;
+        }
+
+        // Everything which was not seen in this snapshot is gone
+        if (entries.size() != new_order.size())
+        {
+            QHash<bt::SHA1Hash, Entry>::iterator e = entries.begin();
+            while (e != entries.end())
+            {
+                if (e->seen != snapshot_version)
+                {
+                    removed.append(qMakePair(next, e->hash));
+                    e = entries.erase(e);
+                    changed = true;
+                }
+                else
+                    e++;
+            }
+
+            while (removed.size() > MAX_REMOVED)
+            {
+                oldest_delta = removed.first().first + 1;
+                removed.removeFirst();
+            }
+        }
+
+        // A different order also counts as a change, but only the full list shows the order
+        if (new_order != order)
+        {
+            order = new_order;
+            changed = true;
+        }
+
+        if (changed)
+            version = next;
+    }
+
+    QByteArray TorrentJsonGenerator::response(Uint64 since) const
+    {
+        // Deltas can only be made from versions we know about
+        bool full = since == 0 || since < oldest_delta || since > version;
+
+        QByteArray out;
+        out.reserve(128 + entries.size() * 384);
+        out.append("{\"version\":");
+        out.append(QByteArray::number(version));
+        out.append(",\"full\":");
+        out.append(full ? "true" : "false");
+        out.append(",\"torrents\":[");
+        bool first = true;
+        for (QVector<bt::SHA1Hash>::const_iterator i = order.begin(); i != order.end(); i++)
+        {
+            QHash<bt::SHA1Hash, Entry>::const_iterator e = entries.constFind(*i);
+            if (!full && e->changed <= since)
+                continue;
+
+            if (!first)
+                out.append(',');
+            out.append(e->json);
+            first = false;
+        }
+        out.append("],\"removed\":[");
+        if (!full)
+        {
+            first = true;
+            for (QList<QPair<Uint64, QByteArray> >::const_iterator i = removed.begin(); i != removed.end(); i++)
+            {
+                if (i->first <= since)
+                    continue;
+
+                if (!first)
+                    out.append(',');
+                out.append('"');
+                out.append(i->second);
+                out.append('"');
+                first = false;
+            }
+        }
+        out.append("]}");
+        return out;
+    }
+
+    void TorrentJsonGenerator::send(HttpClientHandler* hdlr, int major, int minor, Uint64 since)
+    {
+        HttpResponseHeader rhdr(200, major, minor);
+        server->setDefaultResponseHeaders(rhdr, QStringLiteral("application/json"), true);
+        hdlr->send(rhdr, response(since));
+    }
+
+    void TorrentJsonGenerator::get(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr)
+    {
+        const QUrlQuery query(QUrl(hdr.path()));
+        Uint64 since = query.queryItemValue(QStringLiteral("since")).toULongLong();
+        int wait = qMin(query.queryItemValue(QStringLiteral("wait")).toInt(), MAX_WAIT);
+
+        refresh();
+        if (wait <= 0 || since == 0 || since != version)
+        {
+            send(hdlr, hdr.majorVersion(), hdr.minorVersion(), since);
+            return;
+        }
+
+        // Nothing changed yet, hold the request until something does
+        WaitingClient wc;
+        wc.hdlr = hdlr;
+        wc.major = hdr.majorVersion();
+        wc.minor = hdr.minorVersion();
+        wc.since = since;
+        wc.wait = wait * 1000;
+        wc.started.start();
+        waiting.append(wc);
+        startTimeoutTimer();
+    }
+
+    void TorrentJsonGenerator::post(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr, const QByteArray& data)
+    {
+        Q_UNUSED(data);
+        get(hdlr, hdr);
+    }
+
+    void TorrentJsonGenerator::torrentListChanged()
+    {
+        // there are no stats updates while nothing is running, and a removed torrent
+        // is only gone once the signal has been handled
+        if (!waiting.isEmpty())
+            QTimer::singleShot(0, this, SLOT(checkWaitingClients()));
+    }
+
+    void TorrentJsonGenerator::startTimeoutTimer()
+    {
+        // fire when the first of the waiting clients times out
+        int first = MAX_WAIT * 1000;
+        for (QList<WaitingClient>::const_iterator i = waiting.constBegin(); i != waiting.constEnd(); i++)
+            first = qMin(first, i->wait - i->started.elapsed());
+
+        timer.start(qMax(first, 0));
+    }
+
+    void TorrentJsonGenerator::checkWaitingClients()
+    {
+        if (waiting.isEmpty())
+            return;
+
+        refresh();
+        QList<WaitingClient>::iterator i = waiting.begin();
+        while (i != waiting.end())
+        {
+            if (!i->hdlr)
+            {
+                // connection was closed in the mean time
+                i = waiting.erase(i);
+            }
+            else if (i->since != version || i->started.elapsed() >= i->wait)
+            {
+                send(i->hdlr, i->major, i->minor, i->since);
+                i = waiting.erase(i);
+            }
+            else
+                i++;
+        }
+
+        if (waiting.isEmpty())
+            timer.stop();
+        else
+            startTimeoutTimer();
+    }
+}
+
+#include "torrentjsongenerator.moc"
@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by                                                 *
+ *   The KTorrent developers                                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.          *
+ ***************************************************************************/
+#ifndef KTTORRENTJSONGENERATOR_H
+#define KTTORRENTJSONGENERATOR_H
+
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTime>
+#include <QTimer>
+#include <QVector>
+
+#include <util/constants.h>
+#include <util/sha1hash.h>
+#include <webcontentgenerator.h>
+
+namespace kt
+{
+    class CoreInterface;
+
+    /**
+        Content generator for /data/torrents.json, the torrent list as JSON with raw numbers.
+
+        Every change in the list gets a new version. With ?since=<version> only the torrents which changed
+        after that version are returned, together with the info hashes of the removed ones.
+        With ?wait=<seconds> the request is held until something changes or the time runs out (long polling).
+        Held requests are answered from the stats update of the core, the timer only handles the time outs.
+        The JSON of each torrent is made once per update tick and shared between all clients.
+    */
+    class TorrentJsonGenerator : public QObject, public WebContentGenerator
+    {
+        Q_OBJECT
+    public:
+        TorrentJsonGenerator(CoreInterface* core, HttpServer* server);
+        virtual ~TorrentJsonGenerator();
+
+        virtual void get(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr);
+        virtual void post(HttpClientHandler* hdlr, const QHttpRequestHeader& hdr, const QByteArray& data);
+
+    private slots:
+        void checkWaitingClients();
+        void torrentListChanged();
+
+    private:
+        void refresh();
+        QByteArray response(bt::Uint64 since) const;
+        void send(HttpClientHandler* hdlr, int major, int minor, bt::Uint64 since);
+        void startTimeoutTimer();
+
+    private:
+        struct Entry
+        {
+            QByteArray hash;
+            QByteArray json;
+            bt::Uint64 changed; // version in which it last changed
+            bt::Uint64 seen; // stats snapshot in which it was last seen
+        };
+
+        struct WaitingClient
+        {
+            QPointer<HttpClientHandler> hdlr;
+            int major;
+            int minor;
+            bt::Uint64 since;
+            int wait;
+            QTime started;
+        };
+
+        CoreInterface* core;
+        bt::Uint64 version;
+        bt::Uint64 snapshot_version;
+        bt::Uint64 oldest_delta; // deltas can be made from this version on
+        QHash<bt::SHA1Hash, Entry> entries;
+        QVector<bt::SHA1Hash> order;
+        QList<QPair<bt::Uint64, QByteArray> > removed;
+        QList<WaitingClient> waiting;
+        QTimer timer;
+    };
+
+}
+
+#endif
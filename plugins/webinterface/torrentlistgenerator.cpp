@@ -56,12 +56,12 @@ namespace kt
         out.setAutoFormatting(true);
         out.writeStartDocument();
         out.writeStartElement("torrents");
-        kt::QueueManager* qman = core->getQueueManager();
-        kt::QueueManager::iterator i = qman->begin();
-        while (i != qman->end())
+        kt::StatsSnapshot::Ptr snap = core->getStatsSnapshot();
+        QVector<kt::TorrentSnapshot>::const_iterator i = snap->torrents.begin();
+        while (i != snap->torrents.end())
         {
-            bt::TorrentInterface* ti = *i;
-            const bt::TorrentStats& s = ti->getStats();
+            bt::TorrentInterface* ti = i->tc;
+            const bt::TorrentStats& s = i->stats;
             out.writeStartElement("torrent");
             writeElement(out, "name", ti->getDisplayName());
             writeElement(out, "info_hash", ti->getInfoHash().toString());